@@ -44,6 +44,8 @@ extension.setMessageListener(function(json) {
     handleSocketHasData(msg);
   else if (msg.cmd == 'SocketClosed')
     handleSocketClosed(msg);
+  else if (msg.cmd == 'SocketDrain')
+    handleSocketDrain(msg);
   else { // Then we are dealing with postMessage return.
     var reply_id = msg.reply_id;
     var callback = _callbacks[reply_id];
@@ -256,11 +258,34 @@ var handleRFCOMMSocketAccept = function(msg) {
   }
 };
 
+var _base64Alphabet = 'ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/';
+
+// Decodes |data| into an array of octets, as readData() returns byte[].
+function decodeBase64(data) {
+  var bytes = [];
+  var bits = 0;
+  var value = 0;
+  for (var i = 0; i < data.length; ++i) {
+    var index = _base64Alphabet.indexOf(data.charAt(i));
+    if (index < 0)
+      continue;  // Padding.
+
+    value = (value << 6) | index;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      bytes.push((value >> bits) & 0xff);
+    }
+  }
+  return bytes;
+}
+
 var handleSocketHasData = function(msg) {
   for (var i in adapter.sockets) {
     var socket = adapter.sockets[i];
     if (socket.socket_fd === msg.socket_fd) {
-      socket.data = msg.data;
+      // Data which may not be valid text comes base64 encoded.
+      socket.data = msg.encoding === 'base64' ? decodeBase64(msg.data) : msg.data;
 
       if (socket.onmessage && typeof socket.onmessage === 'function')
         socket.onmessage();
@@ -271,6 +296,20 @@ var handleSocketHasData = function(msg) {
   }
 };
 
+var handleSocketDrain = function(msg) {
+  for (var i in adapter.sockets) {
+    var socket = adapter.sockets[i];
+    if (socket.socket_fd === msg.socket_fd) {
+      socket.bufferedAmount = msg.bufferedAmount;
+
+      if (socket.ondrain && typeof socket.ondrain === 'function')
+        socket.ondrain();
+
+      return;
+    }
+  }
+};
+
 var handleSocketClosed = function(msg) {
   for (var i in adapter.sockets) {
     var socket = adapter.sockets[i];
@@ -920,7 +959,11 @@ function BluetoothSocket(uuid, peer, msg) {
   _addConstProperty(this, 'state', 'OPEN');
   this.onclose = null;
   this.onmessage = null;
+  // Called once all the data written was sent, with bufferedAmount back to 0.
+  this.ondrain = null;
   this.data = [];
+  // Bytes written but not sent yet.
+  this.bufferedAmount = 0;
   this.channel = 0;
   this.socket_fd = 0;
 
@@ -943,6 +986,7 @@ BluetoothSocket.prototype.writeData = function(data) {
     'socket_fd': this.socket_fd
   };
   var result = JSON.parse(extension.internal.sendSyncMessage(JSON.stringify(msg)));
+  this.bufferedAmount = result.bufferedAmount || 0;
 
   return result.size;
 };
@@ -8,6 +8,7 @@
 #include <gio/gio.h>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "common/extension.h"
@@ -184,8 +185,30 @@ class BluetoothInstance : public common::Instance {
 
   void DeviceFound(std::string address, GVariantIter* properties);
 
+  // An accepted RFCOMM socket, with what was received on it and not posted
+  // yet, and what was written to it and not sent yet.
+  struct RFCOMMSocket {
+    BluetoothInstance* instance;
+    GSocket* socket;
+    int fd;
+    GSource* source;
+    guint flush_timeout_id;
+    std::string pending;
+    // Only set while |outgoing| has bytes left from |outgoing_offset| on.
+    GSource* write_source;
+    std::string outgoing;
+    gsize outgoing_offset;
+  };
+
   static gboolean OnSocketHasData(GSocket* client, GIOCondition cond,
                               gpointer user_data);
+  static gboolean OnSocketFlushTimeout(gpointer user_data);
+  static gboolean OnSocketWritable(GSocket* client, GIOCondition cond,
+                                   gpointer user_data);
+
+  void FlushSocketData(RFCOMMSocket* socket);
+  bool SendSocketData(RFCOMMSocket* socket);
+  void DestroySocket(RFCOMMSocket* socket);
 
   GDBusProxy* manager_proxy_;
   std::map<std::string, std::string> callbacks_map_;
@@ -194,7 +217,7 @@ class BluetoothInstance : public common::Instance {
   GDBusProxy* service_proxy_;
   int pending_listen_socket_;
 
-  std::vector<GSocket*> sockets_;
+  std::unordered_map<int, RFCOMMSocket*> sockets_;
   std::vector<GSocket*> servers_;
 
   GSocketListener *rfcomm_listener_;
@@ -23,6 +23,13 @@ namespace {
 
 static std::list<GCancellable*> cancellables;
 
+// Received data is read in chunks of kSocketReadChunkSize and posted to JS
+// once kSocketMaxPendingSize bytes are pending, or kSocketFlushDelay ms after
+// the first of them arrived, whichever comes first.
+const gsize kSocketReadChunkSize = 16 * 1024;
+const gsize kSocketMaxPendingSize = 64 * 1024;
+const guint kSocketFlushDelay = 10;
+
 static GCancellable* new_cancellable() {
   GCancellable* cancellable = g_cancellable_new();
 
@@ -607,6 +614,9 @@ BluetoothInstance::~BluetoothInstance() {
   for (it = known_devices_.begin(); it != known_devices_.end(); ++it)
     g_object_unref(it->second);
 
+  while (!sockets_.empty())
+    DestroySocket(sockets_.begin()->second);
+
   g_bus_unwatch_name(name_watch_id_);
 }
 
@@ -737,35 +747,161 @@ void BluetoothInstance::HandleDestroyBonding(const picojson::value& msg) {
 
 gboolean BluetoothInstance::OnSocketHasData(GSocket* client, GIOCondition cond,
                                             gpointer user_data) {
-  BluetoothInstance* handler = reinterpret_cast<BluetoothInstance*>(user_data);
-  int fd = g_socket_get_fd(client);
-  picojson::value::object o;
+  RFCOMMSocket* socket = reinterpret_cast<RFCOMMSocket*>(user_data);
+  BluetoothInstance* handler = socket->instance;
+  bool closed = cond & (G_IO_ERR | G_IO_HUP);
+
+  // Drain the socket, so that a fast sender costs one wakeup per burst
+  // rather than one per read. Whatever is still there when the peer hangs
+  // up is read too, before SocketClosed.
+  gchar buf[kSocketReadChunkSize];
+  while (true) {
+    GError* error = NULL;
+    gssize len = g_socket_receive_with_blocking(client, buf, sizeof(buf),
+                                                FALSE, NULL, &error);
+    if (len <= 0) {
+      if (len == 0 ||
+          !g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+        closed = true;
+      if (error)
+        g_error_free(error);
+      break;
+    }
 
-  if (cond & G_IO_ERR || cond & G_IO_HUP) {
-    o["cmd"] = picojson::value("SocketClosed");
-    o["socket_fd"] = picojson::value(static_cast<double>(fd));
+    socket->pending.append(buf, len);
+    if (socket->pending.size() >= kSocketMaxPendingSize)
+      handler->FlushSocketData(socket);
+  }
 
+  if (closed) {
+    handler->FlushSocketData(socket);
+
+    picojson::value::object o;
+    o["cmd"] = picojson::value("SocketClosed");
+    o["socket_fd"] = picojson::value(static_cast<double>(socket->fd));
     handler->InternalPostMessage(picojson::value(o));
 
+    handler->DestroySocket(socket);
     return false;
   }
 
-  gchar buf[512];
-  gssize len;
+  if (!socket->pending.empty() && !socket->flush_timeout_id)
+    socket->flush_timeout_id = g_timeout_add(
+        kSocketFlushDelay, BluetoothInstance::OnSocketFlushTimeout, socket);
 
-  len = g_socket_receive(client, buf, sizeof(buf), NULL, NULL);
-  if (len < 0)
-    return false;
+  return true;
+}
+
+gboolean BluetoothInstance::OnSocketFlushTimeout(gpointer user_data) {
+  RFCOMMSocket* socket = reinterpret_cast<RFCOMMSocket*>(user_data);
+
+  socket->flush_timeout_id = 0;
+  socket->instance->FlushSocketData(socket);
 
+  return false;
+}
+
+// Posts the pending data of |socket| as one SocketHasData message. The data
+// is base64 encoded, as a JSON string can't carry arbitrary bytes.
+void BluetoothInstance::FlushSocketData(RFCOMMSocket* socket) {
+  if (socket->flush_timeout_id) {
+    g_source_remove(socket->flush_timeout_id);
+    socket->flush_timeout_id = 0;
+  }
+
+  if (socket->pending.empty())
+    return;
+
+  gchar* data = g_base64_encode(
+      reinterpret_cast<const guchar*>(socket->pending.data()),
+      socket->pending.size());
+  socket->pending.clear();
+
+  picojson::value::object o;
   o["cmd"] = picojson::value("SocketHasData");
-  o["socket_fd"] = picojson::value(static_cast<double>(fd));
-  o["data"] = picojson::value(buf, len);
+  o["socket_fd"] = picojson::value(static_cast<double>(socket->fd));
+  o["data"] = picojson::value(data);
+  o["encoding"] = picojson::value("base64");
+  g_free(data);
+
+  InternalPostMessage(picojson::value(o));
+}
+
+gboolean BluetoothInstance::OnSocketWritable(GSocket* client,
+                                             GIOCondition cond,
+                                             gpointer user_data) {
+  RFCOMMSocket* socket = reinterpret_cast<RFCOMMSocket*>(user_data);
+  BluetoothInstance* handler = socket->instance;
+
+  bool sent = handler->SendSocketData(socket);
+  if (sent && socket->outgoing_offset < socket->outgoing.size())
+    return true;
+
+  g_source_unref(socket->write_source);
+  socket->write_source = 0;
 
+  // A failed socket is reported by OnSocketHasData(), as SocketClosed.
+  if (!sent)
+    return false;
+
+  picojson::value::object o;
+  o["cmd"] = picojson::value("SocketDrain");
+  o["socket_fd"] = picojson::value(static_cast<double>(socket->fd));
+  o["bufferedAmount"] = picojson::value(static_cast<double>(0));
   handler->InternalPostMessage(picojson::value(o));
 
+  return false;
+}
+
+// Sends as much of the outgoing data of |socket| as it takes without
+// blocking. Returns false if the socket failed, dropping that data.
+bool BluetoothInstance::SendSocketData(RFCOMMSocket* socket) {
+  std::string& outgoing = socket->outgoing;
+
+  while (socket->outgoing_offset < outgoing.size()) {
+    GError* error = NULL;
+    gssize len = g_socket_send_with_blocking(
+        socket->socket, outgoing.data() + socket->outgoing_offset,
+        outgoing.size() - socket->outgoing_offset, FALSE, NULL, &error);
+    if (len < 0) {
+      bool would_block =
+          g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK);
+      g_error_free(error);
+      if (would_block)
+        return true;
+
+      outgoing.clear();
+      socket->outgoing_offset = 0;
+      return false;
+    }
+
+    socket->outgoing_offset += len;
+  }
+
+  outgoing.clear();
+  socket->outgoing_offset = 0;
   return true;
 }
 
+void BluetoothInstance::DestroySocket(RFCOMMSocket* socket) {
+  if (socket->flush_timeout_id)
+    g_source_remove(socket->flush_timeout_id);
+
+  g_source_destroy(socket->source);
+  g_source_unref(socket->source);
+
+  if (socket->write_source) {
+    g_source_destroy(socket->write_source);
+    g_source_unref(socket->write_source);
+  }
+
+  g_socket_close(socket->socket, NULL);
+  g_object_unref(socket->socket);
+
+  sockets_.erase(socket->fd);
+  delete socket;
+}
+
 void BluetoothInstance::OnListenerAccept(GObject* object, GAsyncResult* res) {
   GError* error = 0;
   GSocket *socket = g_socket_listener_accept_socket_finish(
@@ -775,8 +911,6 @@ void BluetoothInstance::OnListenerAccept(GObject* object, GAsyncResult* res) {
     return;
   }
 
-  sockets_.push_back(socket);
-
   int fd = g_socket_get_fd(socket);
   uint32_t channel = rfcomm_get_channel(fd);
   char address[18];  // "XX:XX:XX:XX:XX:XX"
@@ -791,12 +925,24 @@ void BluetoothInstance::OnListenerAccept(GObject* object, GAsyncResult* res) {
 
   InternalPostMessage(picojson::value(o));
 
-  GSource *source = g_socket_create_source(socket, G_IO_IN, NULL);
-
-  g_source_set_callback(source, (GSourceFunc)BluetoothInstance::OnSocketHasData,
-                        this, NULL);
-  g_source_attach(source, NULL);
-  g_source_unref(source);
+  // Writes are queued and sent as the socket takes them, so a bulk
+  // transfer doesn't block this thread.
+  g_socket_set_blocking(socket, false);
+
+  RFCOMMSocket* rfcomm_socket = new RFCOMMSocket;
+  rfcomm_socket->instance = this;
+  rfcomm_socket->socket = socket;
+  rfcomm_socket->fd = fd;
+  rfcomm_socket->source = g_socket_create_source(socket, G_IO_IN, NULL);
+  rfcomm_socket->flush_timeout_id = 0;
+  rfcomm_socket->write_source = 0;
+  rfcomm_socket->outgoing_offset = 0;
+  sockets_[fd] = rfcomm_socket;
+
+  g_source_set_callback(rfcomm_socket->source,
+                        (GSourceFunc)BluetoothInstance::OnSocketHasData,
+                        rfcomm_socket, NULL);
+  g_source_attach(rfcomm_socket->source, NULL);
 }
 
 void BluetoothInstance::OnServiceAddRecord(GObject* object, GAsyncResult* res) {
@@ -936,37 +1082,68 @@ void BluetoothInstance::OnGotDeviceProperties(
 
 void BluetoothInstance::HandleSocketWriteData(const picojson::value& msg) {
   int fd = static_cast<int>(msg.get("socket_fd").get<double>());
-  auto it = sockets_.begin();
+  std::unordered_map<int, RFCOMMSocket*>::iterator it = sockets_.find(fd);
   gssize len = 0;
+  gsize buffered_amount = 0;
 
-  for (; it != sockets_.end(); ++it) {
-    GSocket *socket = *it;
+  if (it != sockets_.end()) {
+    RFCOMMSocket* socket = it->second;
+    std::string& outgoing = socket->outgoing;
+    const picojson::value& data = msg.get("data");
 
-    if (g_socket_get_fd(socket) == fd) {
-      std::string data = msg.get("data").to_str();
+    // Drop what was sent already, unless most of the queue is still to go.
+    if (socket->outgoing_offset * 2 >= outgoing.size()) {
+      outgoing.erase(0, socket->outgoing_offset);
+      socket->outgoing_offset = 0;
+    }
 
-      len = g_socket_send(socket, data.c_str(), data.length(), NULL, NULL);
-      break;
+    gsize queued = outgoing.size();
+    if (data.is<picojson::array>()) {
+      // byte[], as readData() returns.
+      const picojson::array& bytes = data.get<picojson::array>();
+      for (picojson::array::const_iterator byte = bytes.begin();
+           byte != bytes.end(); ++byte) {
+        if (byte->is<double>())
+          outgoing += static_cast<char>(
+              static_cast<int>(byte->get<double>()) & 0xff);
+      }
+    } else {
+      outgoing += data.to_str();
+    }
+    len = outgoing.size() - queued;
+
+    // Whatever the socket doesn't take now is sent once it's writable
+    // again; the write itself only fails if the socket already did.
+    if (!socket->write_source && !SendSocketData(socket))
+      len = -1;
+
+    buffered_amount = outgoing.size() - socket->outgoing_offset;
+    if (buffered_amount && !socket->write_source) {
+      socket->write_source =
+          g_socket_create_source(socket->socket, G_IO_OUT, NULL);
+      g_source_set_callback(socket->write_source,
+                            (GSourceFunc)BluetoothInstance::OnSocketWritable,
+                            socket, NULL);
+      g_source_attach(socket->write_source, NULL);
     }
   }
 
   picojson::value::object o;
   o["size"] = picojson::value(static_cast<double>(len));
+  o["bufferedAmount"] = picojson::value(static_cast<double>(buffered_amount));
 
   InternalSetSyncReply(picojson::value(o));
 }
 
 void BluetoothInstance::HandleCloseSocket(const picojson::value& msg) {
   int fd = static_cast<int>(msg.get("socket_fd").get<double>());
-  std::vector<GSocket*>::iterator it = sockets_.begin();
-
-  for (; it != sockets_.end(); ++it) {
-    GSocket *socket = *it;
+  std::unordered_map<int, RFCOMMSocket*>::iterator it = sockets_.find(fd);
 
-    if (g_socket_get_fd(socket) == fd) {
-      g_socket_close(socket, NULL);
-      break;
-    }
+  // Data still queued for sending is dropped, apps wanting it sent wait
+  // for the socket to drain before closing it.
+  if (it != sockets_.end()) {
+    FlushSocketData(it->second);
+    DestroySocket(it->second);
   }
 
   picojson::value::object o;
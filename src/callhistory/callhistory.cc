@@ -73,7 +73,10 @@ common::Instance* CallHistoryExtension::CreateInstance() {
 CallHistoryInstance::CallHistoryInstance()
     : backendConnected_(false),
       listenerCount_(0),
-      instanceCheck_(kInstanceMagic) {
+      listenerRegistered_(false),
+      instanceCheck_(kInstanceMagic),
+      journalStartVersion_(0),
+      journalVersion_(0) {
 }
 
 CallHistoryInstance::~CallHistoryInstance() {
@@ -118,12 +121,16 @@ void CallHistoryInstance::HandleMessage(const char* msg) {
   std::string cmd = js_cmd.get("cmd").to_str();
   if (cmd == "find")
     err = HandleFind(js_cmd, js_reply);  // returns results in js_reply
+  else if (cmd == "aggregate")
+    err = HandleAggregate(js_cmd, js_reply);  // statistics in js_reply
   else if (cmd == "remove")
     err = HandleRemove(js_cmd);  // only success/error
   else if (cmd == "removeBatch")
     err = HandleRemoveBatch(js_cmd);  // only success/error
   else if (cmd == "removeAll")
-    err = HandleRemoveAll(js_cmd);  // only success/error
+    err = HandleRemoveAll(js_cmd, js_reply);  // progress, success/error
+  else if (cmd == "getChanges")
+    err = HandleGetChanges(js_cmd, js_reply);  // delta in js_reply
   else if (cmd == "addListener")
     err = HandleAddListener();
   else if (cmd == "removeListener")
@@ -6,6 +6,9 @@
 #define CALLHISTORY_CALLHISTORY_H_
 
 #include <time.h>
+#include <atomic>  // NOLINT
+#include <map>
+#include <mutex>  // NOLINT
 #include <string>
 #include <iostream>
 #include "common/extension.h"
@@ -36,7 +39,18 @@ class CallHistoryInstance : public common::Instance {
   virtual ~CallHistoryInstance();
   virtual bool IsValid() const;
 
+  // Called from the native DB change callback with the changed entries.
+  void RecordChanges(char* changes);
+
  private:
+  // Latest change of an entry, by journal version; insertedVersion is -1
+  // when the entry was created before the journal started.
+  struct JournalEntry {
+    int insertedVersion;
+    int version;
+    bool deleted;
+  };
+
   // common::Instance implementation.
   void HandleMessage(const char* msg);
   void HandleSyncMessage(const char* msg);
@@ -46,19 +60,35 @@ class CallHistoryInstance : public common::Instance {
   // Tizen API backend-specific call handlers
   int HandleFind(const picojson::value& msg,
                  picojson::value::object& reply);
+  int HandleAggregate(const picojson::value& msg,
+                      picojson::value::object& reply);
   int HandleRemove(const picojson::value& msg);
   int HandleRemoveBatch(const picojson::value& msg);
-  int HandleRemoveAll(const picojson::value& msg);
+  int HandleRemoveAll(const picojson::value& msg,
+                      picojson::value::object& reply);
+  int HandleGetChanges(const picojson::value& msg,
+                       picojson::value::object& reply);
   int HandleAddListener();
   int HandleRemoveListener();
 
+  int RegisterListener();
   int UnregisterListener();
   bool ReleaseBackend();
   bool CheckBackend();
 
   bool backendConnected_;
-  unsigned int listenerCount_;
+  // Read from the DB change callback thread.
+  std::atomic<unsigned int> listenerCount_;
+  bool listenerRegistered_;
   unsigned int instanceCheck_;
+
+  std::map<int, JournalEntry> journal_;
+  int journalStartVersion_;
+  // Version of the latest changes journaled. It starts from the DB version
+  // and grows with every notification, so that changes notified after a
+  // getChanges() reply are never stamped with the version it returned.
+  int journalVersion_;
+  std::mutex journalMutex_;
 };
 
 // property names used in the JS API, for CallHistoryEntry
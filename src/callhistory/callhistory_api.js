@@ -65,6 +65,9 @@ var callh_listeners_count = 0;
 
 var callh_onsuccess = {};
 var callh_onerror = {};
+var callh_onprogress = {};
+var callh_onbatch = {};
+var callh_partial_results = {};
 var callh_next_reply_id = 0;
 
 var getNextReplyId = function() {
@@ -72,12 +75,16 @@ var getNextReplyId = function() {
 };
 
 // send a JSON message to the native extension code
-function postMessage(msg, onsuccess, onerror) {
+function postMessage(msg, onsuccess, onerror, onprogress, onbatch) {
   var reply_id = getNextReplyId();
   msg.reply_id = reply_id;
   callh_onsuccess[reply_id] = onsuccess;
   if (isValidFunction(onerror))
     callh_onerror[reply_id] = onerror;
+  if (isValidFunction(onprogress))
+    callh_onprogress[reply_id] = onprogress;
+  if (isValidFunction(onbatch))
+    callh_onbatch[reply_id] = onbatch;
   var sm = JSON.stringify(msg);
   extension.postMessage(sm);
 }
@@ -89,6 +96,9 @@ function handleReply(msg) {
     throwTizenUnknown();
   }
   if (msg.errorCode != tizen.WebAPIError.NO_ERROR) {
+    delete callh_partial_results[msg.reply_id];
+    delete callh_onprogress[msg.reply_id];
+    delete callh_onbatch[msg.reply_id];
     var onerror = callh_onerror[msg.reply_id];
     if (isValidFunction(onerror)) {
       onerror(new tizen.WebAPIError(msg.errorCode));
@@ -98,9 +108,41 @@ function handleReply(msg) {
     }
     return;
   }
+  if (msg.progress) {
+    var onprogress = callh_onprogress[msg.reply_id];
+    if (isValidFunction(onprogress))
+      onprogress(msg.progress.removed, msg.progress.total);
+    return;
+  }
+  delete callh_onprogress[msg.reply_id];
+
+  // find() results come in pages. They go to the batch callback as they
+  // come when there is one, otherwise they are collected until the last.
+  var result;
+  var onbatch = callh_onbatch[msg.reply_id];
+  if (isValidFunction(onbatch)) {
+    if (msg.result && msg.result.length > 0)
+      onbatch(msg.result);
+    if (msg.partial)
+      return;
+    delete callh_onbatch[msg.reply_id];
+    result = [];
+  } else {
+    var partial = callh_partial_results[msg.reply_id];
+    if (partial)
+      Array.prototype.push.apply(partial, msg.result);
+    else
+      partial = msg.result;
+    if (msg.partial) {
+      callh_partial_results[msg.reply_id] = partial;
+      return;
+    }
+    delete callh_partial_results[msg.reply_id];
+    result = partial;
+  }
   var onsuccess = callh_onsuccess[msg.reply_id];
   if (isValidFunction(onsuccess)) {
-    onsuccess(msg.result);
+    onsuccess(result);
     delete callh_onsuccess[msg.reply_id];
   } else {
     error('Error: success callback is not a function');
@@ -154,7 +196,11 @@ function isValidFilter(f) {
          (f instanceof tizen.CompositeFilter);
 }
 
-exports.find = function(successCallback, errorCallback, filter, sortMode, limit, offset) {
+// The optional batchCallback(entries) is non-standard. When given, it gets
+// the entries in batches as they are read, and successCallback gets an
+// empty array once the last one was delivered.
+exports.find = function(successCallback, errorCallback, filter, sortMode, limit, offset,
+                        batchCallback) {
   if (!isValidFunction(successCallback))
     throwTizenTypeMismatch();
 
@@ -173,6 +219,9 @@ exports.find = function(successCallback, errorCallback, filter, sortMode, limit,
   if (arguments.length > 5 && offset && !isValidInt(offset))
     throwTizenTypeMismatch();
 
+  if (batchCallback && !isValidFunction(batchCallback))
+    throwTizenTypeMismatch();
+
   var cmd = {
     cmd: 'find',
     filter: filter,
@@ -180,6 +229,29 @@ exports.find = function(successCallback, errorCallback, filter, sortMode, limit,
     limit: limit,
     offset: offset
   };
+  postMessage(cmd, successCallback, errorCallback, null, batchCallback);
+};
+
+// Non-standard: call count and duration statistics of the entries matching
+// 'filter', optionally grouped by 'remoteParties', 'direction' or 'day'.
+exports.aggregate = function(successCallback, errorCallback, filter, groupBy) {
+  if (!isValidFunction(successCallback))
+    throwTizenTypeMismatch();
+
+  if (arguments.length > 1 && errorCallback && !(errorCallback instanceof Function))
+    throwTizenTypeMismatch();
+
+  if (arguments.length > 2 && filter && !isValidFilter(filter))
+    throwTizenTypeMismatch();
+
+  if (arguments.length > 3 && groupBy && !isValidString(groupBy))
+    throwTizenTypeMismatch();
+
+  var cmd = {
+    cmd: 'aggregate',
+    filter: filter,
+    groupBy: groupBy
+  };
   postMessage(cmd, successCallback, errorCallback);
 };
 
@@ -213,14 +285,54 @@ exports.removeBatch = function(callEntryList, successCallback, errorCallback) {
   postMessage({ cmd: 'removeBatch', uids: uids }, successCallback, errorCallback);
 };
 
-exports.removeAll = function(successCallback, errorCallback) {
+// The optional progressCallback(removed, total) is non-standard.
+exports.removeAll = function(successCallback, errorCallback, progressCallback) {
   if (!successCallback && !(successCallback instanceof Function))
     throwTizenTypeMismatch();
 
   if (!errorCallback && (!successCallback || !(errorCallback instanceof Function)))
     throwTizenTypeMismatch();
 
-  postMessage({ cmd: 'removeAll' }, successCallback, errorCallback);
+  if (progressCallback && !isValidFunction(progressCallback))
+    throwTizenTypeMismatch();
+
+  postMessage({ cmd: 'removeAll' }, successCallback, errorCallback, progressCallback);
+};
+
+// Non-standard: remove the entries matching 'filter' without reading them
+// first, optionally reporting progressCallback(removed, total).
+exports.removeByFilter = function(filter, successCallback, errorCallback, progressCallback) {
+  if (!isValidFilter(filter))
+    throwTizenTypeMismatch();
+
+  if (successCallback && !isValidFunction(successCallback))
+    throwTizenTypeMismatch();
+
+  if (errorCallback && !isValidFunction(errorCallback))
+    throwTizenTypeMismatch();
+
+  if (progressCallback && !isValidFunction(progressCallback))
+    throwTizenTypeMismatch();
+
+  postMessage({ cmd: 'removeAll', filter: filter },
+              successCallback, errorCallback, progressCallback);
+};
+
+// Non-standard: the entries added, changed and deleted since a DB version,
+// as returned in the 'version' property of the previous result. When the
+// changes can't be told (no or too old version), 'reset' is true in the
+// result and the entries need to be queried with find().
+exports.getChanges = function(version, successCallback, errorCallback) {
+  if (version != null && !isValidInt(version))
+    throwTizenTypeMismatch();
+
+  if (!isValidFunction(successCallback))
+    throwTizenTypeMismatch();
+
+  if (arguments.length > 2 && errorCallback && !(errorCallback instanceof Function))
+    throwTizenTypeMismatch();
+
+  postMessage({ cmd: 'getChanges', version: version }, successCallback, errorCallback);
 };
 
 exports.addChangeListener = function(obs) {
@@ -10,8 +10,10 @@
 
 #include <contacts.h>
 
-#include <memory>
-#include <sstream>
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
 
 namespace {
 
@@ -33,6 +35,18 @@ namespace {
 #define CALLH_FILTER_AND      CONTACTS_FILTER_OPERATOR_AND
 #define CALLH_FILTER_OR       CONTACTS_FILTER_OPERATOR_OR
 
+// Number of records fetched from the DB and posted to JS at a time.
+const int kFindPageSize = 200;
+
+// Number of entries read by id with a single query.
+const unsigned int kFetchChunkSize = 50;
+
+// Number of entries removed in a single DB transaction.
+const unsigned int kDeleteChunkSize = 500;
+
+// Number of changed entries kept for getChanges().
+const unsigned int kMaxJournalSize = 5000;
+
 inline bool check(int err) {
   return err == CONTACTS_ERROR_NONE;
 }
@@ -58,7 +72,7 @@ int MapAttrName(std::string &att) {
   if (att == kCallDirection)
     return CALLH_ATTR_DIRECTION;
 
-  if (att == kExtRemoteParty || att == kRemoteParty)
+  if (att == kExtRemoteParty || att == kRemoteParty || att == kRemoteParties)
     return CALLH_ATTR_ADDRESS;
 
   if (att == kStartTime)
@@ -566,13 +580,26 @@ int ParseFilter(contacts_filter_h& filter,
   return CONTACTS_ERROR_NONE;
 }
 
-// Prepare JSON for setMessageListener() JS function in callhistory_api.js.
-int HandleFindResults(contacts_list_h list, picojson::value::object& resp) {
-  int err = CONTACTS_ERROR_DB;
-  unsigned int total = 0;
+// Set up the contacts filter for a JSON filter (which may be null) on a query.
+int SetQueryFilter(contacts_query_h query, const picojson::value& js_filter) {
+  if (js_filter.is<picojson::null>())
+    return CONTACTS_ERROR_NONE;
 
-  contacts_list_get_count(list, &total);
-  picojson::value::array result;
+  bool filter_empty = true;
+  ScopeGuard<contacts_filter_h> filter;
+  CHK(contacts_filter_create(CALLH_VIEW_URI, &filter));
+  contacts_filter_h* pfilt = &filter;
+  CHK(ParseFilter(*pfilt, js_filter, CALLH_FILTER_NONE, filter_empty));
+  if (!filter_empty)  // the query keeps a copy of the filter
+    CHK(contacts_query_set_filter(query, *pfilt));
+  return CONTACTS_ERROR_NONE;
+}
+
+// Serialize the records of a list into a JSON array, as used for the
+// "result" property in setMessageListener() in callhistory_api.js.
+int SerializeRecords(contacts_list_h list, picojson::value::array& result) {
+  unsigned int total = 0;
+  CHK(contacts_list_get_count(list, &total));
 
   for (unsigned int i = 0; i < total; i++) {
     contacts_record_h record = nullptr;
@@ -583,13 +610,151 @@ int HandleFindResults(contacts_list_h list, picojson::value::object& resp) {
       result.push_back(picojson::value(o));
     }
 
-    err = contacts_list_next(list);  // move the current record
+    int err = contacts_list_next(list);  // move the current record
+    if (err != CONTACTS_ERROR_NONE && err != CONTACTS_ERROR_NO_DATA) {
+      LOG_ERR("SerializeRecords: iterator error");
+      return CONTACTS_ERROR_DB;
+    }
+  }
+  return CONTACTS_ERROR_NONE;
+}
+
+// Map a contacts log type to the JS direction value.
+const char* DirectionFromLogType(int log_type) {
+  switch (log_type) {
+    case CONTACTS_PLOG_TYPE_VIDEO_INCOMMING:
+    case CONTACTS_PLOG_TYPE_VOICE_INCOMMING:
+      return kReceivedCall;
+    case CONTACTS_PLOG_TYPE_VIDEO_OUTGOING:
+    case CONTACTS_PLOG_TYPE_VOICE_OUTGOING:
+      return kDialedCall;
+    case CONTACTS_PLOG_TYPE_VIDEO_INCOMMING_UNSEEN:
+    case CONTACTS_PLOG_TYPE_VOICE_INCOMMING_UNSEEN:
+      return kUnseenMissedCall;
+    case CONTACTS_PLOG_TYPE_VIDEO_INCOMMING_SEEN:
+    case CONTACTS_PLOG_TYPE_VOICE_INCOMMING_SEEN:
+      return kMissedCall;
+    case CONTACTS_PLOG_TYPE_VIDEO_REJECT:
+    case CONTACTS_PLOG_TYPE_VOICE_REJECT:
+      return kRejectedCall;
+    case CONTACTS_PLOG_TYPE_VIDEO_BLOCKED:
+    case CONTACTS_PLOG_TYPE_VOICE_BLOCKED:
+      return kBlockedCall;
+    default:
+      return "";
+  }
+}
+
+// Count and duration statistics of a set of call history entries.
+struct CallStats {
+  CallStats() : count(0), total(0), min(0), max(0) {}
+
+  void Add(int duration) {
+    if (!count || duration < min)
+      min = duration;
+    if (!count || duration > max)
+      max = duration;
+    total += duration;
+    count++;
+  }
+
+  void Serialize(picojson::value::object& o) const {
+    o["count"] = picojson::value(static_cast<double>(count));
+    o["totalDuration"] = picojson::value(static_cast<double>(total));
+    o["minDuration"] = picojson::value(static_cast<double>(min));
+    o["maxDuration"] = picojson::value(static_cast<double>(max));
+  }
+
+  unsigned int count;
+  double total;
+  int min;
+  int max;
+};
+
+// Aggregated attributes, as accepted in the "groupBy" property.
+enum GroupBy {
+  GROUP_NONE,
+  GROUP_REMOTE_PARTY,
+  GROUP_DIRECTION,
+  GROUP_DAY
+};
+
+// Add a page of records to the statistics. Only the projected attributes
+// can be read from the records.
+int AggregateRecords(contacts_list_h list, GroupBy group_by,
+                     CallStats& all, std::map<std::string, CallStats>& groups,
+                     unsigned int* count) {
+  CHK(contacts_list_get_count(list, count));
+
+  for (unsigned int i = 0; i < *count; i++) {
+    contacts_record_h record = nullptr;
+    CHK(contacts_list_get_current_record_p(list, &record));
+    if (record) {
+      int duration = 0;
+      CHK(contacts_record_get_int(record, CALLH_ATTR_DURATION, &duration));
+      all.Add(duration);
+
+      std::string key;
+      if (group_by == GROUP_REMOTE_PARTY) {
+        char* address = nullptr;
+        CHK(contacts_record_get_str_p(record, CALLH_ATTR_ADDRESS, &address));
+        if (address)
+          key = address;
+      } else if (group_by == GROUP_DIRECTION) {
+        int log_type = 0;
+        CHK(contacts_record_get_int(record, CALLH_ATTR_DIRECTION, &log_type));
+        key = DirectionFromLogType(log_type);
+      } else if (group_by == GROUP_DAY) {
+        int start = 0;
+        CHK(contacts_record_get_int(record, CALLH_ATTR_STARTTIME, &start));
+        time_t tme = static_cast<time_t>(start);
+        struct tm tm_s = {0};
+        localtime_r(&tme, &tm_s);
+        char day[16];
+        strftime(day, sizeof(day), "%Y-%m-%d", &tm_s);
+        key = day;
+      }
+      if (group_by != GROUP_NONE)
+        groups[key].Add(duration);
+    }
+
+    int err = contacts_list_next(list);
     if (err != CONTACTS_ERROR_NONE && err != CONTACTS_ERROR_NO_DATA) {
-      LOG_ERR("HandleFindResults: iterator error");
+      LOG_ERR("AggregateRecords: iterator error");
       return CONTACTS_ERROR_DB;
     }
   }
-  resp["result"] = picojson::value(result);  // as used in callhistory_api.js
+  return CONTACTS_ERROR_NONE;
+}
+
+// Read the given entries with as few DB queries as possible; the ones which
+// don't exist anymore are left out.
+int FetchRecords(const std::vector<int>& uids, picojson::value::array& result) {
+  for (unsigned int i = 0; i < uids.size(); i += kFetchChunkSize) {
+    unsigned int end = std::min<unsigned int>(i + kFetchChunkSize, uids.size());
+    ScopeGuard<contacts_filter_h> filter;
+    CHK(contacts_filter_create(CALLH_VIEW_URI, &filter));
+    contacts_filter_h* pfilt = &filter;
+    for (unsigned int j = i; j < end; j++) {
+      if (j > i)
+        CHK(contacts_filter_add_operator(*pfilt, CONTACTS_FILTER_OPERATOR_OR));
+      CHK(contacts_filter_add_int(*pfilt, CALLH_ATTR_UID, CONTACTS_MATCH_EQUAL,
+                                  uids[j]));
+    }
+
+    ScopeGuard<contacts_query_h> query;
+    CHK(contacts_query_create(CALLH_VIEW_URI, &query));
+    contacts_query_h* pquery = &query;
+    CHK(contacts_query_set_filter(*pquery, *pfilt));
+
+    ScopeGuard<contacts_list_h> list;
+    int err = contacts_db_get_records_with_query(*pquery, 0, 0, &list);
+    if (err == CONTACTS_ERROR_NO_DATA)
+      continue;
+    CHK(err);
+    contacts_list_h* plist = &list;
+    CHK(SerializeRecords(*plist, result));
+  }
   return CONTACTS_ERROR_NONE;
 }
 
@@ -601,59 +766,7 @@ void NotifyDatabaseChange(const char* view, char* changes, void* user_data) {
     LOG_ERR("CallHistory: invalid notification callback");
     return;
   }
-
-  picojson::value::object out;  // output JSON object
-  picojson::value::array added;  // full records
-  picojson::value::array changed;  // full records
-  picojson::value::array deleted;  // only id's
-
-  char  delim[] = ",:";
-  char* rest;
-  char* chtype  = nullptr;
-  char* chid    = nullptr;
-  int changetype, uid, err = NO_ERROR;
-  bool ins = false;
-
-  chtype = strtok_r(changes, delim, &rest);
-  while (chtype) {
-    changetype = atoi((const char*)chtype);
-    chid = strtok_r(nullptr, delim, &rest);
-    uid = atoi((const char*)chid);
-    switch (changetype) {
-      case CONTACTS_CHANGE_INSERTED:
-        ins = true;
-      case CONTACTS_CHANGE_UPDATED:
-        contacts_record_h record = nullptr;
-        if (check(contacts_db_get_record(CALLH_VIEW_URI, uid, &record))) {
-          picojson::value::object val;
-          if (check(SerializeEntry(record, val))) {
-            if (ins)
-              added.push_back(picojson::value(val));
-            else
-              changed.push_back(picojson::value(val));
-          }
-          contacts_record_destroy(record, true);
-        }
-        break;
-      case CONTACTS_CHANGE_DELETED:
-        deleted.push_back(JsonFromInt(uid));
-        break;
-      default:
-        LOG_ERR("CallHistory: invalid database change: " << chtype);
-        err = DATABASE_ERR;
-        break;
-    }
-    chtype = strtok_r(nullptr, delim, &rest);
-  }
-
-  out["cmd"] = picojson::value("notif");
-  out["errorCode"] = picojson::value(static_cast<double>(err));
-  out["added"]   = picojson::value(added);
-  out["changed"] = picojson::value(changed);
-  out["deleted"] = picojson::value(deleted);
-  picojson::value v(out);
-
-  chi->PostMessage(v.serialize().c_str());
+  chi->RecordChanges(changes);
 }
 
 }  // namespace
@@ -663,6 +776,7 @@ bool CallHistoryInstance::CheckBackend() {
     return true;
   if (check(contacts_connect2())) {
     backendConnected_ = true;
+    RegisterListener();  // without it, getChanges() can only reset
     return true;
   }
   return false;
@@ -678,40 +792,199 @@ bool CallHistoryInstance::ReleaseBackend() {
   return !backendConnected_;
 }
 
-// Register a single native listener for all JS ones; dispatch at JS side.
-int CallHistoryInstance::HandleAddListener() {
-  if (!listenerCount_) {  // Do actual registration only on first request.
-    int err = contacts_db_add_changed_cb_with_info(CALLH_VIEW_URI,
-                                                   NotifyDatabaseChange,
-                                                   this);
-    if (check(err))
-      listenerCount_++;
-    return MapContactErrors(err);
-  }
-  listenerCount_++;
+// A single native listener feeds the change journal and all JS listeners;
+// it stays registered while the backend is connected, since the journal
+// has to cover the time when no JS listener is registered, too.
+int CallHistoryInstance::RegisterListener() {
+  if (listenerRegistered_)
+    return NO_ERROR;
+
+  int version = 0;
+  CHK_MAP(contacts_db_get_current_version(&version));
+  CHK_MAP(contacts_db_add_changed_cb_with_info(CALLH_VIEW_URI,
+                                               NotifyDatabaseChange,
+                                               this));
+  std::lock_guard<std::mutex> lock(journalMutex_);
+  journal_.clear();
+  journalStartVersion_ = version;
+  journalVersion_ = version;
+  listenerRegistered_ = true;
   return NO_ERROR;
 }
 
+int CallHistoryInstance::HandleAddListener() {
+  int err = RegisterListener();
+  if (err == NO_ERROR)
+    listenerCount_++;
+  return err;
+}
+
 int CallHistoryInstance::HandleRemoveListener() {
   if (!listenerCount_) {
     return UNKNOWN_ERR;
   }
   --listenerCount_;
-  if (!listenerCount_) {
-    return UnregisterListener();
-  }
   return NO_ERROR;
 }
 
 int CallHistoryInstance::UnregisterListener() {
+  if (!listenerRegistered_)
+    return NO_ERROR;
+  listenerRegistered_ = false;
   int err = contacts_db_remove_changed_cb_with_info(CALLH_VIEW_URI,
                                                     NotifyDatabaseChange,
                                                     this);
   return MapContactErrors(err);
 }
 
+// Journal the changes, stamped with a new journal version, and notify the
+// JS listeners with the changed records. The notification may come well
+// after the change was committed, so the DB version read now can be one
+// getChanges() already returned; the stamp has to be newer than that.
+void CallHistoryInstance::RecordChanges(char* changes) {
+  std::vector<int> added;
+  std::vector<int> changed;
+  picojson::value::array deleted;  // only id's
+
+  char  delim[] = ",:";
+  char* rest;
+  int err = NO_ERROR;
+
+  int db_version = 0;
+  if (!check(contacts_db_get_current_version(&db_version)))
+    err = DATABASE_ERR;
+
+  int version;
+  {
+    std::lock_guard<std::mutex> lock(journalMutex_);
+    journalVersion_ = std::max(journalVersion_ + 1, db_version);
+    version = journalVersion_;
+    if (journal_.size() >= kMaxJournalSize) {
+      // Too much to be worth a delta; clients have to query again.
+      journal_.clear();
+      journalStartVersion_ = version;
+    }
+
+    char* chtype = strtok_r(changes, delim, &rest);
+    while (chtype) {
+      int changetype = atoi(chtype);
+      char* chid = strtok_r(nullptr, delim, &rest);
+      if (!chid)
+        break;
+      int uid = atoi(chid);
+
+      std::map<int, JournalEntry>::iterator it = journal_.find(uid);
+      if (it == journal_.end()) {
+        JournalEntry entry = { -1, version, false };
+        it = journal_.insert(std::make_pair(uid, entry)).first;
+      }
+      it->second.version = version;
+
+      switch (changetype) {
+        case CONTACTS_CHANGE_INSERTED:
+          it->second.insertedVersion = version;
+          it->second.deleted = false;
+          added.push_back(uid);
+          break;
+        case CONTACTS_CHANGE_UPDATED:
+          changed.push_back(uid);
+          break;
+        case CONTACTS_CHANGE_DELETED:
+          it->second.deleted = true;
+          deleted.push_back(JsonFromInt(uid));
+          break;
+        default:
+          LOG_ERR("CallHistory: invalid database change: " << chtype);
+          err = DATABASE_ERR;
+          break;
+      }
+      chtype = strtok_r(nullptr, delim, &rest);
+    }
+  }
+
+  if (!listenerCount_)
+    return;
+
+  picojson::value::array added_records;  // full records
+  picojson::value::array changed_records;  // full records
+  if (!check(FetchRecords(added, added_records)) ||
+      !check(FetchRecords(changed, changed_records)))
+    err = DATABASE_ERR;
+
+  picojson::value::object out;  // output JSON object
+  out["cmd"] = picojson::value("notif");
+  out["errorCode"] = picojson::value(static_cast<double>(err));
+  out["version"] = JsonFromInt(version);
+  out["added"]   = picojson::value(added_records);
+  out["changed"] = picojson::value(changed_records);
+  out["deleted"] = picojson::value(deleted);
+  SendReply(out);
+}
+
+// Return the entries added, changed and deleted after a given DB version,
+// as recorded in the journal. When the journal doesn't reach back that far,
+// or no version is given, "reset" is set and the client has to query all
+// the entries it needs; the returned version is the one to ask for next.
+int CallHistoryInstance::HandleGetChanges(const picojson::value& input,
+                                          picojson::value::object& reply) {
+  int since = 0;
+  bool have_since = IntFromJson(input.get("version"), &since);
+
+  int version = 0;
+  CHK_MAP(contacts_db_get_current_version(&version));
+
+  std::vector<int> added;
+  std::vector<int> changed;
+  picojson::value::array deleted;
+  bool reset = !have_since || !listenerRegistered_;
+  {
+    std::lock_guard<std::mutex> lock(journalMutex_);
+    // Changes up to the DB version read above may not be journaled yet,
+    // so only the journal version is safe to hand out; a version beyond it
+    // was handed out by an earlier journal.
+    if (listenerRegistered_)
+      version = journalVersion_;
+    if (since < journalStartVersion_ || since > journalVersion_)
+      reset = true;
+    for (std::map<int, JournalEntry>::const_iterator it = journal_.begin();
+         !reset && it != journal_.end(); ++it) {
+      const JournalEntry& entry = it->second;
+      if (entry.version <= since)
+        continue;
+      if (entry.deleted) {
+        if (entry.insertedVersion <= since)  // else it was never seen
+          deleted.push_back(JsonFromInt(it->first));
+      } else if (entry.insertedVersion > since) {
+        added.push_back(it->first);
+      } else {
+        changed.push_back(it->first);
+      }
+    }
+  }
+
+  picojson::value::array added_records;
+  picojson::value::array changed_records;
+  if (!reset) {
+    CHK_MAP(FetchRecords(added, added_records));
+    CHK_MAP(FetchRecords(changed, changed_records));
+  } else {
+    deleted.clear();
+  }
+
+  picojson::value::object result;
+  result["version"] = JsonFromInt(version);
+  result["reset"] = picojson::value(reset);
+  result["added"] = picojson::value(added_records);
+  result["changed"] = picojson::value(changed_records);
+  result["deleted"] = picojson::value(deleted);
+  reply["result"] = picojson::value(result);
+  return NO_ERROR;
+}
+
 // Take a JSON query, translate to contacts query, collect the results, and
-// return a JSON string via the callback.
+// return a JSON string via the callback. Results are fetched and posted in
+// pages, so a long call log doesn't have to be loaded and serialized at once;
+// every page but the last one is posted as a partial reply.
 int CallHistoryInstance::HandleFind(const picojson::value& input,
                                     picojson::value::object& reply) {
   int limit = 0;
@@ -734,27 +1007,124 @@ int CallHistoryInstance::HandleFind(const picojson::value& input,
       asc = true;
   }
 
-  // set up filter
-  ScopeGuard<contacts_filter_h> filter;
+  int sort_id = MapAttrName(sortAttr);
+  if (!sort_id) {
+    LOG_ERR("HandleFind: can't sort by " << sortAttr);
+    return INVALID_VALUES_ERR;
+  }
+
+  // set up the query; the sort order makes the pages consistent
   ScopeGuard<contacts_query_h> query;
-  ScopeGuard<contacts_list_h> list;
-  picojson::value js_filter = input.get("filter");  // object or null
-  if (js_filter.is<picojson::null>()) {
-    CHK_MAP(contacts_db_get_all_records(CALLH_VIEW_URI, offset, \
-                                          limit, &list));
-  } else {
-    bool filter_empty = true;
-    CHK_MAP(contacts_filter_create(CALLH_VIEW_URI, &filter));
-    contacts_filter_h* pfilt = &filter;
-    CHK_MAP(ParseFilter(*pfilt, js_filter, CALLH_FILTER_NONE, filter_empty));
-    CHK_MAP(contacts_query_create(CALLH_VIEW_URI, &query));
-    contacts_query_h* pquery = &query;
-    CHK_MAP(contacts_query_set_filter(*pquery, *pfilt));
-    CHK_MAP(contacts_query_set_sort(*pquery, MapAttrName(sortAttr), asc));
-    CHK_MAP(contacts_db_get_records_with_query(*pquery, offset, limit, &list));
+  CHK_MAP(contacts_query_create(CALLH_VIEW_URI, &query));
+  contacts_query_h* pquery = &query;
+  CHK_MAP(SetQueryFilter(*pquery, input.get("filter")));
+  CHK_MAP(contacts_query_set_sort(*pquery, sort_id, asc));
+
+  picojson::value::array result;
+  int fetched = 0;
+  while (true) {
+    int page = kFindPageSize;
+    if (limit > 0)
+      page = std::min(page, limit - fetched);
+
+    // A page already posted as partial must not be sent again as the last.
+    result.clear();
+
+    ScopeGuard<contacts_list_h> list;
+    int err = contacts_db_get_records_with_query(*pquery, offset + fetched,
+                                                 page, &list);
+    if (err == CONTACTS_ERROR_NO_DATA)
+      break;  // the previous page was the last one
+    CHK_MAP(err);
+
+    contacts_list_h* plist = &list;
+    CHK_MAP(SerializeRecords(*plist, result));
+    fetched += result.size();
+    if (static_cast<int>(result.size()) < page ||
+        (limit > 0 && fetched >= limit))
+      break;
+
+    picojson::value::object partial(reply);
+    partial["partial"] = picojson::value(true);
+    partial["errorCode"] = picojson::value(static_cast<double>(NO_ERROR));
+    partial["result"] = picojson::value(result);
+    SendReply(partial);
+  }
+
+  reply["result"] = picojson::value(result);  // the last page
+  return NO_ERROR;
+}
+
+// Compute call count and duration statistics of the entries matching a
+// filter, optionally grouped by remote party, direction or (local) day.
+// Only the attributes needed are read from the DB, and only the statistics
+// are sent back, e.g.
+// { "count":12, "totalDuration":3620, "minDuration":0, "maxDuration":1800,
+//   "groups":[ { "key":"DIALED", "count":5, ... }, ... ] }
+int CallHistoryInstance::HandleAggregate(const picojson::value& input,
+                                         picojson::value::object& reply) {
+  GroupBy group_by = GROUP_NONE;
+  picojson::value js_group = input.get("groupBy");
+  if (!js_group.is<picojson::null>()) {
+    std::string attr = js_group.to_str();
+    if (attr == kRemoteParties || attr == kRemoteParty)
+      group_by = GROUP_REMOTE_PARTY;
+    else if (attr == kCallDirection)
+      group_by = GROUP_DIRECTION;
+    else if (attr == "day")
+      group_by = GROUP_DAY;
+    else
+      return INVALID_VALUES_ERR;
+  }
+
+  // the duration, and the grouping attribute if any
+  unsigned int projection[2] = { CALLH_ATTR_DURATION, 0 };
+  int projected = 1;
+  if (group_by == GROUP_REMOTE_PARTY)
+    projection[projected++] = CALLH_ATTR_ADDRESS;
+  else if (group_by == GROUP_DIRECTION)
+    projection[projected++] = CALLH_ATTR_DIRECTION;
+  else if (group_by == GROUP_DAY)
+    projection[projected++] = CALLH_ATTR_STARTTIME;
+
+  ScopeGuard<contacts_query_h> query;
+  CHK_MAP(contacts_query_create(CALLH_VIEW_URI, &query));
+  contacts_query_h* pquery = &query;
+  CHK_MAP(SetQueryFilter(*pquery, input.get("filter")));
+  CHK_MAP(contacts_query_set_projection(*pquery, projection, projected));
+  CHK_MAP(contacts_query_set_sort(*pquery, CALLH_ATTR_UID, true));
+
+  CallStats all;
+  std::map<std::string, CallStats> groups;
+  for (int offset = 0; ; offset += kFindPageSize) {
+    ScopeGuard<contacts_list_h> list;
+    int err = contacts_db_get_records_with_query(*pquery, offset,
+                                                 kFindPageSize, &list);
+    if (err == CONTACTS_ERROR_NO_DATA)
+      break;
+    CHK_MAP(err);
+
+    unsigned int count = 0;
+    contacts_list_h* plist = &list;
+    CHK_MAP(AggregateRecords(*plist, group_by, all, groups, &count));
+    if (count < static_cast<unsigned int>(kFindPageSize))
+      break;
+  }
+
+  picojson::value::object result;
+  all.Serialize(result);
+  if (group_by != GROUP_NONE) {
+    picojson::value::array js_groups;
+    for (std::map<std::string, CallStats>::const_iterator it = groups.begin();
+         it != groups.end(); ++it) {
+      picojson::value::object group;
+      group["key"] = picojson::value(it->first);
+      it->second.Serialize(group);
+      js_groups.push_back(picojson::value(group));
+    }
+    result["groups"] = picojson::value(js_groups);
   }
-  contacts_list_h* plist = &list;
-  CHK_MAP(HandleFindResults(*plist, reply));
+  reply["result"] = picojson::value(result);
   return NO_ERROR;
 }
 
@@ -775,73 +1145,101 @@ int CallHistoryInstance::HandleRemoveBatch(const picojson::value& msg) {
     return TYPE_MISMATCH_ERR;
   }
 
-  picojson::array json_arr = arr.get<picojson::array>();
-  int id;
-  int count = json_arr.size();
-  std::unique_ptr<int[]> ids(new int[count]);
-  #if !NODEBUG
-    std::ostringstream uidlist;
-    uidlist.str("");
-  #endif
-
-  for (int i = 0, j = 0; i < count; i++) {
-      picojson::value v = json_arr[i];
-      if (IntFromJson(v, &id)) {
-        ids[j++] = id;
-        #if !NODEBUG
-          uidlist << id << ", ";
-        #endif
-      } else {
-        return TYPE_MISMATCH_ERR;
-      }
+  const picojson::array& json_arr = arr.get<picojson::array>();
+  std::vector<int> ids;
+  ids.reserve(json_arr.size());
+  for (unsigned int i = 0; i < json_arr.size(); i++) {
+    int id;
+    if (!IntFromJson(json_arr[i], &id))
+      return TYPE_MISMATCH_ERR;
+    ids.push_back(id);
   }
 
-  int err = contacts_db_delete_records(CALLH_VIEW_URI, ids, count);
-  return MapContactErrors(err);
+  for (unsigned int i = 0; i < ids.size(); i += kDeleteChunkSize) {
+    int count = std::min<unsigned int>(kDeleteChunkSize, ids.size() - i);
+    CHK_MAP(contacts_db_delete_records(CALLH_VIEW_URI, &ids[i], count));
+  }
+  return NO_ERROR;
 }
 
 // Tizen Contacts server API doesn't expose any method for removing all
-// elements in one operation. Need to fetch all the records, fetch id's
-// and remove them one by one, or in batches
-int CallHistoryInstance::HandleRemoveAll(const picojson::value& msg) {
-  contacts_record_h rec  = nullptr;  // should not be destroyed by us;
-  ScopeGuard<contacts_list_h> list;
-  contacts_list_h *plist;
-  int limit = 200;  // initial batch size
-  unsigned int count, i, j;
-  #if !NODEBUG
-    std::ostringstream uidlist;
-    uidlist.str("");
-  #endif
-
-  do {  // remove batches until done
-    CHK_MAP(contacts_list_create(&list));
-    CHK_MAP(contacts_db_get_all_records(CALLH_VIEW_URI, 0, limit, &list));
-    plist = &list;
-    CHK_MAP(contacts_list_get_count(*plist, &count));
-    if (!count) {
-      return NO_ERROR;
+// elements in one operation. Resolve the id's of the entries matching the
+// (optional) filter natively, reading only the id's, and remove them in
+// chunks; each chunk is removed in one DB transaction. For large removals,
+// progress is posted as partial replies after every chunk.
+int CallHistoryInstance::HandleRemoveAll(const picojson::value& msg,
+                                         picojson::value::object& reply) {
+  ScopeGuard<contacts_query_h> query;
+  CHK_MAP(contacts_query_create(CALLH_VIEW_URI, &query));
+  contacts_query_h* pquery = &query;
+
+  // A filter matching nothing the DB knows must not turn into removing
+  // every entry; only removeAll() comes without one.
+  picojson::value js_filter = msg.get("filter");
+  if (!js_filter.is<picojson::null>()) {
+    bool filter_empty = true;
+    ScopeGuard<contacts_filter_h> filter;
+    CHK_MAP(contacts_filter_create(CALLH_VIEW_URI, &filter));
+    contacts_filter_h* pfilt = &filter;
+    CHK_MAP(ParseFilter(*pfilt, js_filter, CALLH_FILTER_NONE, filter_empty));
+    if (filter_empty) {
+      LOG_ERR("HandleRemoveAll: empty filter");
+      return INVALID_VALUES_ERR;
     }
+    CHK_MAP(contacts_query_set_filter(*pquery, *pfilt));
+  }
+
+  unsigned int projection[] = { CALLH_ATTR_UID };
+  CHK_MAP(contacts_query_set_projection(*pquery, projection, 1));
+
+  int total = 0;
+  CHK_MAP(contacts_db_get_count_with_query(*pquery, &total));
+
+  int removed = 0;
+  std::vector<int> ids;
+  ids.reserve(kDeleteChunkSize);
+  while (removed < total) {
+    // Removed entries drop out of the query, so always read the first ones.
+    ScopeGuard<contacts_list_h> list;
+    int err = contacts_db_get_records_with_query(*pquery, 0,
+                                                 kDeleteChunkSize, &list);
+    if (err == CONTACTS_ERROR_NO_DATA)
+      break;
+    CHK_MAP(err);
 
-    // now we have an array of id's to be removed
-    std::unique_ptr<int[]> ids(new int[count]);
-    CHK_MAP(contacts_record_create(CALLH_VIEW_URI, &rec));
-    CHK_MAP(contacts_list_first(*plist));
+    contacts_list_h* plist = &list;
+    unsigned int count = 0;
+    CHK_MAP(contacts_list_get_count(*plist, &count));
+    if (!count)
+      break;
 
-    for (i = 0, j = 0; i < count; i++) {
+    ids.clear();
+    for (unsigned int i = 0; i < count; i++) {
+      contacts_record_h rec = nullptr;  // owned by the list
       CHK_MAP(contacts_list_get_current_record_p(*plist, &rec));
-      int id = -1;  // fetch the id from each record
-      CHK_MAP(contacts_record_get_int(rec, CALLH_ATTR_UID , &id));
-      if (id >= 0) {
-        ids[j++] = id;
-        #if !NODEBUG
-          uidlist << id << ", ";
-        #endif
-      }
+      int id = -1;
+      CHK_MAP(contacts_record_get_int(rec, CALLH_ATTR_UID, &id));
+      if (id >= 0)
+        ids.push_back(id);
       if (!check(contacts_list_next(*plist)))
         break;
     }
-    CHK_MAP(contacts_db_delete_records(CALLH_VIEW_URI, ids, j));
-  } while (count == static_cast<unsigned int>(limit));
+    if (ids.empty())
+      break;
+
+    CHK_MAP(contacts_db_delete_records(CALLH_VIEW_URI, &ids[0], ids.size()));
+    removed += ids.size();
+
+    if (removed < total) {
+      picojson::value::object progress;
+      progress["removed"] = JsonFromInt(removed);
+      progress["total"] = JsonFromInt(total);
+      picojson::value::object partial(reply);
+      partial["partial"] = picojson::value(true);
+      partial["errorCode"] = picojson::value(static_cast<double>(NO_ERROR));
+      partial["progress"] = picojson::value(progress);
+      SendReply(partial);
+    }
+  }
   return NO_ERROR;
 }
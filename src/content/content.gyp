@@ -13,12 +13,22 @@
       },
       'sources': [
         'content_api.js',
+        'content_arena.cc',
+        'content_arena.h',
+        'content_cache.cc',
+        'content_cache.h',
+        'content_directory_scanner.cc',
+        'content_directory_scanner.h',
         'content_extension.cc',
         'content_extension.h',
         'content_filter.cc',
         'content_filter.h',
         'content_instance.cc',
         'content_instance.h',
+        'content_search_index.cc',
+        'content_search_index.h',
+        'content_thumbnail_queue.cc',
+        'content_thumbnail_queue.h',
       ],
       'includes': [
         '../common/pkg-config.gypi',
@@ -14,6 +14,7 @@ function postMessage(msg, callback) {
   _callbacks[replyId] = callback;
   msg.replyId = replyId;
   extension.postMessage(JSON.stringify(msg));
+  return replyId;
 }
 
 function sendSyncMessage(msg) {
@@ -37,7 +38,9 @@ extension.setMessageListener(function(msg) {
   } else if (typeof(callback) === 'function') {
     callback(m);
     delete m.replyId;
-    delete _callbacks[replyId];
+    // Streaming requests keep their callback until the final reply.
+    if (!m.keepCallback)
+      delete _callbacks[replyId];
   } else {
     console.log('Invalid replyId from Tizen Content API: ' + replyId);
   }
@@ -148,11 +151,13 @@ ContentManager.prototype.updateBatch = function(content, onsuccess, onerror) {
     cmd: 'ContentManager.updateBatch',
     content: content
   }, function(result) {
+    // Per-item results ({id, status}) are passed as an extra argument. The
+    // batch is best-effort: an item whose restore failed stays UPDATED.
     if (result.isError) {
       if (onerror)
-        onerror(new tizen.WebAPIError(result.errorCode));
+        onerror(new tizen.WebAPIError(result.errorCode), result.results);
     } else if (onsuccess) {
-      onsuccess();
+      onsuccess(result.value);
     }
   });
 };
@@ -270,6 +275,73 @@ ContentManager.prototype.scanFile = function(contentURI, onsuccess, onerror) {
   });
 };
 
+ContentManager.prototype.scanDirectory = function(directoryURI, onsuccess, onerror, onprogress) {
+  if (!xwalk.utils.validateArguments('s?fff', arguments)) {
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+  }
+
+  // Progress and the final result carry {found, skipped, imported, failed, total}.
+  return postMessage({
+    cmd: 'ContentManager.scanDirectory',
+    directoryURI: directoryURI
+  }, function(result) {
+    if (result.isError) {
+      if (onerror)
+        onerror(new tizen.WebAPIError(result.errorCode));
+    } else if (result.keepCallback) {
+      if (onprogress)
+        onprogress(result.value);
+    } else if (onsuccess) {
+      onsuccess(directoryURI, result.value);
+    }
+  });
+};
+
+ContentManager.prototype.cancelScanDirectory = function(requestId) {
+  if (!xwalk.utils.validateArguments('n', arguments)) {
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+  }
+
+  extension.postMessage(JSON.stringify({
+    cmd: 'ContentManager.cancelScanDirectory',
+    requestId: requestId
+  }));
+};
+
+ContentManager.prototype.requestThumbnails = function(ids, onthumbnail, onerror, priority) {
+  if (!xwalk.utils.validateArguments('of?fn', arguments)) {
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+  }
+
+  // Higher priority requests (e.g. visible items) are generated first.
+  return postMessage({
+    cmd: 'ContentManager.requestThumbnails',
+    ids: ids,
+    priority: priority || 0
+  }, function(result) {
+    if (!result.value)
+      return;
+    if (result.value.errorCode !== undefined) {
+      if (onerror)
+        onerror(new tizen.WebAPIError(result.value.errorCode), result.value.id);
+    } else {
+      onthumbnail(result.value.id, result.value.thumbnailURI);
+    }
+  });
+};
+
+ContentManager.prototype.cancelThumbnails = function(requestId) {
+  if (!xwalk.utils.validateArguments('n', arguments)) {
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+  }
+
+  delete _callbacks[requestId];
+  extension.postMessage(JSON.stringify({
+    cmd: 'ContentManager.cancelThumbnails',
+    requestId: requestId
+  }));
+};
+
 ContentManager.prototype.setChangeListener = function(listener) {
   if (!xwalk.utils.validateArguments('o', arguments)) {
     throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
@@ -0,0 +1,85 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/content_arena.h"
+
+#include <string.h>
+
+#include <string>
+
+namespace {
+
+const size_t kBlockSize = 16 * 1024;
+
+// Strings bigger than this get a block of their own instead of wasting the
+// rest of the current one.
+const size_t kLargeString = kBlockSize / 4;
+
+}  // namespace
+
+size_t ContentArena::StringHash::operator()(const char* str) const {
+  // FNV-1a
+  size_t hash = 2166136261u;
+  for (; *str; ++str)
+    hash = (hash ^ static_cast<unsigned char>(*str)) * 16777619u;
+  return hash;
+}
+
+bool ContentArena::StringEqual::operator()(const char* a,
+                                           const char* b) const {
+  return strcmp(a, b) == 0;
+}
+
+ContentArena::ContentArena()
+    : cursor_(NULL),
+      left_(0) {
+}
+
+ContentArena::~ContentArena() {
+  for (unsigned i = 0; i < blocks_.size(); ++i)
+    delete[] blocks_[i];
+}
+
+const char* ContentArena::Intern(const char* str) {
+  if (!str || !*str)
+    return "";
+  return Intern(str, strlen(str));
+}
+
+const char* ContentArena::Intern(const std::string& str) {
+  if (str.empty())
+    return "";
+  return Intern(str.c_str(), str.size());
+}
+
+const char* ContentArena::Intern(const char* str, size_t length) {
+  std::unordered_set<const char*, StringHash, StringEqual>::const_iterator it =
+      strings_.find(str);
+  if (it != strings_.end())
+    return *it;
+
+  char* copy = Allocate(length + 1);
+  memcpy(copy, str, length + 1);
+  strings_.insert(copy);
+  return copy;
+}
+
+char* ContentArena::Allocate(size_t size) {
+  if (size > kLargeString) {
+    char* block = new char[size];
+    blocks_.push_back(block);
+    return block;
+  }
+
+  if (size > left_) {
+    cursor_ = new char[kBlockSize];
+    left_ = kBlockSize;
+    blocks_.push_back(cursor_);
+  }
+
+  char* result = cursor_;
+  cursor_ += size;
+  left_ -= size;
+  return result;
+}
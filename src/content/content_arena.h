@@ -0,0 +1,48 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_CONTENT_ARENA_H_
+#define CONTENT_CONTENT_ARENA_H_
+
+#include <stddef.h>
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "common/utils.h"
+
+// Bump allocator for the strings of a single request. Strings are interned,
+// so values repeated across many items (types, MIME types, albums, artists)
+// are stored once and cost a pointer per item. Everything is released at
+// once when the arena goes away.
+class ContentArena {
+ public:
+  ContentArena();
+  ~ContentArena();
+
+  // Both return "" for NULL or empty input.
+  const char* Intern(const char* str);
+  const char* Intern(const std::string& str);
+
+ private:
+  struct StringHash {
+    size_t operator()(const char* str) const;
+  };
+  struct StringEqual {
+    bool operator()(const char* a, const char* b) const;
+  };
+
+  const char* Intern(const char* str, size_t length);
+  char* Allocate(size_t size);
+
+  std::vector<char*> blocks_;
+  char* cursor_;
+  size_t left_;
+  std::unordered_set<const char*, StringHash, StringEqual> strings_;
+
+  DISALLOW_COPY_AND_ASSIGN(ContentArena);
+};
+
+#endif  // CONTENT_CONTENT_ARENA_H_
@@ -0,0 +1,509 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/content_cache.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <string>
+
+namespace {
+
+const std::string STR_DIRECTORY_ID("directoryId");
+const std::string STR_FILTER("filter");
+const std::string STR_FILTERS("filters");
+const std::string STR_OFFSET("offset");
+const std::string STR_COUNT("count");
+
+// Fewer dead rows aren't worth moving the others for.
+const unsigned kMinDeadRowsToCompact = 64;
+
+std::string GetDirectoryOfPath(const std::string& path) {
+  std::string::size_type pos = path.rfind('/');
+  if (pos == std::string::npos)
+    return std::string();
+  return path.substr(0, pos);
+}
+
+// JSON.stringify() turns a JS Date into an ISO 8601 string, but accept
+// milliseconds since the epoch as well.
+bool ParseDateValue(const picojson::value& value, time_t* result) {
+  if (value.is<double>()) {
+    *result = static_cast<time_t>(value.get<double>() / 1000);
+    return true;
+  }
+  if (!value.is<std::string>())
+    return false;
+
+  struct tm tm;
+  memset(&tm, 0, sizeof(tm));
+  if (strptime(value.get<std::string>().c_str(),
+               "%Y-%m-%dT%H:%M:%S", &tm) == NULL)
+    return false;
+  *result = timegm(&tm);
+  return true;
+}
+
+}  // namespace
+
+ContentCacheQuery::ContentCacheQuery()
+    : type(-1),
+      modified_from(std::numeric_limits<time_t>::min()),
+      modified_to(std::numeric_limits<time_t>::max()),
+      text_field(-1),
+      text_prefix(false),
+      offset(0),
+      count(0) {
+}
+
+bool ContentCacheQuery::Parse(const picojson::value& msg) {
+  if (msg.get(STR_DIRECTORY_ID).is<std::string>())
+    folder_id = msg.get(STR_DIRECTORY_ID).get<std::string>();
+  if (msg.get(STR_OFFSET).is<double>())
+    offset = static_cast<unsigned>(msg.get(STR_OFFSET).get<double>());
+  if (msg.get(STR_COUNT).is<double>())
+    count = static_cast<unsigned>(msg.get(STR_COUNT).get<double>());
+
+  const picojson::value& filter = msg.get(STR_FILTER);
+  if (!filter.is<picojson::object>())
+    return true;
+  return ParseFilter(filter);
+}
+
+bool ContentCacheQuery::ParseFilter(const picojson::value& filter) {
+  // CompositeFilter: only intersections narrow down the result.
+  if (filter.contains(STR_FILTERS)) {
+    const picojson::value& filters = filter.get(STR_FILTERS);
+    if (!filters.is<picojson::array>())
+      return false;
+    const picojson::array& list = filters.get<picojson::array>();
+    if (list.size() > 1 && filter.get("type").to_str() != "INTERSECTION")
+      return false;
+    for (picojson::array::const_iterator it = list.begin();
+         it != list.end(); ++it) {
+      if (!it->is<picojson::object>() || !ParseFilter(*it))
+        return false;
+    }
+    return true;
+  }
+
+  std::string attribute_name = filter.get("attributeName").to_str();
+
+  // AttributeRangeFilter
+  if (filter.contains("initialValue") || filter.contains("endValue")) {
+    if (attribute_name != "modifiedDate")
+      return false;
+
+    time_t t;
+    const picojson::value& initial = filter.get("initialValue");
+    if (!initial.is<picojson::null>()) {
+      if (!ParseDateValue(initial, &t))
+        return false;
+      modified_from = std::max(modified_from, t);
+    }
+    const picojson::value& end = filter.get("endValue");
+    if (!end.is<picojson::null>()) {
+      if (!ParseDateValue(end, &t))
+        return false;
+      modified_to = std::min(modified_to, t);
+    }
+    return true;
+  }
+
+  // AttributeFilter
+  std::string match_flag = filter.get("matchFlag").to_str();
+  int field = ContentSearchIndex::FieldFromAttribute(attribute_name);
+  if (field != -1) {
+    if (text_field != -1 ||
+        (match_flag != "CONTAINS" && match_flag != "STARTSWITH"))
+      return false;
+    text_field = field;
+    text = filter.get("matchValue").to_str();
+    text_prefix = match_flag == "STARTSWITH";
+    return true;
+  }
+
+  if (attribute_name != "type" || type != -1 ||
+      (match_flag != "EXACTLY" && match_flag != "FULLSTRING"))
+    return false;
+
+  type = ContentCache::MediaTypeFromString(
+      filter.get("matchValue").to_str());
+  return type != -1;
+}
+
+ContentCache& ContentCache::instance() {
+  static ContentCache instance;
+  return instance;
+}
+
+ContentCache::ContentCache()
+    : loaded_(false),
+      folders_loaded_(false),
+      dead_rows_(0) {
+}
+
+ContentCache::~ContentCache() {
+  Clear();
+}
+
+int ContentCache::MediaTypeFromString(const std::string& type) {
+  if (type == "IMAGE")
+    return MEDIA_TYPE_IMAGE;
+  if (type == "VIDEO")
+    return MEDIA_TYPE_VIDEO;
+  if (type == "AUDIO")
+    return MEDIA_TYPE_AUDIO;
+  if (type == "OTHER")
+    return MEDIA_TYPE_OTHER;
+  return -1;
+}
+
+bool ContentCache::FindItems(const ContentCacheQuery& query,
+                             ContentItemList* list) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!EnsureLoaded())
+    return false;
+
+  uint32_t folder = kNoFolder;
+  if (!query.folder_id.empty()) {
+    for (uint32_t i = 0; i < folders_.size(); ++i) {
+      if (folders_[i].id() == query.folder_id) {
+        folder = i;
+        break;
+      }
+    }
+    // Unknown directory, nothing can match.
+    if (folder == kNoFolder)
+      return true;
+  }
+
+  // A text match narrows the rows down through the search index first.
+  std::vector<uint32_t> candidates;
+  if (query.text_field != -1) {
+    EnableSearchIndex();
+    std::vector<std::string> ids;
+    search_index_.Search(
+        static_cast<ContentSearchIndex::Field>(query.text_field),
+        query.text, query.text_prefix, &ids);
+    for (unsigned i = 0; i < ids.size(); ++i) {
+      std::unordered_map<std::string, uint32_t>::const_iterator it =
+          rows_.find(ids[i]);
+      if (it != rows_.end())
+        candidates.push_back(it->second);
+    }
+    // Same order as an unfiltered scan.
+    std::sort(candidates.begin(), candidates.end());
+  }
+
+  unsigned skipped = 0;
+  unsigned added = 0;
+  uint32_t rows = query.text_field != -1 ? candidates.size() : types_.size();
+  for (uint32_t i = 0; i < rows; ++i) {
+    uint32_t row = query.text_field != -1 ? candidates[i] : i;
+    if (!Matches(query, folder, row))
+      continue;
+    if (skipped < query.offset) {
+      ++skipped;
+      continue;
+    }
+    list->addItem(*items_[row]);
+    if (query.count && ++added == query.count)
+      break;
+  }
+  return true;
+}
+
+bool ContentCache::GetFolders(ContentFolderList* list) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!EnsureLoaded())
+    return false;
+
+  for (unsigned i = 0; i < folders_.size(); ++i)
+    list->addFolder(new ContentFolder(folders_[i]));
+  return true;
+}
+
+bool ContentCache::GetFileStates(
+    const std::string& dir,
+    std::unordered_map<std::string, FileState>* files) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!EnsureLoaded())
+    return false;
+
+  const std::string prefix =
+      !dir.empty() && dir[dir.size() - 1] == '/' ? dir : dir + "/";
+  for (uint32_t row = 0; row < paths_.size(); ++row) {
+    if (!items_[row] || paths_[row].compare(0, prefix.size(), prefix) != 0)
+      continue;
+    FileState& state = (*files)[paths_[row]];
+    state.modified = modified_[row];
+    state.size = items_[row]->size();
+  }
+  return true;
+}
+
+void ContentCache::OnMediaChanged(media_content_db_update_type_e update_type,
+                                  const char* uuid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Nothing to keep current until the first query loads the cache.
+  if (!loaded_)
+    return;
+
+  // Some notifications (e.g. a whole storage being scanned) carry no id,
+  // the only safe option then is to reload lazily.
+  if (!uuid) {
+    Clear();
+    return;
+  }
+
+  if (update_type == MEDIA_CONTENT_DELETE) {
+    std::unordered_map<std::string, uint32_t>::iterator it = rows_.find(uuid);
+    if (it != rows_.end())
+      RemoveRow(it->second);
+    return;
+  }
+
+  media_info_h handle = NULL;
+  if (media_info_get_media_from_db(uuid, &handle)
+      != MEDIA_CONTENT_ERROR_NONE || !handle) {
+    std::cerr << "ContentCache: can't get media " << uuid << std::endl;
+    return;
+  }
+  SetRow(handle);
+  media_info_destroy(handle);
+}
+
+void ContentCache::UpdateItem(media_info_h handle) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (loaded_)
+    SetRow(handle);
+}
+
+void ContentCache::OnFolderChanged() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  folders_loaded_ = false;
+}
+
+void ContentCache::Invalidate() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  search_index_.Save();
+  Clear();
+}
+
+std::string ContentCache::GetStorageDirectory() {
+  std::string base;
+  const char* xdg_cache = getenv("XDG_CACHE_HOME");
+  if (xdg_cache && *xdg_cache) {
+    base = xdg_cache;
+  } else {
+    const char* home = getenv("HOME");
+    base = std::string(home ? home : "/tmp") + "/.cache";
+  }
+
+  std::string dir = base + "/tizen-content";
+  mkdir(base.c_str(), 0700);
+  if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)
+    std::cerr << "Can't create " << dir << std::endl;
+  return dir;
+}
+
+bool ContentCache::EnsureLoaded() {
+  if (!folders_loaded_) {
+    if (!LoadFolders())
+      return false;
+    ReindexFolders();
+  }
+  if (loaded_)
+    return true;
+
+  if (media_info_foreach_media_from_db(NULL, MediaInfoCallback, this)
+      != MEDIA_CONTENT_ERROR_NONE) {
+    std::cerr << "ContentCache: media_info_foreach_media_from_db error"
+        << std::endl;
+    Clear();
+    return false;
+  }
+  loaded_ = true;
+  // Rows were (re)loaded; drop documents of items that went away meanwhile.
+  if (search_index_.enabled())
+    search_index_.Retain(rows_);
+  return true;
+}
+
+void ContentCache::EnableSearchIndex() {
+  if (search_index_.enabled())
+    return;
+
+  // Bring the copy saved by a previous session up to date. Unchanged
+  // documents are cheap to revisit.
+  search_index_.Enable(GetStorageDirectory() + "/search.idx");
+  for (uint32_t row = 0; row < items_.size(); ++row) {
+    if (items_[row])
+      search_index_.Update(*items_[row]);
+  }
+  search_index_.Retain(rows_);
+  search_index_.Save();
+}
+
+bool ContentCache::LoadFolders() {
+  folders_.clear();
+  folder_index_.clear();
+  if (media_folder_foreach_folder_from_db(NULL, MediaFolderCallback, this)
+      != MEDIA_CONTENT_ERROR_NONE) {
+    std::cerr << "ContentCache: media_folder_foreach_folder_from_db error"
+        << std::endl;
+    return false;
+  }
+  folders_loaded_ = true;
+  return true;
+}
+
+void ContentCache::ReindexFolders() {
+  for (uint32_t row = 0; row < paths_.size(); ++row)
+    item_folders_[row] = FolderIndexForPath(paths_[row]);
+}
+
+void ContentCache::SetRow(media_info_h handle) {
+  ContentItem* item = new ContentItem;
+  item->init(handle);
+  if (item->id().empty()) {
+    delete item;
+    return;
+  }
+
+  std::string path;
+  char* pc = NULL;
+  if (media_info_get_file_path(handle, &pc) == MEDIA_CONTENT_ERROR_NONE && pc) {
+    path = pc;
+    free(pc);
+  }
+  time_t modified = 0;
+  media_info_get_modified_time(handle, &modified);
+  int type = MediaTypeFromString(item->type());
+
+  if (search_index_.enabled())
+    search_index_.Update(*item);
+
+  std::unordered_map<std::string, uint32_t>::iterator it =
+      rows_.find(item->id());
+  if (it != rows_.end()) {
+    uint32_t row = it->second;
+    delete items_[row];
+    items_[row] = item;
+    types_[row] = static_cast<uint8_t>(type);
+    item_folders_[row] = FolderIndexForPath(path);
+    modified_[row] = modified;
+    paths_[row] = path;
+    return;
+  }
+
+  rows_[item->id()] = static_cast<uint32_t>(items_.size());
+  items_.push_back(item);
+  types_.push_back(static_cast<uint8_t>(type));
+  item_folders_.push_back(FolderIndexForPath(path));
+  modified_.push_back(modified);
+  paths_.push_back(path);
+}
+
+void ContentCache::RemoveRow(uint32_t row) {
+  if (search_index_.enabled())
+    search_index_.Remove(items_[row]->id());
+  rows_.erase(items_[row]->id());
+  delete items_[row];
+  items_[row] = NULL;
+  paths_[row].clear();
+  ++dead_rows_;
+  CompactIfSparse();
+}
+
+void ContentCache::CompactIfSparse() {
+  if (dead_rows_ < kMinDeadRowsToCompact || dead_rows_ * 2 <= items_.size())
+    return;
+
+  uint32_t live = 0;
+  for (uint32_t row = 0; row < items_.size(); ++row) {
+    if (!items_[row])
+      continue;
+    if (row != live) {
+      items_[live] = items_[row];
+      types_[live] = types_[row];
+      item_folders_[live] = item_folders_[row];
+      modified_[live] = modified_[row];
+      paths_[live].swap(paths_[row]);
+      rows_[items_[live]->id()] = live;
+    }
+    ++live;
+  }
+  items_.resize(live);
+  types_.resize(live);
+  item_folders_.resize(live);
+  modified_.resize(live);
+  paths_.resize(live);
+  dead_rows_ = 0;
+}
+
+void ContentCache::Clear() {
+  for (unsigned i = 0; i < items_.size(); ++i)
+    delete items_[i];
+  items_.clear();
+  types_.clear();
+  item_folders_.clear();
+  modified_.clear();
+  paths_.clear();
+  dead_rows_ = 0;
+  rows_.clear();
+  folders_.clear();
+  folder_index_.clear();
+  loaded_ = false;
+  folders_loaded_ = false;
+}
+
+uint32_t ContentCache::FolderIndexForPath(const std::string& path) const {
+  std::unordered_map<std::string, uint32_t>::const_iterator it =
+      folder_index_.find(GetDirectoryOfPath(path));
+  return it == folder_index_.end() ? kNoFolder : it->second;
+}
+
+bool ContentCache::Matches(const ContentCacheQuery& query, uint32_t folder,
+                           uint32_t row) const {
+  if (!items_[row])
+    return false;
+  if (query.type != -1 && types_[row] != query.type)
+    return false;
+  if (folder != kNoFolder && item_folders_[row] != folder)
+    return false;
+  return modified_[row] >= query.modified_from &&
+      modified_[row] <= query.modified_to;
+}
+
+bool ContentCache::MediaFolderCallback(media_folder_h handle,
+                                       void* user_data) {
+  ContentCache* self = reinterpret_cast<ContentCache*>(user_data);
+
+  char* pc = NULL;
+  if (media_folder_get_path(handle, &pc) != MEDIA_CONTENT_ERROR_NONE || !pc)
+    return true;
+  std::string path(pc);
+  free(pc);
+
+  ContentFolder folder;
+  folder.init(handle);
+  self->folder_index_[path] = static_cast<uint32_t>(self->folders_.size());
+  self->folders_.push_back(folder);
+  return true;
+}
+
+bool ContentCache::MediaInfoCallback(media_info_h handle, void* user_data) {
+  ContentCache* self = reinterpret_cast<ContentCache*>(user_data);
+  self->SetRow(handle);
+  return true;
+}
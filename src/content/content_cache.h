@@ -0,0 +1,141 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_CONTENT_CACHE_H_
+#define CONTENT_CONTENT_CACHE_H_
+
+#include <media_content.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/picojson.h"
+#include "content/content_instance.h"
+#include "content/content_search_index.h"
+
+// The subset of a ContentManager.find request that can be answered from
+// ContentCache: an optional directory, an optional media type, an optional
+// modifiedDate range and an optional CONTAINS/STARTSWITH match on an
+// attribute of ContentSearchIndex, combined with offset/count paging.
+struct ContentCacheQuery {
+  ContentCacheQuery();
+
+  // Returns false if |msg| has a filter the cache does not understand. The
+  // caller should then fall back to a DB query.
+  bool Parse(const picojson::value& msg);
+
+  std::string folder_id;
+  int type;  // -1 for any type, a ContentCache::MediaType otherwise.
+  time_t modified_from;
+  time_t modified_to;
+  int text_field;  // -1 for none, a ContentSearchIndex::Field otherwise.
+  std::string text;
+  bool text_prefix;
+  unsigned offset;
+  unsigned count;  // 0 for unlimited.
+
+ private:
+  bool ParseFilter(const picojson::value& filter);
+};
+
+// Process-wide index of the media DB. It is filled lazily on first use and
+// then kept current from the media content change notifications, so common
+// find() and getDirectories() calls do not hit the DB.
+//
+// Items are stored column-wise: the small columns scanned by queries (type,
+// folder, modification time) are packed arrays, and the full ContentItem is
+// only touched for rows that match.
+class ContentCache {
+ public:
+  enum MediaType {
+    MEDIA_TYPE_IMAGE = 0,
+    MEDIA_TYPE_VIDEO,
+    MEDIA_TYPE_AUDIO,
+    MEDIA_TYPE_OTHER,
+  };
+
+  struct FileState {
+    time_t modified;
+    uint64_t size;
+  };
+
+  static ContentCache& instance();
+
+  // Both return false if the cache could not be loaded from the DB.
+  bool FindItems(const ContentCacheQuery& query, ContentItemList* list);
+  bool GetFolders(ContentFolderList* list);
+  // Modification time and size of every indexed file under |dir|.
+  bool GetFileStates(const std::string& dir,
+                     std::unordered_map<std::string, FileState>* files);
+
+  // Change notification handlers.
+  void OnMediaChanged(media_content_db_update_type_e update_type,
+                      const char* uuid);
+  void OnFolderChanged();
+
+  // Refreshes an item from a handle the caller just wrote to the DB.
+  void UpdateItem(media_info_h handle);
+
+  // Drops everything, e.g. when the DB connection goes away and change
+  // notifications stop.
+  void Invalidate();
+
+  static int MediaTypeFromString(const std::string& type);
+
+  // Directory for data kept across sessions, created if needed.
+  static std::string GetStorageDirectory();
+
+ private:
+  static const uint32_t kNoFolder = 0xffffffff;
+
+  ContentCache();
+  ~ContentCache();
+
+  // The following expect |mutex_| to be held.
+  bool EnsureLoaded();
+  void EnableSearchIndex();
+  bool LoadFolders();
+  void ReindexFolders();
+  void SetRow(media_info_h handle);
+  // Only marks |row| dead, so the rows keep the order they were loaded in
+  // and offset/count paging stays stable.
+  void RemoveRow(uint32_t row);
+  // Drops the dead rows once at least half of them are.
+  void CompactIfSparse();
+  void Clear();
+  uint32_t FolderIndexForPath(const std::string& path) const;
+  bool Matches(const ContentCacheQuery& query, uint32_t folder,
+               uint32_t row) const;
+
+  static bool MediaFolderCallback(media_folder_h handle, void* user_data);
+  static bool MediaInfoCallback(media_info_h handle, void* user_data);
+
+  std::mutex mutex_;
+  bool loaded_;
+  bool folders_loaded_;
+
+  // Folder table, and folder path -> index into it.
+  std::vector<ContentFolder> folders_;
+  std::unordered_map<std::string, uint32_t> folder_index_;
+
+  // Item columns, all indexed by row. Dead rows have no item.
+  std::vector<uint8_t> types_;
+  std::vector<uint32_t> item_folders_;
+  std::vector<time_t> modified_;
+  std::vector<std::string> paths_;
+  std::vector<ContentItem*> items_;
+  unsigned dead_rows_;
+
+  // Media id -> row.
+  std::unordered_map<std::string, uint32_t> rows_;
+
+  // Built on the first text search and maintained from then on.
+  ContentSearchIndex search_index_;
+};
+
+#endif  // CONTENT_CONTENT_CACHE_H_
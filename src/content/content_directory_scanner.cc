@@ -0,0 +1,301 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/content_directory_scanner.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "content/content_instance.h"
+
+namespace {
+
+const unsigned kInsertBatchSize = 100;
+const unsigned kMaxWalkers = 4;
+
+const std::string STR_DIRECTORY_URI("directoryURI");
+
+// Completion state of one media_info_insert_batch_to_db() call. It is
+// shared with the callback so a cancelled scan can stop waiting for it.
+struct BatchCompletion {
+  BatchCompletion() : done(false), error(MEDIA_CONTENT_ERROR_NONE) {}
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done;
+  media_content_error_e error;
+};
+
+// |dir| has no trailing separator but for the root.
+std::string JoinPath(const std::string& dir, const char* name) {
+  if (!dir.empty() && dir[dir.size() - 1] == '/')
+    return dir + name;
+  return dir + "/" + name;
+}
+
+}  // namespace
+
+DirectoryScanner::DirectoryScanner(ContentInstance* instance,
+                                   const picojson::value& msg)
+    : instance_(instance),
+      reply_id_(msg.get("replyId").get<double>()),
+      cancelled_(false),
+      silent_(false),
+      finished_(false),
+      busy_workers_(0),
+      have_index_(false),
+      found_(0),
+      skipped_(0),
+      imported_(0),
+      failed_(0) {
+  static const std::string fileScheme("file://");
+  root_ = msg.get(STR_DIRECTORY_URI).to_str();
+  if (root_.compare(0, fileScheme.size(), fileScheme) == 0)
+    root_ = root_.substr(fileScheme.size());
+  while (root_.size() > 1 && root_[root_.size() - 1] == '/')
+    root_.erase(root_.size() - 1);
+}
+
+DirectoryScanner::~DirectoryScanner() {
+  silent_ = true;
+  Cancel();
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void DirectoryScanner::Start() {
+  thread_ = std::thread(&DirectoryScanner::Run, this);
+}
+
+void DirectoryScanner::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancelled_ = true;
+  cond_.notify_all();
+}
+
+void DirectoryScanner::Run() {
+  struct stat st;
+  if (root_.empty() || stat(root_.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    PostProgress(true, WebApiAPIErrors::NOT_FOUND_ERR);
+    finished_ = true;
+    return;
+  }
+
+  have_index_ = ContentCache::instance().GetFileStates(root_, &indexed_);
+  Walk();
+
+  // New files go to the DB in batches; the media server extracts their
+  // metadata while inserting.
+  for (unsigned i = 0; i < new_files_.size() && !cancelled_;
+       i += kInsertBatchSize) {
+    unsigned end = std::min<unsigned>(i + kInsertBatchSize, new_files_.size());
+    if (InsertBatch(new_files_, i, end)) {
+      imported_ += end - i;
+    } else {
+      // Import what can be imported and report the rest.
+      for (unsigned j = i; j < end && !cancelled_; ++j) {
+        if (ScanFile(new_files_[j].path))
+          ++imported_;
+        else
+          ++failed_;
+      }
+    }
+    PostProgress(false, WebApiAPIErrors::NO_ERROR);
+  }
+
+  // Changed files need a rescan to refresh their metadata.
+  for (unsigned i = 0; i < changed_files_.size() && !cancelled_; ++i) {
+    if (ScanFile(changed_files_[i].path))
+      ++imported_;
+    else
+      ++failed_;
+    if ((i + 1) % kInsertBatchSize == 0)
+      PostProgress(false, WebApiAPIErrors::NO_ERROR);
+  }
+
+  PostProgress(true, cancelled_ ?
+      WebApiAPIErrors::ABORT_ERR : WebApiAPIErrors::NO_ERROR);
+  finished_ = true;
+}
+
+void DirectoryScanner::Walk() {
+  directories_.push_back(root_);
+
+  unsigned count = std::min(kMaxWalkers,
+      std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> walkers;
+  for (unsigned i = 0; i < count; ++i)
+    walkers.push_back(std::thread(&DirectoryScanner::WalkWorker, this));
+  for (unsigned i = 0; i < walkers.size(); ++i)
+    walkers[i].join();
+}
+
+void DirectoryScanner::WalkWorker() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cond_.wait(lock, [this]() {
+      return cancelled_ || !directories_.empty() || busy_workers_ == 0;
+    });
+    if (cancelled_ || directories_.empty())
+      break;
+
+    std::string dir = directories_.front();
+    directories_.pop_front();
+    ++busy_workers_;
+    lock.unlock();
+
+    std::vector<std::string> subdirs;
+    std::vector<FileEntry> new_files;
+    std::vector<FileEntry> changed_files;
+    ReadDirectory(dir, &subdirs, &new_files, &changed_files);
+
+    lock.lock();
+    directories_.insert(directories_.end(), subdirs.begin(), subdirs.end());
+    new_files_.insert(new_files_.end(), new_files.begin(), new_files.end());
+    changed_files_.insert(changed_files_.end(),
+                          changed_files.begin(), changed_files.end());
+    --busy_workers_;
+    cond_.notify_all();
+  }
+}
+
+void DirectoryScanner::ReadDirectory(const std::string& dir,
+                                     std::vector<std::string>* subdirs,
+                                     std::vector<FileEntry>* new_files,
+                                     std::vector<FileEntry>* changed_files) {
+  DIR* handle = opendir(dir.c_str());
+  if (!handle) {
+    std::cerr << "DirectoryScanner: can't open " << dir << std::endl;
+    return;
+  }
+
+  unsigned found = 0;
+  unsigned skipped = 0;
+  struct dirent* ent;
+  while (!cancelled_ && (ent = readdir(handle)) != NULL) {
+    // Hidden entries are ignored by the media server as well.
+    if (ent->d_name[0] == '.')
+      continue;
+
+    std::string path = JoinPath(dir, ent->d_name);
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode)) {
+      subdirs->push_back(path);
+      continue;
+    }
+    // Links to files are followed, links to directories aren't, since one
+    // to an ancestor would keep the scan going forever.
+    if (S_ISLNK(st.st_mode) &&
+        (stat(path.c_str(), &st) != 0 || S_ISDIR(st.st_mode)))
+      continue;
+    if (!S_ISREG(st.st_mode))
+      continue;
+
+    ++found;
+    FileEntry entry = { path, st.st_mtime, static_cast<uint64_t>(st.st_size) };
+    if (!have_index_) {
+      changed_files->push_back(entry);
+      continue;
+    }
+
+    std::unordered_map<std::string, ContentCache::FileState>::const_iterator
+        it = indexed_.find(path);
+    if (it == indexed_.end())
+      new_files->push_back(entry);
+    else if (it->second.modified != entry.modified ||
+             it->second.size != entry.size)
+      changed_files->push_back(entry);
+    else
+      ++skipped;
+  }
+  closedir(handle);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  found_ += found;
+  skipped_ += skipped;
+}
+
+bool DirectoryScanner::InsertBatch(const std::vector<FileEntry>& files,
+                                   unsigned begin, unsigned end) {
+  std::vector<const char*> paths;
+  for (unsigned i = begin; i < end; ++i)
+    paths.push_back(files[i].path.c_str());
+
+  std::shared_ptr<BatchCompletion> completion(new BatchCompletion);
+  std::shared_ptr<BatchCompletion>* user_data =
+      new std::shared_ptr<BatchCompletion>(completion);
+  if (media_info_insert_batch_to_db(&paths[0], paths.size(),
+          OnBatchInserted, user_data) != MEDIA_CONTENT_ERROR_NONE) {
+    std::cerr << "media_info_insert_batch_to_db: error" << std::endl;
+    delete user_data;
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(completion->mutex);
+  while (!completion->done && !cancelled_)
+    completion->cond.wait_for(lock, std::chrono::milliseconds(100));
+  return completion->done &&
+      completion->error == MEDIA_CONTENT_ERROR_NONE;
+}
+
+bool DirectoryScanner::ScanFile(const std::string& path) {
+  int result = media_content_scan_file(path.c_str());
+  if (result != MEDIA_CONTENT_ERROR_NONE) {
+    std::cerr << "media_content_scan_file error:" << result << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void DirectoryScanner::PostProgress(bool final, WebApiAPIErrors error) {
+  if (silent_)
+    return;
+
+  picojson::value::object reply;
+  reply["replyId"] = picojson::value(reply_id_);
+  if (error != WebApiAPIErrors::NO_ERROR) {
+    reply["isError"] = picojson::value(true);
+    reply["errorCode"] = picojson::value(static_cast<double>(error));
+  } else {
+    reply["isError"] = picojson::value(false);
+  }
+  if (!final)
+    reply["keepCallback"] = picojson::value(true);
+
+  picojson::value::object o;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    o["found"] = picojson::value(static_cast<double>(found_));
+    o["skipped"] = picojson::value(static_cast<double>(skipped_));
+  }
+  o["imported"] = picojson::value(static_cast<double>(imported_));
+  o["failed"] = picojson::value(static_cast<double>(failed_));
+  o["total"] = picojson::value(
+      static_cast<double>(new_files_.size() + changed_files_.size()));
+  reply["value"] = picojson::value(o);
+
+  picojson::value v(reply);
+  instance_->PostMessage(v.serialize().c_str());
+}
+
+void DirectoryScanner::OnBatchInserted(media_content_error_e error,
+                                       void* user_data) {
+  std::unique_ptr<std::shared_ptr<BatchCompletion> > holder(
+      reinterpret_cast<std::shared_ptr<BatchCompletion>*>(user_data));
+  BatchCompletion* completion = holder->get();
+
+  std::lock_guard<std::mutex> lock(completion->mutex);
+  completion->done = true;
+  completion->error = error;
+  completion->cond.notify_all();
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_CONTENT_DIRECTORY_SCANNER_H_
+#define CONTENT_CONTENT_DIRECTORY_SCANNER_H_
+
+#include <media_content.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "common/picojson.h"
+#include "content/content_cache.h"
+#include "tizen/tizen.h"
+
+class ContentInstance;
+
+// Imports a directory tree into the media DB for ContentManager.scanDirectory.
+//
+// The tree is walked by a small pool of threads. Files whose modification
+// time and size match what the DB already has are skipped, new files are
+// inserted in batches, and changed files are rescanned one by one so their
+// metadata is extracted again. Progress is posted after every batch.
+class DirectoryScanner {
+ public:
+  DirectoryScanner(ContentInstance* instance, const picojson::value& msg);
+  // Cancels without reporting and waits for the scan thread.
+  ~DirectoryScanner();
+
+  void Start();
+  void Cancel();
+  bool finished() const { return finished_; }
+
+ private:
+  struct FileEntry {
+    std::string path;
+    time_t modified;
+    uint64_t size;
+  };
+
+  void Run();
+  void Walk();
+  void WalkWorker();
+  void ReadDirectory(const std::string& dir,
+                     std::vector<std::string>* subdirs,
+                     std::vector<FileEntry>* new_files,
+                     std::vector<FileEntry>* changed_files);
+  bool InsertBatch(const std::vector<FileEntry>& files,
+                   unsigned begin, unsigned end);
+  bool ScanFile(const std::string& path);
+  void PostProgress(bool final, WebApiAPIErrors error);
+
+  static void OnBatchInserted(media_content_error_e error, void* user_data);
+
+  ContentInstance* instance_;
+  double reply_id_;
+  std::string root_;
+  std::thread thread_;
+  std::atomic<bool> cancelled_;
+  std::atomic<bool> silent_;
+  std::atomic<bool> finished_;
+
+  // Walk state shared by the worker threads.
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::string> directories_;
+  unsigned busy_workers_;
+  std::vector<FileEntry> new_files_;
+  std::vector<FileEntry> changed_files_;
+
+  // What the DB has under |root_|, by path.
+  std::unordered_map<std::string, ContentCache::FileState> indexed_;
+  bool have_index_;
+
+  unsigned found_;
+  unsigned skipped_;
+  unsigned imported_;
+  unsigned failed_;
+};
+
+#endif  // CONTENT_CONTENT_DIRECTORY_SCANNER_H_
@@ -3,18 +3,26 @@
 // found in the LICENSE file.
 
 #include "content/content_instance.h"
+#include "content/content_cache.h"
+#include "content/content_directory_scanner.h"
 #include "content/content_filter.h"
+#include "content/content_thumbnail_queue.h"
 
 #include <media_content.h>
 #include <media_filter.h>
 
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+
 #include "common/picojson.h"
+#include "common/scope_exit.h"
 
 namespace {
 
@@ -25,6 +33,9 @@ const std::string STR_RATING("rating");
 const std::string STR_FILTER("filter");
 const std::string STR_CONTENT_URI("contentURI");
 const std::string STR_EVENT_TYPE("eventType");
+const std::string STR_DIRECTORY_ID("directoryId");
+const std::string STR_OFFSET("offset");
+const std::string STR_COUNT("count");
 
 std::string createUriFromLocalPath(const std::string path) {
   static std::string fileScheme("file://");
@@ -60,9 +71,93 @@ std::string ConvertToJSDateString(const char* date) {
   return std::string(output_date);
 }
 
+void AppendJsonNumber(std::string* out, double value) {
+  // Same format as picojson.
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.17g", value);
+  *out += buf;
+}
+
+void AppendJsonString(std::string* out, const char* str) {
+  out->push_back('"');
+  for (; *str; ++str) {
+    unsigned char c = static_cast<unsigned char>(*str);
+    switch (c) {
+      case '"': *out += "\\\""; break;
+      case '\\': *out += "\\\\"; break;
+      case '\b': *out += "\\b"; break;
+      case '\f': *out += "\\f"; break;
+      case '\n': *out += "\\n"; break;
+      case '\r': *out += "\\r"; break;
+      case '\t': *out += "\\t"; break;
+      default:
+        if (c < 0x20) {
+          char buf[8];
+          snprintf(buf, sizeof(buf), "\\u%04x", c);
+          *out += buf;
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+// Appends the members of one JSON object to a reply being built in place.
+class JsonObjectWriter {
+ public:
+  explicit JsonObjectWriter(std::string* out) : out_(out), first_(true) {
+    out_->push_back('{');
+  }
+
+  void String(const char* key, const char* value) {
+    Key(key);
+    AppendJsonString(out_, value);
+  }
+  // Single element array, used for the multi-valued attributes the CAPI
+  // returns as one string.
+  void StringArray(const char* key, const char* value) {
+    Key(key);
+    out_->push_back('[');
+    AppendJsonString(out_, value);
+    out_->push_back(']');
+  }
+  void Number(const char* key, double value) {
+    Key(key);
+    AppendJsonNumber(out_, value);
+  }
+  void Raw(const char* key, const std::string& json) {
+    Key(key);
+    *out_ += json;
+  }
+  void Close() { out_->push_back('}'); }
+
+ private:
+  void Key(const char* key) {
+    if (!first_)
+      out_->push_back(',');
+    first_ = false;
+    AppendJsonString(out_, key);
+    out_->push_back(':');
+  }
+
+  std::string* out_;
+  bool first_;
+};
+
+std::string EditableAttributesJson() {
+  picojson::value::array attributes;
+  const std::vector<std::string>& names = ContentItem::editable_attributes();
+  for (unsigned i = 0; i < names.size(); i++)
+    attributes.push_back(picojson::value(names[i]));
+  return picojson::value(attributes).serialize();
+}
+
 }  // namespace
 
 unsigned ContentInstance::m_instanceCount = 0;
+std::set<ContentInstance*> ContentInstance::m_listeners;
+std::mutex ContentInstance::m_listenersMutex;
 
 ContentInstance::ContentInstance() {
   ++m_instanceCount;
@@ -70,12 +165,29 @@ ContentInstance::ContentInstance() {
     std::cerr << "media_content_connect: DB connection error" << std::endl;
     return;
   }
+  if (m_instanceCount == 1 &&
+      media_content_set_db_updated_cb(MediaContentChangeCallback, NULL)
+          != MEDIA_CONTENT_ERROR_NONE)
+    std::cerr << "media_content_set_db_updated_cb: error" << std::endl;
 }
 
 ContentInstance::~ContentInstance() {
   assert(m_instanceCount > 0);
+  {
+    std::lock_guard<std::mutex> lock(m_listenersMutex);
+    m_listeners.erase(this);
+  }
+  ThumbnailQueue::instance().CancelAll(this);
+  for (std::map<double, DirectoryScanner*>::iterator it = scanners_.begin();
+       it != scanners_.end(); ++it)
+    delete it->second;
   if (--m_instanceCount > 0)
     return;
+
+  // Change notifications stop with the connection, so the cache can't be
+  // trusted anymore.
+  media_content_unset_db_updated_cb();
+  ContentCache::instance().Invalidate();
   if (media_content_disconnect() != MEDIA_CONTENT_ERROR_NONE)
     std::cerr << "media_discontent_connect: error\n";
 }
@@ -100,8 +212,16 @@ void ContentInstance::HandleMessage(const char* message) {
     HandleFindRequest(v);
   } else if (cmd == "ContentManager.scanFile") {
     HandleScanFileRequest(v);
+  } else if (cmd == "ContentManager.scanDirectory") {
+    HandleScanDirectoryRequest(v);
+  } else if (cmd == "ContentManager.cancelScanDirectory") {
+    HandleCancelScanDirectoryRequest(v);
   } else if (cmd == "ContentManager.updateBatch") {
     HandleUpdateBatchRequest(v);
+  } else if (cmd == "ContentManager.requestThumbnails") {
+    ThumbnailQueue::instance().Request(this, v);
+  } else if (cmd == "ContentManager.cancelThumbnails") {
+    ThumbnailQueue::instance().Cancel(this, v.get("requestId").get<double>());
   } else {
     std::cerr << "Message " + cmd + " is not supported.\n";
   }
@@ -110,11 +230,16 @@ void ContentInstance::HandleMessage(const char* message) {
 void ContentInstance::PostAsyncErrorReply(const picojson::value& msg,
     WebApiAPIErrors error_code) {
   picojson::value::object o;
-  o["isError"] = picojson::value(true);
-  o["errorCode"] = picojson::value(static_cast<double>(error_code));
-  o["replyId"] = picojson::value(msg.get("replyId").get<double>());
+  PostAsyncErrorReply(msg, error_code, o);
+}
+
+void ContentInstance::PostAsyncErrorReply(const picojson::value& msg,
+    WebApiAPIErrors error_code, picojson::value::object& reply) {
+  reply["isError"] = picojson::value(true);
+  reply["errorCode"] = picojson::value(static_cast<double>(error_code));
+  reply["replyId"] = picojson::value(msg.get("replyId").get<double>());
 
-  picojson::value v(o);
+  picojson::value v(reply);
   PostMessage(v.serialize().c_str());
 }
 
@@ -158,9 +283,13 @@ void ContentInstance::HandleSyncMessage(const char* message) {
   int rc = MEDIA_CONTENT_ERROR_INVALID_OPERATION;
 
   if (cmd == "ContentManager.setChangeListener") {
-    rc = media_content_set_db_updated_cb(MediaContentChangeCallback, this);
+    std::lock_guard<std::mutex> lock(m_listenersMutex);
+    m_listeners.insert(this);
+    rc = MEDIA_CONTENT_ERROR_NONE;
   } else if (cmd == "ContentManager.unsetChangeListener") {
-    rc = media_content_unset_db_updated_cb();
+    std::lock_guard<std::mutex> lock(m_listenersMutex);
+    m_listeners.erase(this);
+    rc = MEDIA_CONTENT_ERROR_NONE;
   } else if (cmd == "ContentManager.update") {
     if (HandleUpdateRequest(v.get("content")))
       rc = MEDIA_CONTENT_ERROR_NONE;
@@ -190,6 +319,23 @@ bool ContentInstance::HandleUpdateRequest(const picojson::value& msg) {
     return false;
   }
 
+  bool no_error = ApplyUpdate(handle, msg);
+
+  // Commit the changes to DB
+  if (media_info_update_to_db(handle) != MEDIA_CONTENT_ERROR_NONE) {
+    std::cerr << "media_info_update_to_db: error" << std::endl;
+    no_error = false;
+  } else {
+    // Don't wait for the change notification to refresh our own update.
+    ContentCache::instance().UpdateItem(handle);
+  }
+  media_info_destroy(handle);
+
+  return no_error;
+}
+
+bool ContentInstance::ApplyUpdate(media_info_h handle,
+    const picojson::value& msg) {
   bool no_error = true;
   if (msg.contains(STR_NAME) &&
       media_info_set_display_name(handle,
@@ -216,30 +362,105 @@ bool ContentInstance::HandleUpdateRequest(const picojson::value& msg) {
     }
   }
 
-  // Commit the changes to DB
-  if (media_info_update_to_db(handle) != MEDIA_CONTENT_ERROR_NONE) {
-    std::cerr << "media_info_update_to_db: error" << std::endl;
-    no_error = false;
-  }
-
   return no_error;
 }
 
+// The media content CAPI has no transactions, so the batch is best-effort:
+// every item is fetched and modified in memory first, and only if all of
+// them succeed are they written. When a write fails, the items written
+// before it are written again from snapshots taken before modification.
+// Those restoring writes can fail too, which the per-item results tell.
 void ContentInstance::HandleUpdateBatchRequest(const picojson::value& msg) {
-  picojson::array list = msg.get("content").get<picojson::array>();
+  const picojson::value& content = msg.get("content");
+  if (!content.is<picojson::array>()) {
+    PostAsyncErrorReply(msg, WebApiAPIErrors::TYPE_MISMATCH_ERR);
+    return;
+  }
+  const picojson::array& list = content.get<picojson::array>();
+
+  std::vector<media_info_h> handles(list.size(), NULL);
+  std::vector<media_info_h> originals(list.size(), NULL);
+  auto release = common::MakeScopeExit([&]() {
+    for (unsigned i = 0; i < list.size(); ++i) {
+      if (handles[i])
+        media_info_destroy(handles[i]);
+      if (originals[i])
+        media_info_destroy(originals[i]);
+    }
+  });
+
+  picojson::array results;
+  int failed = -1;
+
+  // Phase 1: prepare all items without touching the DB.
+  for (unsigned i = 0; i < list.size(); ++i) {
+    const picojson::value& item = list[i];
+    bool ok = item.contains(STR_ID) &&
+        media_info_get_media_from_db(item.get(STR_ID).to_str().c_str(),
+            &handles[i]) == MEDIA_CONTENT_ERROR_NONE &&
+        media_info_clone(&originals[i], handles[i])
+            == MEDIA_CONTENT_ERROR_NONE &&
+        ApplyUpdate(handles[i], item);
+    if (!ok) {
+      failed = i;
+      break;
+    }
+  }
 
-  for (picojson::array::const_iterator i = list.begin(); i != list.end(); ++i) {
-    if (!HandleUpdateRequest((*i))) {
-      PostAsyncErrorReply(msg, WebApiAPIErrors::INVALID_MODIFICATION_ERR);
-      return;
+  // Phase 2: write, restoring the written items on the first failure.
+  unsigned committed = 0;
+  if (failed < 0) {
+    for (; committed < list.size(); ++committed) {
+      if (media_info_update_to_db(handles[committed])
+          != MEDIA_CONTENT_ERROR_NONE) {
+        std::cerr << "media_info_update_to_db: error" << std::endl;
+        failed = committed;
+        break;
+      }
     }
   }
-  PostAsyncSuccessReply(msg);
+
+  std::vector<bool> unrestored(list.size(), false);
+  if (failed >= 0) {
+    for (unsigned i = 0; i < committed; ++i) {
+      if (media_info_update_to_db(originals[i]) != MEDIA_CONTENT_ERROR_NONE) {
+        std::cerr << "media_info_update_to_db: error restoring item " << i
+            << std::endl;
+        unrestored[i] = true;
+      }
+    }
+  }
+
+  for (unsigned i = 0; i < list.size(); ++i) {
+    picojson::value::object o;
+    o[STR_ID] = list[i].get(STR_ID);
+    if (failed < 0 || unrestored[i]) {
+      o["status"] = picojson::value("UPDATED");
+      ContentCache::instance().UpdateItem(handles[i]);
+    } else {
+      o["status"] = picojson::value(
+          static_cast<int>(i) == failed ? "FAILED" : "NOT_UPDATED");
+    }
+    results.push_back(picojson::value(o));
+  }
+
+  if (failed >= 0) {
+    picojson::value::object reply;
+    reply["results"] = picojson::value(results);
+    PostAsyncErrorReply(msg, WebApiAPIErrors::INVALID_MODIFICATION_ERR,
+                        reply);
+    return;
+  }
+
+  picojson::value value(results);
+  PostAsyncSuccessReply(msg, value);
 }
 
 void ContentInstance::HandleGetDirectoriesRequest(const picojson::value& msg) {
   ContentFolderList folderList;
-  if (media_folder_foreach_folder_from_db(NULL,
+  if (ContentCache::instance().GetFolders(&folderList)) {
+    HandleGetDirectoriesReply(msg, &folderList);
+  } else if (media_folder_foreach_folder_from_db(NULL,
           MediaFolderCallback,
           reinterpret_cast<void*>(&folderList)) != MEDIA_CONTENT_ERROR_NONE) {
     std::cerr << "media_folder_foreach_folder_from_db: error" << std::endl;
@@ -291,6 +512,14 @@ void ContentInstance::HandleFindRequest(const picojson::value& msg) {
   ContentItemList itemList;
   filter_h filterHandle = NULL;
 
+  // Directory, type and modifiedDate queries are served from memory.
+  ContentCacheQuery query;
+  if (query.Parse(msg) &&
+      ContentCache::instance().FindItems(query, &itemList)) {
+    HandleFindReply(msg, &itemList);
+    return;
+  }
+
   ContentFilter& filter = ContentFilter::instance();
   if (msg.contains(STR_FILTER)) {
     picojson::value filterValue = msg.get(STR_FILTER);
@@ -303,10 +532,29 @@ void ContentInstance::HandleFindRequest(const picojson::value& msg) {
     }
   }
 
-  if (media_info_foreach_media_from_db(filterHandle,
-      MediaInfoCallback,
-      reinterpret_cast<ContentFolderList*>(&itemList))
-      != MEDIA_CONTENT_ERROR_NONE) {
+  if (msg.get(STR_COUNT).is<double>() &&
+      (filterHandle || media_filter_create(&filterHandle)
+          == MEDIA_CONTENT_ERROR_NONE)) {
+    int offset = msg.get(STR_OFFSET).is<double>() ?
+        static_cast<int>(msg.get(STR_OFFSET).get<double>()) : 0;
+    media_filter_set_offset(filterHandle, offset,
+        static_cast<int>(msg.get(STR_COUNT).get<double>()));
+  }
+
+  int ret;
+  if (msg.get(STR_DIRECTORY_ID).is<std::string>()) {
+    ret = media_folder_foreach_media_from_db(
+        msg.get(STR_DIRECTORY_ID).get<std::string>().c_str(),
+        filterHandle,
+        MediaInfoCallback,
+        reinterpret_cast<ContentFolderList*>(&itemList));
+  } else {
+    ret = media_info_foreach_media_from_db(filterHandle,
+        MediaInfoCallback,
+        reinterpret_cast<ContentFolderList*>(&itemList));
+  }
+
+  if (ret != MEDIA_CONTENT_ERROR_NONE) {
     std::cerr << "media_info_foreach_media_from_db: error" << std::endl;
   } else {
     HandleFindReply(msg, &itemList);
@@ -320,84 +568,70 @@ void ContentInstance::HandleFindRequest(const picojson::value& msg) {
 void ContentInstance::HandleFindReply(
     const picojson::value& msg,
     ContentItemList* itemList) {
-  const std::vector<ContentItem*> &results = itemList->getAllItems();
+  const std::vector<ContentRecord>& results = itemList->getAllItems();
 
-  picojson::value::array items;
+  // Find results can be large, so they are written straight into the reply
+  // rather than being built up as picojson objects first.
+  static const std::string editableAttributes = EditableAttributesJson();
 
-  for (unsigned i = 0; i < results.size(); i++) {
-    ContentItem* item = results[i];
-
-    picojson::value::object o;
+  std::string reply;
+  reply.reserve(64 + results.size() * 512);
+  reply += "{\"isError\":false,\"replyId\":";
+  AppendJsonNumber(&reply, msg.get("replyId").get<double>());
+  reply += ",\"value\":[";
 
-    picojson::value::array editableAttributesJson;
-    std::vector<std::string> editableAttributes = item->editable_attributes();
-    for (unsigned i = 0; i < editableAttributes.size(); i++)
-      editableAttributesJson.push_back(picojson::value(editableAttributes[i]));
-    o["editableAttributes"] = picojson::value(editableAttributesJson);
-    o[STR_ID] = picojson::value(item->id());
-    o[STR_NAME] = picojson::value(item->name());
-    o["type"] = picojson::value(item->type());
-    o["mimeType"] = picojson::value(item->mime_type());
-    o["title"] = picojson::value(item->title());
-    o["contentURI"] = picojson::value(item->content_uri());
-    picojson::value::array uris;
-    uris.push_back(picojson::value(item->thumbnail_uris()));
-    o["thumbnailURIs"] = picojson::value(uris);
-    o["releaseDate"] = picojson::value(item->release_date());
-    o["modifiedDate"] =
-      picojson::value(item->modified_date());
-    o["size"] = picojson::value(static_cast<double>(item->size()));
-    o[STR_DESCRIPTION] = picojson::value(item->description());
-    o[STR_RATING] = picojson::value(static_cast<double>(item->rating()));
-
-    if (item->type() == "AUDIO") {
-      o["album"] = picojson::value(item->album());
-      picojson::value::array genres;
-      genres.push_back(picojson::value(item->genres()));
-      o["genres"] = picojson::value(genres);
-      picojson::value::array artists;
-      artists.push_back(picojson::value(item->artists()));
-      o["artists"] = picojson::value(artists);
-      picojson::value::array composers;
-      composers.push_back(picojson::value(item->composer()));
-      o["composers"] = picojson::value(composers);
-      o["copyright"] = picojson::value(item->copyright());
-      o["bitrate"] = picojson::value(static_cast<double>(item->bitrate()));
-      o["trackNumber"] = picojson::value(
-          static_cast<double>(item->track_number()));
-      o["duration"] = picojson::value(static_cast<double>(item->duration()));
-    } else if (item->type() == "IMAGE") {
-      o["width"] = picojson::value(static_cast<double>(item->width()));
-      o["height"] = picojson::value(static_cast<double>(item->height()));
-      o["orientation"] = picojson::value(item->orientation());
-      o["latitude"] =
-          picojson::value(static_cast<double>(item->latitude()));
-      o["longitude"] =
-          picojson::value(static_cast<double>(item->longitude()));
-    } else if (item->type() == "VIDEO") {
-      o["album"] = picojson::value(item->album());
-      picojson::value::array artists;
-      artists.push_back(picojson::value(item->artists()));
-      o["artists"] = picojson::value(artists);
-      o["duration"] = picojson::value(static_cast<double>(item->duration()));
-      o["width"] = picojson::value(static_cast<double>(item->width()));
-      o["height"] = picojson::value(static_cast<double>(item->height()));
-      o["latitude"] =
-          picojson::value(static_cast<double>(item->latitude()));
-      o["longitude"] =
-          picojson::value(static_cast<double>(item->longitude()));
+  for (unsigned i = 0; i < results.size(); i++) {
+    const ContentRecord& item = results[i];
+    if (i)
+      reply += ',';
+
+    JsonObjectWriter o(&reply);
+    o.Raw("editableAttributes", editableAttributes);
+    o.String("id", item.id);
+    o.String("name", item.name);
+    o.String("type", item.type);
+    o.String("mimeType", item.mime_type);
+    o.String("title", item.title);
+    o.String("contentURI", item.content_uri);
+    o.StringArray("thumbnailURIs", item.thumbnail_uris);
+    o.String("releaseDate", item.release_date);
+    o.String("modifiedDate", item.modified_date);
+    o.Number("size", item.size);
+    o.String("description", item.description);
+    o.Number("rating", item.rating);
+
+    if (!strcmp(item.type, "AUDIO")) {
+      o.String("album", item.album);
+      o.StringArray("genres", item.genres);
+      o.StringArray("artists", item.artists);
+      o.StringArray("composers", item.composer);
+      o.String("copyright", item.copyright);
+      o.Number("bitrate", item.bitrate);
+      o.Number("trackNumber", item.track_number);
+      o.Number("duration", item.duration);
+    } else if (!strcmp(item.type, "IMAGE")) {
+      o.Number("width", item.width);
+      o.Number("height", item.height);
+      o.String("orientation", item.orientation);
+      o.Number("latitude", item.latitude);
+      o.Number("longitude", item.longitude);
+    } else if (!strcmp(item.type, "VIDEO")) {
+      o.String("album", item.album);
+      o.StringArray("artists", item.artists);
+      o.Number("duration", item.duration);
+      o.Number("width", item.width);
+      o.Number("height", item.height);
+      o.Number("latitude", item.latitude);
+      o.Number("longitude", item.longitude);
     }
-
-    picojson::value v(o);
-
-    items.push_back(picojson::value(o));
+    o.Close();
   }
-  picojson::value value(items);
+  reply += "]}";
+
 #ifdef DEBUG_JSON_REPLY
-  std::cout << "JSON reply: " << std::endl <<
-     value.serialize().c_str() << std::endl;
+  std::cout << "JSON reply: " << std::endl << reply << std::endl;
 #endif
-  PostAsyncSuccessReply(msg, value);
+  PostMessage(reply.c_str());
 }
 
 bool ContentInstance::MediaInfoCallback(media_info_h handle, void* user_data) {
@@ -406,11 +640,11 @@ bool ContentInstance::MediaInfoCallback(media_info_h handle, void* user_data) {
 
   ContentItemList* itemList = reinterpret_cast<ContentItemList*>(user_data);
 
-  ContentItem* item = new ContentItem;
-  item->init(handle);
+  ContentItem item;
+  item.init(handle);
   itemList->addItem(item);
 #ifdef DEBUG_ITEM
-  item->print();
+  item.print();
 #endif
   return true;
 }
@@ -430,11 +664,10 @@ void ContentInstance::MediaContentChangeCallback(
       ", item=" << update_item << ", type=" << update_type << ", " <<
       uuid << ", " << path << std::endl;
 #endif
-  if (!user_data)
-    return;
-
-  ContentInstance* self =
-      reinterpret_cast<ContentInstance*>(user_data);
+  if (update_item == MEDIA_ITEM_DIRECTORY)
+    ContentCache::instance().OnFolderChanged();
+  else
+    ContentCache::instance().OnMediaChanged(update_type, uuid);
 
   picojson::value::object om;
   om["replyId"] = picojson::value(static_cast<double>(0));
@@ -460,7 +693,10 @@ void ContentInstance::MediaContentChangeCallback(
   std::cout << "JSON event val: " << value.serialize().c_str() << std::endl;
 #endif
 
-  self->PostAsyncSuccessReply(msg, value);
+  std::lock_guard<std::mutex> lock(m_listenersMutex);
+  for (std::set<ContentInstance*>::iterator it = m_listeners.begin();
+       it != m_listeners.end(); ++it)
+    (*it)->PostAsyncSuccessReply(msg, value);
 }
 
 void ContentFolder::init(media_folder_h handle) {
@@ -514,6 +750,43 @@ void ContentFolder::print(void) {
 }
 #endif
 
+const std::vector<std::string>& ContentItem::editable_attributes() {
+  static const std::vector<std::string> attributes = {
+    "name", "description", "rating", "geolocation", "orientation"
+  };
+  return attributes;
+}
+
+void ContentItemList::addItem(const ContentItem& item) {
+  ContentRecord record;
+  record.id = m_arena.Intern(item.id());
+  record.name = m_arena.Intern(item.name());
+  record.type = m_arena.Intern(item.type());
+  record.mime_type = m_arena.Intern(item.mime_type());
+  record.title = m_arena.Intern(item.title());
+  record.content_uri = m_arena.Intern(item.content_uri());
+  record.thumbnail_uris = m_arena.Intern(item.thumbnail_uris());
+  record.release_date = m_arena.Intern(item.release_date());
+  record.modified_date = m_arena.Intern(item.modified_date());
+  record.description = m_arena.Intern(item.description());
+  record.album = m_arena.Intern(item.album());
+  record.genres = m_arena.Intern(item.genres());
+  record.artists = m_arena.Intern(item.artists());
+  record.composer = m_arena.Intern(item.composer());
+  record.copyright = m_arena.Intern(item.copyright());
+  record.orientation = m_arena.Intern(item.orientation());
+  record.size = item.size();
+  record.rating = item.rating();
+  record.bitrate = item.bitrate();
+  record.width = item.width();
+  record.height = item.height();
+  record.latitude = item.latitude();
+  record.longitude = item.longitude();
+  record.duration = item.duration();
+  record.track_number = item.track_number();
+  m_items.push_back(record);
+}
+
 void ContentItem::init(media_info_h handle) {
   char* pc = NULL;
 
@@ -775,3 +1048,28 @@ void ContentInstance::HandleScanFileRequest(const picojson::value& msg) {
 void ContentInstance::HandleScanFileReply(const picojson::value& msg) {
   PostAsyncSuccessReply(msg);
 }
+
+void ContentInstance::HandleScanDirectoryRequest(const picojson::value& msg) {
+  // Drop the scanners that are done before starting another one.
+  std::map<double, DirectoryScanner*>::iterator it = scanners_.begin();
+  while (it != scanners_.end()) {
+    if (it->second->finished()) {
+      delete it->second;
+      scanners_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+
+  DirectoryScanner* scanner = new DirectoryScanner(this, msg);
+  scanners_[msg.get("replyId").get<double>()] = scanner;
+  scanner->Start();
+}
+
+void ContentInstance::HandleCancelScanDirectoryRequest(
+    const picojson::value& msg) {
+  std::map<double, DirectoryScanner*>::iterator it =
+      scanners_.find(msg.get("requestId").get<double>());
+  if (it != scanners_.end())
+    it->second->Cancel();
+}
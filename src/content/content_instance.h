@@ -7,12 +7,16 @@
 
 #include <media_content.h>
 
+#include <map>
+#include <mutex>  // NOLINT
+#include <set>
 #include <string>
 #include <algorithm>
 #include <vector>
 
 #include "common/extension.h"
 #include "common/picojson.h"
+#include "content/content_arena.h"
 #include "tizen/tizen.h"
 
 namespace picojson {
@@ -21,6 +25,7 @@ class value;
 
 class ContentFolderList;
 class ContentItemList;
+class DirectoryScanner;
 
 class ContentInstance : public common::Instance {
  public:
@@ -33,6 +38,7 @@ class ContentInstance : public common::Instance {
   virtual void HandleSyncMessage(const char* msg);
 
   bool HandleUpdateRequest(const picojson::value& json);
+  bool ApplyUpdate(media_info_h handle, const picojson::value& json);
   void HandleUpdateBatchRequest(const picojson::value& json);
   void HandleGetDirectoriesRequest(const picojson::value& json);
   void HandleGetDirectoriesReply(const picojson::value& json,
@@ -41,9 +47,13 @@ class ContentInstance : public common::Instance {
   void HandleFindReply(const picojson::value& json, ContentItemList *);
   void HandleScanFileRequest(const picojson::value& json);
   void HandleScanFileReply(const picojson::value& json);
+  void HandleScanDirectoryRequest(const picojson::value& json);
+  void HandleCancelScanDirectoryRequest(const picojson::value& json);
 
   // Asynchronous message helpers
   void PostAsyncErrorReply(const picojson::value&, WebApiAPIErrors);
+  void PostAsyncErrorReply(const picojson::value&, WebApiAPIErrors,
+      picojson::value::object&);
   void PostAsyncSuccessReply(const picojson::value&, picojson::value::object&);
   void PostAsyncSuccessReply(const picojson::value&, picojson::value&);
   void PostAsyncSuccessReply(const picojson::value&, WebApiAPIErrors);
@@ -63,7 +73,16 @@ class ContentInstance : public common::Instance {
       char* mime_type,
       void* user_data);
 
+  // Running scanDirectory requests, by reply id.
+  std::map<double, DirectoryScanner*> scanners_;
+
   static unsigned m_instanceCount;
+
+  // Instances with a JS change listener set. The DB change callback is
+  // registered once for the process so the ContentCache stays current even
+  // when no listener is set.
+  static std::set<ContentInstance*> m_listeners;
+  static std::mutex m_listenersMutex;
 };
 
 class ContentFolder {
@@ -99,20 +118,13 @@ class ContentItem {
  public:
   ContentItem() : size_(0), rating_(0), bitrate_(0), track_number_(0),
       duration_(0), width_(0), height_(0), latitude_(DEFAULT_GEOLOCATION),
-      longitude_(DEFAULT_GEOLOCATION) {
-    editable_attributes_.push_back("name");
-    editable_attributes_.push_back("description");
-    editable_attributes_.push_back("rating");
-    editable_attributes_.push_back("geolocation");
-    editable_attributes_.push_back("orientation");
-  }
+      longitude_(DEFAULT_GEOLOCATION) {}
 
   void init(media_info_h handle);
 
   // Getters & Setters
-  const std::vector<std::string>& editable_attributes() const {
-    return editable_attributes_;
-  }
+  // The same for every item, so it is shared rather than stored per item.
+  static const std::vector<std::string>& editable_attributes();
   const std::string& id() const { return id_; }
   void set_id(const std::string& id) { id_ = id; }
   const std::string& name() const { return name_; }
@@ -173,7 +185,6 @@ class ContentItem {
 #endif
 
  protected:
-  std::vector<std::string> editable_attributes_;
   std::string id_;
   std::string name_;
   std::string type_;
@@ -203,7 +214,37 @@ class ContentItem {
   double latitude_;
   double longitude_;
   std::string orientation_;
-  const double DEFAULT_GEOLOCATION = -200;
+  static constexpr double DEFAULT_GEOLOCATION = -200;
+};
+
+// Flat copy of a ContentItem whose strings live in the ContentArena of the
+// owning ContentItemList.
+struct ContentRecord {
+  const char* id;
+  const char* name;
+  const char* type;
+  const char* mime_type;
+  const char* title;
+  const char* content_uri;
+  const char* thumbnail_uris;
+  const char* release_date;
+  const char* modified_date;
+  const char* description;
+  const char* album;
+  const char* genres;
+  const char* artists;
+  const char* composer;
+  const char* copyright;
+  const char* orientation;
+  uint64_t size;
+  uint64_t rating;
+  uint64_t bitrate;
+  uint64_t width;
+  uint64_t height;
+  double latitude;
+  double longitude;
+  int duration;
+  uint16_t track_number;
 };
 
 class ContentFolderList {
@@ -223,21 +264,19 @@ class ContentFolderList {
   std::vector<ContentFolder*> m_folders;
 };
 
+// Results of one find request. Items are flattened into ContentRecords
+// backed by a per-request arena instead of being kept as heap allocated
+// ContentItems.
 class ContentItemList {
  public:
-  ~ContentItemList() {
-    for (unsigned i = 0; i < m_items.size(); i++)
-      delete m_items[i];
-  }
-  void addItem(ContentItem* item) {
-    m_items.push_back(item);
-  }
-  const std::vector<ContentItem*>& getAllItems() {
+  void addItem(const ContentItem& item);
+  const std::vector<ContentRecord>& getAllItems() const {
     return m_items;
   }
 
  private:
-  std::vector<ContentItem*> m_items;
+  ContentArena m_arena;
+  std::vector<ContentRecord> m_items;
 };
 
 #endif  // CONTENT_CONTENT_INSTANCE_H_
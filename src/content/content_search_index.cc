@@ -0,0 +1,356 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/content_search_index.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "content/content_instance.h"
+
+namespace {
+
+const char kMagic[4] = { 'T', 'C', 'S', 'I' };
+const uint32_t kVersion = 1;
+
+// Don't compact for a handful of removals.
+const unsigned kMinDeadToCompact = 1024;
+
+// Sanity limit when reading strings back from disk.
+const uint32_t kMaxStoredString = 64 * 1024;
+
+// SQLite's LIKE is case-insensitive for ASCII only, so is the index.
+std::string Normalize(const std::string& text) {
+  std::string result(text);
+  for (unsigned i = 0; i < result.size(); ++i) {
+    if (result[i] >= 'A' && result[i] <= 'Z')
+      result[i] += 'a' - 'A';
+  }
+  return result;
+}
+
+uint32_t TrigramKey(int field, const std::string& text, unsigned i) {
+  return static_cast<uint32_t>(field) << 24 |
+      static_cast<uint32_t>(static_cast<unsigned char>(text[i])) << 16 |
+      static_cast<uint32_t>(static_cast<unsigned char>(text[i + 1])) << 8 |
+      static_cast<uint32_t>(static_cast<unsigned char>(text[i + 2]));
+}
+
+void Trigrams(int field, const std::string& text,
+              std::vector<uint32_t>* keys) {
+  for (unsigned i = 0; i + 3 <= text.size(); ++i)
+    keys->push_back(TrigramKey(field, text, i));
+  std::sort(keys->begin(), keys->end());
+  keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+}
+
+void WriteU32(std::ostream& out, uint32_t value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void WriteString(std::ostream& out, const std::string& str) {
+  WriteU32(out, str.size());
+  out.write(str.data(), str.size());
+}
+
+bool ReadU32(std::istream& in, uint32_t* value) {
+  return in.read(reinterpret_cast<char*>(value), sizeof(*value)).good();
+}
+
+bool ReadString(std::istream& in, std::string* str) {
+  uint32_t size;
+  if (!ReadU32(in, &size) || size > kMaxStoredString)
+    return false;
+  str->resize(size);
+  return size == 0 || in.read(&(*str)[0], size).good();
+}
+
+}  // namespace
+
+ContentSearchIndex::ContentSearchIndex()
+    : enabled_(false),
+      dirty_(false),
+      dead_count_(0) {
+}
+
+int ContentSearchIndex::FieldFromAttribute(const std::string& name) {
+  if (name == "title")
+    return FIELD_TITLE;
+  if (name == "artists")
+    return FIELD_ARTISTS;
+  if (name == "album")
+    return FIELD_ALBUM;
+  if (name == "name")
+    return FIELD_NAME;
+  return -1;
+}
+
+void ContentSearchIndex::Enable(const std::string& path) {
+  if (enabled_)
+    return;
+  enabled_ = true;
+  path_ = path;
+  if (!Load())
+    Clear();
+  dirty_ = false;
+}
+
+void ContentSearchIndex::Update(const ContentItem& item) {
+  std::string texts[FIELD_COUNT];
+  texts[FIELD_TITLE] = Normalize(item.title());
+  texts[FIELD_ARTISTS] = Normalize(item.artists());
+  texts[FIELD_ALBUM] = Normalize(item.album());
+  texts[FIELD_NAME] = Normalize(item.name());
+
+  std::unordered_map<std::string, uint32_t>::const_iterator it =
+      documents_.find(item.id());
+  if (it != documents_.end()) {
+    uint32_t doc = it->second;
+    bool unchanged = true;
+    for (int field = 0; field < FIELD_COUNT && unchanged; ++field)
+      unchanged = texts_[field][doc] == texts[field];
+    if (unchanged)
+      return;
+    RemoveDocument(doc);
+    CompactIfSparse();
+  }
+
+  AddDocument(item.id(), texts);
+  dirty_ = true;
+}
+
+void ContentSearchIndex::Remove(const std::string& id) {
+  std::unordered_map<std::string, uint32_t>::const_iterator it =
+      documents_.find(id);
+  if (it == documents_.end())
+    return;
+  RemoveDocument(it->second);
+  CompactIfSparse();
+  dirty_ = true;
+}
+
+void ContentSearchIndex::Retain(
+    const std::unordered_map<std::string, uint32_t>& ids) {
+  for (uint32_t doc = 0; doc < ids_.size(); ++doc) {
+    if (live_[doc] && ids.find(ids_[doc]) == ids.end()) {
+      RemoveDocument(doc);
+      dirty_ = true;
+    }
+  }
+  // Only now, as compacting renumbers the documents.
+  CompactIfSparse();
+}
+
+void ContentSearchIndex::Search(Field field, const std::string& text,
+                                bool prefix,
+                                std::vector<std::string>* ids) const {
+  const std::string needle = Normalize(text);
+  const std::vector<std::string>& texts = texts_[field];
+
+  std::vector<uint32_t> candidates;
+  if (needle.size() < 3) {
+    // Too short for a trigram, but still a scan of memory only.
+    for (uint32_t doc = 0; doc < ids_.size(); ++doc) {
+      if (live_[doc])
+        candidates.push_back(doc);
+    }
+  } else {
+    std::vector<uint32_t> keys;
+    Trigrams(field, needle, &keys);
+
+    // Start from the rarest trigram and probe the others.
+    std::vector<const Postings*> lists;
+    for (unsigned i = 0; i < keys.size(); ++i) {
+      std::unordered_map<uint32_t, Postings>::const_iterator it =
+          postings_.find(keys[i]);
+      if (it == postings_.end())
+        return;
+      lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+        [](const Postings* a, const Postings* b) {
+          return a->size() < b->size();
+        });
+
+    const Postings& rarest = *lists[0];
+    for (unsigned i = 0; i < rarest.size(); ++i) {
+      bool in_all = live_[rarest[i]];
+      for (unsigned j = 1; j < lists.size() && in_all; ++j)
+        in_all = std::binary_search(lists[j]->begin(), lists[j]->end(),
+                                    rarest[i]);
+      if (in_all)
+        candidates.push_back(rarest[i]);
+    }
+  }
+
+  // Trigrams can match out of order, so check the real text.
+  for (unsigned i = 0; i < candidates.size(); ++i) {
+    const std::string& haystack = texts[candidates[i]];
+    bool match = prefix ? haystack.compare(0, needle.size(), needle) == 0 :
+        haystack.find(needle) != std::string::npos;
+    if (match)
+      ids->push_back(ids_[candidates[i]]);
+  }
+}
+
+void ContentSearchIndex::Save() {
+  if (!enabled_ || !dirty_ || path_.empty())
+    return;
+
+  // Only live documents are written, numbered as in memory.
+  if (dead_count_)
+    Compact();
+
+  std::string tmp_path = path_ + ".tmp";
+  {
+    std::ofstream out(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(kMagic, sizeof(kMagic));
+    WriteU32(out, kVersion);
+    WriteU32(out, ids_.size());
+    for (uint32_t doc = 0; doc < ids_.size(); ++doc) {
+      WriteString(out, ids_[doc]);
+      for (int field = 0; field < FIELD_COUNT; ++field)
+        WriteString(out, texts_[field][doc]);
+    }
+    WriteU32(out, postings_.size());
+    for (std::unordered_map<uint32_t, Postings>::const_iterator it =
+         postings_.begin(); it != postings_.end(); ++it) {
+      WriteU32(out, it->first);
+      WriteU32(out, it->second.size());
+      out.write(reinterpret_cast<const char*>(&it->second[0]),
+                it->second.size() * sizeof(uint32_t));
+    }
+    if (!out.good()) {
+      std::cerr << "ContentSearchIndex: can't write " << tmp_path
+          << std::endl;
+      remove(tmp_path.c_str());
+      return;
+    }
+  }
+
+  if (rename(tmp_path.c_str(), path_.c_str()) != 0) {
+    std::cerr << "ContentSearchIndex: can't replace " << path_ << std::endl;
+    remove(tmp_path.c_str());
+    return;
+  }
+  dirty_ = false;
+}
+
+uint32_t ContentSearchIndex::AddDocument(const std::string& id,
+                                         const std::string* texts) {
+  uint32_t doc = ids_.size();
+  ids_.push_back(id);
+  live_.push_back(true);
+  documents_[id] = doc;
+
+  // Document numbers only grow, so appending keeps the postings sorted.
+  std::vector<uint32_t> keys;
+  for (int field = 0; field < FIELD_COUNT; ++field) {
+    texts_[field].push_back(texts[field]);
+    keys.clear();
+    Trigrams(field, texts[field], &keys);
+    for (unsigned i = 0; i < keys.size(); ++i)
+      postings_[keys[i]].push_back(doc);
+  }
+  return doc;
+}
+
+void ContentSearchIndex::RemoveDocument(uint32_t doc) {
+  documents_.erase(ids_[doc]);
+  live_[doc] = false;
+  for (int field = 0; field < FIELD_COUNT; ++field)
+    std::string().swap(texts_[field][doc]);
+  ++dead_count_;
+}
+
+void ContentSearchIndex::CompactIfSparse() {
+  if (dead_count_ >= kMinDeadToCompact && dead_count_ * 2 > ids_.size())
+    Compact();
+}
+
+void ContentSearchIndex::Compact() {
+  std::vector<std::string> ids;
+  std::vector<std::string> texts[FIELD_COUNT];
+  for (uint32_t doc = 0; doc < ids_.size(); ++doc) {
+    if (!live_[doc])
+      continue;
+    ids.push_back(ids_[doc]);
+    for (int field = 0; field < FIELD_COUNT; ++field)
+      texts[field].push_back(texts_[field][doc]);
+  }
+
+  Clear();
+  std::string doc_texts[FIELD_COUNT];
+  for (uint32_t i = 0; i < ids.size(); ++i) {
+    for (int field = 0; field < FIELD_COUNT; ++field)
+      doc_texts[field].swap(texts[field][i]);
+    AddDocument(ids[i], doc_texts);
+  }
+}
+
+bool ContentSearchIndex::Load() {
+  std::ifstream in(path_.c_str(), std::ios::binary);
+  if (!in)
+    return false;
+
+  char magic[sizeof(kMagic)];
+  uint32_t version;
+  uint32_t count;
+  if (!in.read(magic, sizeof(magic)).good() ||
+      !std::equal(magic, magic + sizeof(magic), kMagic) ||
+      !ReadU32(in, &version) || version != kVersion ||
+      !ReadU32(in, &count))
+    return false;
+
+  Clear();
+  for (uint32_t doc = 0; doc < count; ++doc) {
+    std::string id;
+    if (!ReadString(in, &id))
+      return false;
+    for (int field = 0; field < FIELD_COUNT; ++field) {
+      texts_[field].push_back(std::string());
+      if (!ReadString(in, &texts_[field].back()))
+        return false;
+    }
+    ids_.push_back(id);
+    live_.push_back(true);
+    documents_[id] = doc;
+  }
+
+  uint32_t posting_count;
+  if (!ReadU32(in, &posting_count))
+    return false;
+  for (uint32_t i = 0; i < posting_count; ++i) {
+    uint32_t key;
+    uint32_t size;
+    if (!ReadU32(in, &key) || !ReadU32(in, &size) || size > count)
+      return false;
+    Postings& postings = postings_[key];
+    postings.resize(size);
+    if (size && !in.read(reinterpret_cast<char*>(&postings[0]),
+                         size * sizeof(uint32_t)).good())
+      return false;
+    for (uint32_t j = 0; j < size; ++j) {
+      if (postings[j] >= count)
+        return false;
+    }
+  }
+  return true;
+}
+
+void ContentSearchIndex::Clear() {
+  ids_.clear();
+  for (int field = 0; field < FIELD_COUNT; ++field)
+    texts_[field].clear();
+  live_.clear();
+  dead_count_ = 0;
+  documents_.clear();
+  postings_.clear();
+}
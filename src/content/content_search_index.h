@@ -0,0 +1,83 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_CONTENT_SEARCH_INDEX_H_
+#define CONTENT_CONTENT_SEARCH_INDEX_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ContentItem;
+
+// Trigram index over the text attributes apps search while the user types.
+// It answers case-insensitive CONTAINS and STARTSWITH matches without the
+// "LIKE '%x%'" table scan the DB would do.
+//
+// Documents are keyed by media id. Removed documents are only tombstoned
+// and the postings are compacted once enough of them pile up. The index is
+// saved to disk so the next session can start from it; Update() makes that
+// copy current again cheaply because unchanged documents are left alone.
+class ContentSearchIndex {
+ public:
+  enum Field {
+    FIELD_TITLE = 0,
+    FIELD_ARTISTS,
+    FIELD_ALBUM,
+    FIELD_NAME,
+    FIELD_COUNT,
+  };
+
+  ContentSearchIndex();
+
+  // Returns -1 for attributes that aren't indexed.
+  static int FieldFromAttribute(const std::string& attribute_name);
+
+  bool enabled() const { return enabled_; }
+  // Loads the saved index, if any, and starts maintaining it.
+  void Enable(const std::string& path);
+
+  void Update(const ContentItem& item);
+  void Remove(const std::string& id);
+  // Removes documents whose id isn't in |ids|.
+  void Retain(const std::unordered_map<std::string, uint32_t>& ids);
+
+  // Media ids whose |field| contains |text| (or starts with it).
+  void Search(Field field, const std::string& text, bool prefix,
+              std::vector<std::string>* ids) const;
+
+  // Writes the index back if it changed since it was loaded or saved.
+  void Save();
+
+ private:
+  typedef std::vector<uint32_t> Postings;
+
+  uint32_t AddDocument(const std::string& id, const std::string* texts);
+  // Only marks |doc| dead, so document numbers stay valid.
+  void RemoveDocument(uint32_t doc);
+  // Compacts once at least half of the documents are dead.
+  void CompactIfSparse();
+  void Compact();
+  bool Load();
+  void Clear();
+
+  bool enabled_;
+  bool dirty_;
+  std::string path_;
+
+  // Per document, indexed by document number.
+  std::vector<std::string> ids_;
+  std::vector<std::string> texts_[FIELD_COUNT];
+  std::vector<bool> live_;
+  unsigned dead_count_;
+
+  std::unordered_map<std::string, uint32_t> documents_;
+
+  // Key is (field << 24 | trigram); documents are kept sorted.
+  std::unordered_map<uint32_t, Postings> postings_;
+};
+
+#endif  // CONTENT_CONTENT_SEARCH_INDEX_H_
@@ -0,0 +1,391 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/content_thumbnail_queue.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "content/content_cache.h"
+#include "content/content_instance.h"
+
+namespace {
+
+const size_t kDiskCacheMaxBytes = 32 * 1024 * 1024;
+
+const std::string STR_IDS("ids");
+const std::string STR_PRIORITY("priority");
+
+std::string CacheKey(const std::string& id, time_t modified) {
+  return id + "-" + std::to_string(static_cast<long long>(modified));  // NOLINT
+}
+
+std::string GetCacheDirectory() {
+  std::string dir = ContentCache::GetStorageDirectory() + "/thumbnails";
+  if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)
+    std::cerr << "Can't create thumbnail cache " << dir << std::endl;
+  return dir;
+}
+
+bool FileExists(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool CopyFile(const std::string& from, const std::string& to) {
+  std::ifstream in(from.c_str(), std::ios::binary);
+  if (!in)
+    return false;
+  std::ofstream out(to.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out)
+    return false;
+  out << in.rdbuf();
+  return out.good();
+}
+
+}  // namespace
+
+ThumbnailDiskCache::ThumbnailDiskCache(size_t max_bytes)
+    : loaded_(false),
+      max_bytes_(max_bytes),
+      total_bytes_(0) {
+}
+
+std::string ThumbnailDiskCache::Lookup(const std::string& id,
+                                       time_t modified) {
+  Load();
+  std::unordered_map<std::string, EntryList::iterator>::iterator it =
+      index_.find(CacheKey(id, modified));
+  if (it == index_.end())
+    return std::string();
+
+  std::string path = dir_ + "/" + it->second->file_name;
+  if (!FileExists(path)) {
+    Remove(it->second);
+    return std::string();
+  }
+
+  entries_.splice(entries_.begin(), entries_, it->second);
+  utime(path.c_str(), NULL);
+  return path;
+}
+
+std::string ThumbnailDiskCache::Store(const std::string& id, time_t modified,
+                                      const std::string& source_path) {
+  Load();
+  RemoveStale(id);
+
+  std::string key = CacheKey(id, modified);
+  std::string file_name = key;
+  std::string::size_type dot = source_path.rfind('.');
+  if (dot != std::string::npos &&
+      source_path.find('/', dot) == std::string::npos)
+    file_name += source_path.substr(dot);
+
+  std::string path = dir_ + "/" + file_name;
+  struct stat st;
+  if (!CopyFile(source_path, path) || stat(path.c_str(), &st) != 0) {
+    std::cerr << "Can't cache thumbnail " << source_path << std::endl;
+    unlink(path.c_str());
+    return std::string();
+  }
+
+  Entry entry = { key, file_name, st.st_size };
+  entries_.push_front(entry);
+  index_[key] = entries_.begin();
+  total_bytes_ += st.st_size;
+  Evict();
+
+  // Even a single oversized thumbnail is returned; it goes on next insert.
+  return path;
+}
+
+void ThumbnailDiskCache::Load() {
+  if (loaded_)
+    return;
+  loaded_ = true;
+  dir_ = GetCacheDirectory();
+
+  DIR* dir = opendir(dir_.c_str());
+  if (!dir)
+    return;
+
+  std::vector<std::pair<time_t, Entry> > found;
+  struct dirent* ent;
+  while ((ent = readdir(dir)) != NULL) {
+    std::string file_name(ent->d_name);
+    if (file_name[0] == '.')
+      continue;
+
+    struct stat st;
+    if (stat((dir_ + "/" + file_name).c_str(), &st) != 0 ||
+        !S_ISREG(st.st_mode))
+      continue;
+
+    Entry entry = { file_name.substr(0, file_name.rfind('.')),
+                    file_name, st.st_size };
+    found.push_back(std::make_pair(st.st_mtime, entry));
+  }
+  closedir(dir);
+
+  std::sort(found.begin(), found.end(),
+      [](const std::pair<time_t, Entry>& a,
+         const std::pair<time_t, Entry>& b) { return a.first > b.first; });
+  for (unsigned i = 0; i < found.size(); ++i) {
+    entries_.push_back(found[i].second);
+    index_[found[i].second.key] = --entries_.end();
+    total_bytes_ += found[i].second.size;
+  }
+  Evict();
+}
+
+void ThumbnailDiskCache::Remove(EntryList::iterator it) {
+  unlink((dir_ + "/" + it->file_name).c_str());
+  total_bytes_ -= it->size;
+  index_.erase(it->key);
+  entries_.erase(it);
+}
+
+void ThumbnailDiskCache::RemoveStale(const std::string& id) {
+  const std::string prefix = id + "-";
+  EntryList::iterator it = entries_.begin();
+  while (it != entries_.end()) {
+    EntryList::iterator current = it++;
+    if (current->key.compare(0, prefix.size(), prefix) == 0)
+      Remove(current);
+  }
+}
+
+void ThumbnailDiskCache::Evict() {
+  while (total_bytes_ > max_bytes_ && entries_.size() > 1)
+    Remove(--entries_.end());
+}
+
+ThumbnailQueue& ThumbnailQueue::instance() {
+  static ThumbnailQueue instance;
+  return instance;
+}
+
+ThumbnailQueue::ThumbnailQueue()
+    : next_sequence_(0),
+      disk_cache_(kDiskCacheMaxBytes) {
+}
+
+void ThumbnailQueue::Request(ContentInstance* instance,
+                             const picojson::value& msg) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+  std::vector<std::string> ids;
+  if (msg.get(STR_IDS).is<picojson::array>()) {
+    const picojson::array& list = msg.get(STR_IDS).get<picojson::array>();
+    for (picojson::array::const_iterator it = list.begin();
+         it != list.end(); ++it)
+      ids.push_back(it->to_str());
+  }
+  int priority = msg.get(STR_PRIORITY).is<double>() ?
+      static_cast<int>(msg.get(STR_PRIORITY).get<double>()) : 0;
+
+  Batch* request = new Batch;
+  request->instance = instance;
+  request->reply_id = msg.get("replyId").get<double>();
+  request->remaining = ids.size();
+  requests_.push_back(request);
+
+  for (unsigned i = 0; i < ids.size(); ++i) {
+    media_info_h handle = NULL;
+    if (media_info_get_media_from_db(ids[i].c_str(), &handle)
+        != MEDIA_CONTENT_ERROR_NONE || !handle) {
+      PostItem(request, ids[i], std::string(), WebApiAPIErrors::NOT_FOUND_ERR);
+      --request->remaining;
+      continue;
+    }
+
+    time_t modified = 0;
+    media_info_get_modified_time(handle, &modified);
+
+    std::string path = disk_cache_.Lookup(ids[i], modified);
+    if (path.empty()) {
+      // The thumbnail server may have made one already.
+      char* pc = NULL;
+      if (media_info_get_thumbnail_path(handle, &pc)
+          == MEDIA_CONTENT_ERROR_NONE && pc) {
+        if (FileExists(pc))
+          path = disk_cache_.Store(ids[i], modified, pc);
+        free(pc);
+      }
+    }
+
+    if (!path.empty()) {
+      media_info_destroy(handle);
+      PostItem(request, ids[i], path, WebApiAPIErrors::NO_ERROR);
+      --request->remaining;
+      continue;
+    }
+
+    Job* job = new Job;
+    job->request = request;
+    job->id = ids[i];
+    job->modified = modified;
+    job->priority = priority;
+    job->sequence = next_sequence_++;
+    job->handle = handle;
+    pending_.insert(job);
+  }
+
+  if (request->remaining == 0) {
+    PostItem(request, std::string(), std::string(), WebApiAPIErrors::NO_ERROR);
+    requests_.remove(request);
+    delete request;
+    return;
+  }
+  Pump();
+}
+
+void ThumbnailQueue::Cancel(ContentInstance* instance, double reply_id) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  for (std::list<Batch*>::iterator it = requests_.begin();
+       it != requests_.end(); ++it) {
+    if ((*it)->instance == instance && (*it)->reply_id == reply_id) {
+      CancelRequest(*it);
+      break;
+    }
+  }
+  Pump();
+}
+
+void ThumbnailQueue::CancelAll(ContentInstance* instance) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  std::list<Batch*>::iterator it = requests_.begin();
+  while (it != requests_.end()) {
+    Batch* request = *it++;
+    if (request->instance == instance)
+      CancelRequest(request);
+  }
+  Pump();
+}
+
+void ThumbnailQueue::Pump() {
+  while (in_flight_.size() < kMaxInFlight && !pending_.empty()) {
+    Job* job = *pending_.begin();
+    pending_.erase(pending_.begin());
+
+    in_flight_.insert(job);
+    int ret = media_info_create_thumbnail(job->handle, OnThumbnailCreated, job);
+    if (ret != MEDIA_CONTENT_ERROR_NONE) {
+      std::cerr << "media_info_create_thumbnail: error " << ret << std::endl;
+      in_flight_.erase(job);
+      Finish(job, std::string());
+    }
+  }
+}
+
+void ThumbnailQueue::Finish(Job* job, const std::string& path) {
+  Batch* request = job->request;
+  if (request) {
+    PostItem(request, job->id, path, path.empty() ?
+        WebApiAPIErrors::UNKNOWN_ERR : WebApiAPIErrors::NO_ERROR);
+    if (--request->remaining == 0) {
+      PostItem(request, std::string(), std::string(),
+               WebApiAPIErrors::NO_ERROR);
+      requests_.remove(request);
+      delete request;
+    }
+  }
+  DestroyJob(job);
+}
+
+void ThumbnailQueue::CancelRequest(Batch* request) {
+  std::set<Job*, JobOrder>::iterator it = pending_.begin();
+  while (it != pending_.end()) {
+    Job* job = *it;
+    if (job->request == request) {
+      pending_.erase(it++);
+      DestroyJob(job);
+    } else {
+      ++it;
+    }
+  }
+
+  std::set<Job*>::iterator flight = in_flight_.begin();
+  while (flight != in_flight_.end()) {
+    Job* job = *flight;
+    if (job->request != request) {
+      ++flight;
+      continue;
+    }
+    // If the server won't cancel, the completion callback still comes and
+    // has to find the job, just without anyone to report to.
+    if (media_info_cancel_thumbnail(job->handle) == MEDIA_CONTENT_ERROR_NONE) {
+      in_flight_.erase(flight++);
+      DestroyJob(job);
+    } else {
+      job->request = NULL;
+      ++flight;
+    }
+  }
+
+  requests_.remove(request);
+  delete request;
+}
+
+// An empty |id| marks the final reply of a request, after which the JS side
+// drops its callbacks.
+void ThumbnailQueue::PostItem(Batch* request, const std::string& id,
+                              const std::string& path,
+                              WebApiAPIErrors error) {
+  picojson::value::object reply;
+  reply["replyId"] = picojson::value(request->reply_id);
+  reply["isError"] = picojson::value(false);
+
+  if (!id.empty()) {
+    picojson::value::object o;
+    o["id"] = picojson::value(id);
+    if (error == WebApiAPIErrors::NO_ERROR)
+      o["thumbnailURI"] = picojson::value("file://" + path);
+    else
+      o["errorCode"] = picojson::value(static_cast<double>(error));
+    reply["value"] = picojson::value(o);
+    reply["keepCallback"] = picojson::value(true);
+  }
+
+  picojson::value v(reply);
+  request->instance->PostMessage(v.serialize().c_str());
+}
+
+void ThumbnailQueue::DestroyJob(Job* job) {
+  if (job->handle)
+    media_info_destroy(job->handle);
+  delete job;
+}
+
+void ThumbnailQueue::OnThumbnailCreated(media_content_error_e error,
+                                        const char* path, void* user_data) {
+  ThumbnailQueue& self = ThumbnailQueue::instance();
+  std::lock_guard<std::recursive_mutex> lock(self.mutex_);
+
+  Job* job = reinterpret_cast<Job*>(user_data);
+  if (self.in_flight_.erase(job) == 0)
+    return;
+
+  std::string cached;
+  if (error == MEDIA_CONTENT_ERROR_NONE && path && job->request)
+    cached = self.disk_cache_.Store(job->id, job->modified, path);
+  else if (error != MEDIA_CONTENT_ERROR_NONE)
+    std::cerr << "Thumbnail for " << job->id << " failed: " << error
+        << std::endl;
+
+  self.Finish(job, cached);
+  self.Pump();
+}
@@ -0,0 +1,118 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_CONTENT_THUMBNAIL_QUEUE_H_
+#define CONTENT_CONTENT_THUMBNAIL_QUEUE_H_
+
+#include <media_content.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <list>
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include "common/picojson.h"
+#include "tizen/tizen.h"
+
+class ContentInstance;
+
+// Size-bounded on-disk store of generated thumbnails. Entries are keyed by
+// media id and modification time, so a changed file never gets a stale
+// thumbnail, and the least recently used ones are evicted first. File
+// modification times record usage so the order survives restarts.
+class ThumbnailDiskCache {
+ public:
+  explicit ThumbnailDiskCache(size_t max_bytes);
+
+  // Return the cached path, or an empty string.
+  std::string Lookup(const std::string& id, time_t modified);
+  std::string Store(const std::string& id, time_t modified,
+                    const std::string& source_path);
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string file_name;
+    off_t size;
+  };
+  typedef std::list<Entry> EntryList;
+
+  void Load();
+  void Remove(EntryList::iterator it);
+  void RemoveStale(const std::string& id);
+  void Evict();
+
+  std::string dir_;
+  bool loaded_;
+  size_t max_bytes_;
+  size_t total_bytes_;
+
+  // Most recently used first.
+  EntryList entries_;
+  std::unordered_map<std::string, EntryList::iterator> index_;
+};
+
+// Generates thumbnails for lists of media ids on behalf of instances. Jobs
+// are ordered by priority, then by arrival, and at most kMaxInFlight are
+// handed to the thumbnail server at once so a long request can't starve the
+// visible items of a later one.
+class ThumbnailQueue {
+ public:
+  static ThumbnailQueue& instance();
+
+  void Request(ContentInstance* instance, const picojson::value& msg);
+  void Cancel(ContentInstance* instance, double reply_id);
+  void CancelAll(ContentInstance* instance);
+
+ private:
+  struct Batch;
+  struct Job {
+    Batch* request;
+    std::string id;
+    time_t modified;
+    int priority;
+    uint64_t sequence;
+    media_info_h handle;
+  };
+  struct Batch {
+    ContentInstance* instance;
+    double reply_id;
+    unsigned remaining;
+  };
+  struct JobOrder {
+    bool operator()(const Job* a, const Job* b) const {
+      if (a->priority != b->priority)
+        return a->priority > b->priority;
+      return a->sequence < b->sequence;
+    }
+  };
+
+  static const unsigned kMaxInFlight = 2;
+
+  ThumbnailQueue();
+
+  // The following expect |mutex_| to be held.
+  void Pump();
+  void Finish(Job* job, const std::string& path);
+  void CancelRequest(Batch* request);
+  void PostItem(Batch* request, const std::string& id,
+                const std::string& path, WebApiAPIErrors error);
+  void DestroyJob(Job* job);
+
+  static void OnThumbnailCreated(media_content_error_e error,
+                                 const char* path, void* user_data);
+
+  std::recursive_mutex mutex_;
+  uint64_t next_sequence_;
+  std::set<Job*, JobOrder> pending_;
+  std::set<Job*> in_flight_;
+  std::list<Batch*> requests_;
+  ThumbnailDiskCache disk_cache_;
+};
+
+#endif  // CONTENT_CONTENT_THUMBNAIL_QUEUE_H_
@@ -27,6 +27,7 @@
             'packages': [
               'appcore-common',
               'capi-network-connection',
+              'capi-network-wifi',
               'capi-system-info',
               'capi-system-runtime-info',
               'capi-system-sensor',
@@ -36,6 +37,13 @@
             ]
           },
         }],
+       [ 'display_type == "x11"', {
+         'variables': {
+            'packages': [
+              'xrandr',
+            ]
+          },
+        }],
        [ 'display_type == "wayland"', {
          'variables': {
             'packages': [
@@ -71,16 +79,21 @@
         'system_info_device_orientation.h',
         'system_info_device_orientation_desktop.cc',
         'system_info_device_orientation_tizen.cc',
+        'system_info_display.cc',
         'system_info_display.h',
         'system_info_display_wayland.cc',
         'system_info_display_x11.cc',
         'system_info_extension.cc',
         'system_info_extension.h',
+        'system_info_history.cc',
+        'system_info_history.h',
         'system_info_instance.cc',
         'system_info_instance.h',
         'system_info_locale.h',
         'system_info_locale_desktop.cc',
         'system_info_locale_tizen.cc',
+        'system_info_memory.cc',
+        'system_info_memory.h',
         'system_info_network.cc',
         'system_info_network.h',
         'system_info_network_desktop.cc',
@@ -88,18 +101,30 @@
         'system_info_network_tizen.cc',
         'system_info_network_tizen.h',
         'system_info_network_ivi.cc',
+        'system_info_network_manager_desktop.cc',
+        'system_info_network_manager_desktop.h',
         'system_info_network_mobile.cc',
         'system_info_peripheral.h',
         'system_info_peripheral_desktop.cc',
         'system_info_peripheral_tizen.cc',
+        'system_info_pressure.cc',
+        'system_info_pressure.h',
+        'system_info_process.cc',
+        'system_info_process.h',
         'system_info_sim.cc',
         'system_info_sim.h',
         'system_info_sim_ivi.cc',
         'system_info_sim_mobile.cc',
         'system_info_storage.cc',
         'system_info_storage.h',
+        'system_info_thermal.cc',
+        'system_info_thermal.h',
         'system_info_utils.cc',
         'system_info_utils.h',
+        'system_info_wifi_access_points.cc',
+        'system_info_wifi_access_points.h',
+        'system_info_wifi_access_points_desktop.cc',
+        'system_info_wifi_access_points_tizen.cc',
         'system_info_wifi_network.cc',
         'system_info_wifi_network.h',
         'system_info_wifi_network_desktop.cc',
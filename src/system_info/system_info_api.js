@@ -11,7 +11,9 @@ var props_array = ['BATTERY', 'CPU',
                    'DEVICE_ORIENTATION', 'BUILD',
                    'LOCALE', 'NETWORK',
                    'WIFI_NETWORK', 'CELLULAR_NETWORK',
-                   'SIM', 'PERIPHERAL'];
+                   'SIM', 'PERIPHERAL',
+                   'MEMORY', 'PRESSURE', 'THERMAL',
+                   'PROCESS', 'WIFI_ACCESS_POINTS'];
 
 var postMessage = function(msg, callback) {
   var reply_id = _next_reply_id;
@@ -50,71 +52,25 @@ function _createConstClone(obj) {
   return const_obj;
 }
 
-var _checkThreshold = function(value, highThreshold, lowThreshold) {
-  if ((highThreshold && (highThreshold >= 0) && (value >= highThreshold)) ||
-      (lowThreshold && (lowThreshold >= 0) && (value <= lowThreshold)))
-    return true;
-
-  return false;
-};
-
 extension.setMessageListener(function(json) {
   var msg = JSON.parse(json);
 
-  // For listeners
+  // For listeners, the options but the timeout were already applied
+  // natively. A listener which wasn't called for longer than its timeout
+  // has expired.
   if (msg.cmd == 'SystemInfoPropertyValueChanged') {
-    if (msg.prop && (0 !== msg.prop.length)) {
-      for (var id in _listeners) {
-        if (_listeners[id]['prop'] === msg.prop) {
-          var option = _listeners[id]['option'];
-          if (option) {
-            var currentTime = (new Date()).valueOf();
-            var timeout = parseFloat(option['timeout']);
-            var highThreshold = parseFloat(option['highThreshold']);
-            var lowThreshold = parseFloat(option['lowThreshold']);
-            var timeStamp = parseFloat(_listeners[id]['timestamp']);
-            if (timeout && (currentTime - timeStamp) > timeout) {
-              delete _listeners[id];
-              if (!_hasListener(msg.prop)) {
-                var message = {
-                  'cmd': 'stopListening',
-                  'prop': msg.prop
-                };
-                extension.postMessage(JSON.stringify(message));
-                return;
-              }
-              continue;
-            }
-            switch (msg.prop) {
-              case 'BATTERY':
-                if (_checkThreshold(msg.data.level, highThreshold, lowThreshold))
-                  _listeners[id]['callback'](_createConstClone(msg.data));
-                break;
-              case 'CPU':
-                if (_checkThreshold(msg.data.load, highThreshold, lowThreshold))
-                  _listeners[id]['callback'](_createConstClone(msg.data));
-                break;
-              case 'DISPLAY':
-                if (_checkThreshold(msg.data.brightness, highThreshold, lowThreshold))
-                  _listeners[id]['callback'](_createConstClone(msg.data));
-                break;
-              case 'STORAGE':
-              case 'DEVICE_ORIENTATION':
-              case 'BUILD':
-              case 'LOCALE':
-              case 'NETWORK':
-              case 'WIFI_NETWORK':
-              case 'CELLULAR_NETWORK':
-              case 'SIM':
-              case 'PERIPHERAL':
-                _listeners[id]['callback'](_createConstClone(msg.data));
-            }
-            _listeners[id]['timestamp'] = currentTime;
-            continue;
-          }
-          _listeners[id]['callback'](_createConstClone(msg.data));
-        }
+    var ids = msg.listenerIds || [];
+    var currentTime = (new Date()).valueOf();
+    for (var i = 0; i < ids.length; ++i) {
+      var listener = _listeners[ids[i]];
+      if (!listener || listener['prop'] !== msg.prop)
+        continue;
+      if (listener['timeout'] && currentTime - listener['timestamp'] > listener['timeout']) {
+        exports.removePropertyValueChangeListener(ids[i]);
+        continue;
       }
+      listener['timestamp'] = currentTime;
+      listener['callback'](_createConstClone(msg.data));
     }
     return;
   }
@@ -147,17 +103,19 @@ var _sendSyncMessage = function(msg) {
   return extension.internal.sendSyncMessage(JSON.stringify(msg));
 };
 
-var _getPropertyValue = function(prop, callback) {
+var _getPropertyValue = function(prop, callback, fresh) {
   var msg = {
     'cmd': 'getPropertyValue',
-    'prop': prop
+    'prop': prop,
+    'fresh': !!fresh
   };
   postMessage(msg, function(r) {
     callback(r.error, r.data);
   });
 };
 
-exports.getPropertyValue = function(prop, successCallback, errorCallback) {
+// |options.fresh| asks for values read now rather than a recent snapshot.
+exports.getPropertyValue = function(prop, successCallback, errorCallback, options) {
   if (typeof prop !== 'string' || props_array.indexOf(prop) < 0)
     throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
 
@@ -173,19 +131,117 @@ exports.getPropertyValue = function(prop, successCallback, errorCallback) {
     } else if (errorCallback) {
       errorCallback(error);
     }
-  });
+  }, options && options.fresh);
 };
 
-var _hasListener = function(prop) {
-  var count = 0;
+// Reads several properties with one message. |successCallback| gets an
+// object with the value of each property which could be read, and
+// |errorCallback| one with the error of each property which couldn't.
+exports.getPropertyValues = function(props, successCallback, errorCallback, options) {
+  if (!Array.isArray(props))
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+
+  for (var i = 0; i < props.length; ++i) {
+    if (typeof props[i] !== 'string' || props_array.indexOf(props[i]) < 0)
+      throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+  }
 
-  for (var i in _listeners) {
-    if (_listeners[i]['prop'] === prop) {
-      count += 1;
+  if (typeof successCallback !== 'function')
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+
+  if (arguments.length >= 3 && errorCallback !== null && errorCallback !== undefined &&
+      (typeof errorCallback !== 'function'))
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+
+  var msg = {
+    'cmd': 'getPropertyValues',
+    'props': props,
+    'fresh': !!(options && options.fresh)
+  };
+  postMessage(msg, function(r) {
+    var values = {};
+    var errors = {};
+    var has_errors = false;
+    for (var prop in r.values) {
+      if (r.values[prop].error) {
+        errors[prop] = r.values[prop].error;
+        has_errors = true;
+      } else {
+        values[prop] = _createConstClone(r.values[prop].data);
+      }
     }
+    successCallback(values);
+    if (has_errors && errorCallback)
+      errorCallback(errors);
+  });
+};
+
+var recordable_props = ['BATTERY', 'CPU', 'DISPLAY', 'WIFI_NETWORK',
+                        'PRESSURE', 'MEMORY', 'STORAGE', 'THERMAL',
+                        'PROCESS'];
+
+// Starts recording the value of |prop| natively, every |options.interval|
+// ms into a ring of |options.capacity| samples (1000 and 600 by default).
+exports.startRecording = function(prop, options) {
+  if (typeof prop !== 'string' || recordable_props.indexOf(prop) < 0)
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+
+  if (arguments.length == 2 && options !== null && (typeof options !== 'object'))
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+
+  var msg = {
+    'cmd': 'startRecording',
+    'prop': prop
+  };
+  if (options) {
+    ['interval', 'capacity'].forEach(function(key) {
+      var value = parseFloat(options[key]);
+      if (!isNaN(value))
+        msg[key] = value;
+    });
   }
+  extension.postMessage(JSON.stringify(msg));
+};
+
+exports.stopRecording = function(prop) {
+  if (typeof prop !== 'string' || recordable_props.indexOf(prop) < 0)
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
 
-  return (0 !== count);
+  var msg = {
+    'cmd': 'stopRecording',
+    'prop': prop
+  };
+  extension.postMessage(JSON.stringify(msg));
+};
+
+// Gets the recorded values of the last |options.window| ms (10 minutes by
+// default), reduced to at most |options.points| (60 by default) points of
+// { time, min, max, avg }.
+exports.getHistory = function(prop, successCallback, errorCallback, options) {
+  if (typeof prop !== 'string' || recordable_props.indexOf(prop) < 0)
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+
+  if (typeof successCallback !== 'function')
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+
+  if (arguments.length >= 3 && errorCallback !== null && errorCallback !== undefined &&
+      (typeof errorCallback !== 'function'))
+    throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
+
+  var msg = {
+    'cmd': 'getHistory',
+    'prop': prop,
+    'window': (options && parseFloat(options.window)) || 600000,
+    'points': (options && parseFloat(options.points)) || 60
+  };
+  postMessage(msg, function(r) {
+    if (r.error) {
+      if (errorCallback)
+        errorCallback(r.error);
+      return;
+    }
+    successCallback(_createConstClone({ 'points': r.data })['points']);
+  });
 };
 
 exports.addPropertyValueChangeListener = function(prop, successCallback, option) {
@@ -198,25 +254,32 @@ exports.addPropertyValueChangeListener = function(prop, successCallback, option)
   if (arguments.length == 3 && option !== null && (typeof option !== 'object'))
     throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
 
-  if (!_hasListener(prop)) {
-    var msg = {
-      'cmd': 'startListening',
-      'prop': prop
-    };
-    extension.postMessage(JSON.stringify(msg));
-  }
-
-  var timeStamp = (new Date()).valueOf();
-  var listener = {
+  var listener_id = _next_listener_id;
+  _next_listener_id += 1;
+  _listeners[listener_id] = {
     'prop': prop,
     'callback': successCallback,
-    'option': option,
-    'timestamp': timeStamp
+    'timeout': (option && parseFloat(option.timeout)) || 0,
+    'timestamp': (new Date()).valueOf()
   };
 
-  var listener_id = _next_listener_id;
-  _next_listener_id += 1;
-  _listeners[listener_id] = listener;
+  // Thresholds are applied natively, so values which don't pass them aren't
+  // even sent. So are the non-standard |option.interval|, the minimum time
+  // between two calls in ms, which polled properties also sample at, and
+  // |option.deadband|, the smallest change worth a call.
+  var msg = {
+    'cmd': 'startListening',
+    'prop': prop,
+    'listenerId': listener_id
+  };
+  if (option) {
+    ['highThreshold', 'lowThreshold', 'interval', 'deadband'].forEach(function(key) {
+      var value = parseFloat(option[key]);
+      if (!isNaN(value))
+        msg[key] = value;
+    });
+  }
+  extension.postMessage(JSON.stringify(msg));
 
   return listener_id;
 };
@@ -225,14 +288,15 @@ exports.removePropertyValueChangeListener = function(listenerId) {
   if (typeof listenerId !== 'number')
     throw new tizen.WebAPIException(tizen.WebAPIException.TYPE_MISMATCH_ERR);
 
-  var prop = _listeners[listenerId]['prop'];
+  var listener = _listeners[listenerId];
+  if (!listener)
+    return;
 
   delete _listeners[listenerId];
-  if (!_hasListener(prop)) {
-    var msg = {
-      'cmd': 'stopListening',
-      'prop': prop
-    };
-    extension.postMessage(JSON.stringify(msg));
-  }
+  var msg = {
+    'cmd': 'stopListening',
+    'prop': listener['prop'],
+    'listenerId': listenerId
+  };
+  extension.postMessage(JSON.stringify(msg));
 };
@@ -35,15 +35,22 @@ class SysInfoBattery : public SysInfoObject {
   static const std::string name_;
 
  private:
+  const char* ThresholdAttribute() const { return "level"; }
   SysInfoBattery();
   bool Update(picojson::value& error);
   void SetData(picojson::value& data);
 
 #if defined(GENERIC_DESKTOP)
+  static bool ReadPowerSupply(udev_device* dev, void* user_data);
+  // Posts the values if they differ from what was posted last.
+  void CheckPowerSupply();
+  static void OnPowerSupplyEvent(udev_device* dev, void* user_data);
   static gboolean OnUpdateTimeout(gpointer user_data);
 
-  udev* udev_;
-  int timeout_cb_id_;
+  system_info::UdevWatch udev_watch_;
+  guint timeout_cb_id_;
+  double posted_level_;
+  bool posted_charging_;
 #elif defined(TIZEN)
   void UpdateLevel(double level);
   void UpdateCharging(bool charging);
@@ -7,35 +7,48 @@
 #include <libudev.h>
 #include <algorithm>
 #include <string>
+#include <utility>
 
 #include "common/picojson.h"
 
+namespace {
+
+// The capacity of batteries whose driver sends no uevent for it is read
+// this often, in ms.
+const guint kFallbackInterval = 30000;
+
+}  // namespace
+
 const std::string SysInfoBattery::name_ = "BATTERY";
 
 SysInfoBattery::SysInfoBattery()
-    : level_(0.0),
-      charging_(false),
-      timeout_cb_id_(0) {
-  udev_ = udev_new();
+    : udev_watch_("power_supply", SysInfoBattery::OnPowerSupplyEvent, this),
+      timeout_cb_id_(0),
+      posted_level_(0.0),
+      posted_charging_(false),
+      level_(0.0),
+      charging_(false) {
 }
 
 SysInfoBattery::~SysInfoBattery() {
-  if (udev_)
-    udev_unref(udev_);
-  if (timeout_cb_id_ > 0)
-    g_source_remove(timeout_cb_id_);
+  StopListening();
 }
 
 void SysInfoBattery::StartListening() {
-  // FIXME(halton): Use udev D-Bus interface to monitor.
-  if (timeout_cb_id_ == 0) {
-    timeout_cb_id_ = g_timeout_add(system_info::default_timeout_interval,
-                                   SysInfoBattery::OnUpdateTimeout,
-                                   static_cast<gpointer>(this));
-  }
+  // Power supply drivers send a uevent when the status changes, but many
+  // don't for the capacity, which is polled slowly for them.
+  picojson::value error = picojson::value(picojson::object());
+  Update(error);
+  posted_level_ = level_;
+  posted_charging_ = charging_;
+  udev_watch_.Start();
+  if (timeout_cb_id_ == 0)
+    timeout_cb_id_ = g_timeout_add(kFallbackInterval,
+                                   SysInfoBattery::OnUpdateTimeout, this);
 }
 
 void SysInfoBattery::StopListening() {
+  udev_watch_.Stop();
   if (timeout_cb_id_ > 0) {
     g_source_remove(timeout_cb_id_);
     timeout_cb_id_ = 0;
@@ -54,41 +67,14 @@ void SysInfoBattery::Get(picojson::value& error,
   system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
 }
 
+// The power supplies are listed by the UdevService, but their properties
+// are read again: many drivers don't send a uevent when the capacity
+// changes.
 bool SysInfoBattery::Update(picojson::value& error) {
-  bool found;
-  struct udev_enumerate *enumerate;
-  struct udev_list_entry *devices, *dev_list_entry;
-
-  enumerate = udev_enumerate_new(udev_);
-  udev_enumerate_add_match_subsystem(enumerate, "power_supply");
-  udev_enumerate_scan_devices(enumerate);
-  devices = udev_enumerate_get_list_entry(enumerate);
-
-  found = false;
-  udev_list_entry_foreach(dev_list_entry, devices) {
-    const char *path  = udev_list_entry_get_name(dev_list_entry);
-    struct udev_device* dev = udev_device_new_from_syspath(udev_, path);
-
-    std::string str_capacity =
-        system_info::GetUdevProperty(dev, "POWER_SUPPLY_CAPACITY");
-    std::string str_charging =
-        system_info::GetUdevProperty(dev, "POWER_SUPPLY_STATUS");
-    if (str_capacity.empty() && str_charging.empty()) {
-      udev_device_unref(dev);
-      continue;
-    }
-
-    // Found the battery
-    int capacity = std::min(100, atoi(str_capacity.c_str()));
-    level_ = static_cast<double>(capacity / 100);
-    charging_ = (str_charging == "Discharging");
-
-    udev_device_unref(dev);
-    found = true;
-    break;
-  }
-
-  udev_enumerate_unref(enumerate);
+  bool found = false;
+  std::pair<SysInfoBattery*, bool*> context(this, &found);
+  system_info::UdevService::GetInstance().ForEachDevice("power_supply",
+      ReadPowerSupply, &context);
 
   if (!found) {
     system_info::SetPicoJsonObjectValue(error, "message",
@@ -98,32 +84,62 @@ bool SysInfoBattery::Update(picojson::value& error) {
   return found;
 }
 
-gboolean SysInfoBattery::OnUpdateTimeout(gpointer user_data) {
-  SysInfoBattery* instance = static_cast<SysInfoBattery*>(user_data);
+bool SysInfoBattery::ReadPowerSupply(udev_device* dev, void* user_data) {
+  std::pair<SysInfoBattery*, bool*>* context =
+      static_cast<std::pair<SysInfoBattery*, bool*>*>(user_data);
+
+  udev_device* current = udev_device_new_from_syspath(
+      udev_device_get_udev(dev), udev_device_get_syspath(dev));
+  if (!current)
+    return true;
+  std::string str_capacity =
+      system_info::GetUdevProperty(current, "POWER_SUPPLY_CAPACITY");
+  std::string str_charging =
+      system_info::GetUdevProperty(current, "POWER_SUPPLY_STATUS");
+  udev_device_unref(current);
+  if (str_capacity.empty() && str_charging.empty())
+    return true;
+
+  // Found the battery
+  int capacity = std::min(100, atoi(str_capacity.c_str()));
+  context->first->level_ = static_cast<double>(capacity) / 100;
+  context->first->charging_ = (str_charging == "Charging");
+  *context->second = true;
+  return false;
+}
 
-  double old_level = instance->level_;
-  double old_charging = instance->charging_;
+// Compared with what was posted, as Get() refreshes the values too.
+void SysInfoBattery::CheckPowerSupply() {
   picojson::value error = picojson::value(picojson::object());
-  if (!instance->Update(error)) {
-    // Fail to update, wait for next round
-    return TRUE;
+  if (!Update(error)) {
+    // Fail to update, wait for the next event
+    return;
   }
 
-  if ((old_level != instance->level_) ||
-      (old_charging != instance->charging_)) {
-    picojson::value output = picojson::value(picojson::object());
-    picojson::value data = picojson::value(picojson::object());
+  if (posted_level_ == level_ && posted_charging_ == charging_)
+    return;
+  posted_level_ = level_;
+  posted_charging_ = charging_;
 
-    instance->SetData(data);
-    system_info::SetPicoJsonObjectValue(output, "cmd",
-        picojson::value("SystemInfoPropertyValueChanged"));
-    system_info::SetPicoJsonObjectValue(output, "prop",
-        picojson::value("BATTERY"));
-    system_info::SetPicoJsonObjectValue(output, "data", data);
+  picojson::value output = picojson::value(picojson::object());
+  picojson::value data = picojson::value(picojson::object());
 
-    instance->PostMessageToListeners(output);
-  }
+  SetData(data);
+  system_info::SetPicoJsonObjectValue(output, "cmd",
+      picojson::value("SystemInfoPropertyValueChanged"));
+  system_info::SetPicoJsonObjectValue(output, "prop",
+      picojson::value("BATTERY"));
+  system_info::SetPicoJsonObjectValue(output, "data", data);
 
+  PostMessageToListeners(output);
+}
+
+void SysInfoBattery::OnPowerSupplyEvent(udev_device* dev, void* user_data) {
+  static_cast<SysInfoBattery*>(user_data)->CheckPowerSupply();
+}
+
+gboolean SysInfoBattery::OnUpdateTimeout(gpointer user_data) {
+  static_cast<SysInfoBattery*>(user_data)->CheckPowerSupply();
   return TRUE;
 }
 
@@ -14,7 +14,10 @@ SysInfoBattery::SysInfoBattery()
     : level_(0.0),
       charging_(false) {}
 
-SysInfoBattery::~SysInfoBattery() {}
+SysInfoBattery::~SysInfoBattery() {
+  if (has_listeners())
+    StopListening();
+}
 
 void SysInfoBattery::Get(picojson::value& error,
                          picojson::value& data) {
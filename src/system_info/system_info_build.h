@@ -19,39 +19,31 @@ class SysInfoBuild : public SysInfoObject {
     static SysInfoBuild instance;
     return instance;
   }
-  ~SysInfoBuild() {
-    if (timeout_cb_id_ > 0)
-      g_source_remove(timeout_cb_id_);
-  }
+  ~SysInfoBuild() {}
   void Get(picojson::value& error, picojson::value& data);
+  // The build information only changes when the files it comes from do.
   inline void StartListening() {
-    if (timeout_cb_id_ == 0) {
-      timeout_cb_id_ = g_timeout_add(system_info::default_timeout_interval,
-                                     SysInfoBuild::OnUpdateTimeout,
-                                     static_cast<gpointer>(this));
-    }
+    UpdateHardware();
+    UpdateOSBuild();
+    file_watch_.Start();
   }
   inline void StopListening() {
-    if (timeout_cb_id_ > 0) {
-      g_source_remove(timeout_cb_id_);
-      timeout_cb_id_ = 0;
-    }
+    file_watch_.Stop();
   }
 
   static const std::string name_;
 
  private:
-  SysInfoBuild()
-      : timeout_cb_id_(0) {}
+  SysInfoBuild();
 
   bool UpdateHardware();
   bool UpdateOSBuild();
-  static gboolean OnUpdateTimeout(gpointer user_data);
+  static void OnBuildFilesChanged(void* user_data);
 
   std::string model_;
   std::string manufacturer_;
   std::string buildversion_;
-  int timeout_cb_id_;
+  system_info::FileWatch file_watch_;
 
   DISALLOW_COPY_AND_ASSIGN(SysInfoBuild);
 };
@@ -15,6 +15,12 @@
 
 const std::string SysInfoBuild::name_ = "BUILD";
 
+SysInfoBuild::SysInfoBuild()
+    : file_watch_(SysInfoBuild::OnBuildFilesChanged, this) {
+  file_watch_.AddPath("/var/log/dmesg");
+  file_watch_.AddPath("/etc/os-release");
+}
+
 void SysInfoBuild::Get(picojson::value& error,
                        picojson::value& data) {
   // model and manufacturer
@@ -42,20 +48,25 @@ void SysInfoBuild::Get(picojson::value& error,
 
 bool SysInfoBuild::UpdateHardware() {
   FILE* fp = fopen("/var/log/dmesg", "r");
+  if (!fp)
+    return false;
 
-  int dmipos;
+  size_t dmipos = std::string::npos;
   size_t length = 300;
   char* cinfo = NULL;
   std::string info;
 
-  do {
-    getline(&cinfo, &length, fp);
+  // The file is re-read when it changes, so it may well be incomplete.
+  while (dmipos == std::string::npos &&
+         getline(&cinfo, &length, fp) != -1) {
     info = cinfo;
     dmipos = info.find("] DMI: ", 0);
-  } while (dmipos == std::string::npos);
-  info.erase(0, dmipos + 7);
+  }
   free(cinfo);
   fclose(fp);
+  if (dmipos == std::string::npos)
+    return false;
+  info.erase(0, dmipos + 7);
 
   int head = 0;
   int tail = -1;
@@ -99,7 +110,7 @@ bool SysInfoBuild::UpdateOSBuild() {
   }
 }
 
-gboolean SysInfoBuild::OnUpdateTimeout(gpointer user_data) {
+void SysInfoBuild::OnBuildFilesChanged(void* user_data) {
   SysInfoBuild* instance = static_cast<SysInfoBuild*>(user_data);
 
   std::string oldmodel_ = instance->model_;
@@ -126,8 +137,6 @@ gboolean SysInfoBuild::OnUpdateTimeout(gpointer user_data) {
         picojson::value("BUILD"));
     system_info::SetPicoJsonObjectValue(output, "data", data);
 
-    instance->PostMessageToListeners(output);;
+    instance->PostMessageToListeners(output);
   }
-
-  return TRUE;
 }
@@ -13,6 +13,12 @@
 
 const std::string SysInfoBuild::name_ = "BUILD";
 
+SysInfoBuild::SysInfoBuild()
+    : file_watch_(SysInfoBuild::OnBuildFilesChanged, this) {
+  file_watch_.AddPath("/etc/info.ini");
+  file_watch_.AddPath("/etc/config/model-config.xml");
+}
+
 void SysInfoBuild::Get(picojson::value& error,
                        picojson::value& data) {
   // model and manufacturer
@@ -86,7 +92,7 @@ bool SysInfoBuild::UpdateOSBuild() {
   return true;
 }
 
-gboolean SysInfoBuild::OnUpdateTimeout(gpointer user_data) {
+void SysInfoBuild::OnBuildFilesChanged(void* user_data) {
   SysInfoBuild* instance = static_cast<SysInfoBuild*>(user_data);
 
   std::string oldmodel_ = instance->model_;
@@ -113,8 +119,6 @@ gboolean SysInfoBuild::OnUpdateTimeout(gpointer user_data) {
         picojson::value("BUILD"));
     system_info::SetPicoJsonObjectValue(output, "data", data);
 
-    instance->PostMessageToListeners(output);;
+    instance->PostMessageToListeners(output);
   }
-
-  return TRUE;
 }
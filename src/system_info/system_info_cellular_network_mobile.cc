@@ -21,7 +21,10 @@ SysInfoCellularNetwork::SysInfoCellularNetwork()
       isFlightMode_(false),
       imei_("") {}
 
-SysInfoCellularNetwork::~SysInfoCellularNetwork() {}
+SysInfoCellularNetwork::~SysInfoCellularNetwork() {
+  if (has_listeners())
+    StopListening();
+}
 
 void SysInfoCellularNetwork::SetCellStatus() {
   int cell_status = 0;
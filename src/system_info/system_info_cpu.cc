@@ -4,34 +4,121 @@
 
 #include "system_info/system_info_cpu.h"
 
+#include <fcntl.h>
+#include <math.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <string>
 
+namespace {
+
+// Polling backs off up to this interval while the load doesn't change.
+const unsigned kMaxTimeoutInterval = 8 * system_info::default_timeout_interval;
+
+// Changes below this are considered noise for the back-off.
+const double kLoadEpsilon = 0.01;
+
+// Enough for the "cpu" lines of a handful of cores.
+const size_t kStatBufferSize = 4096;
+
+typedef unsigned long long Jiffies; //NOLINT
+
+const char* SkipSpaces(const char* p, const char* end) {
+  while (p < end && *p == ' ')
+    ++p;
+  return p;
+}
+
+// Parses the unsigned integer at |*p| and moves past it; false if there is
+// none.
+bool ParseNumber(const char** p, const char* end, Jiffies* value) {
+  const char* q = SkipSpaces(*p, end);
+  if (q == end || *q < '0' || *q > '9')
+    return false;
+  Jiffies v = 0;
+  for (; q < end && *q >= '0' && *q <= '9'; ++q)
+    v = v * 10 + (*q - '0');
+  *p = q;
+  *value = v;
+  return true;
+}
+
+}  // namespace
+
 const std::string SysInfoCpu::name_ = "CPU";
 
+SysInfoCpu::SysInfoCpu()
+    : stat_fd_(open("/proc/stat", O_RDONLY | O_CLOEXEC)),
+      stat_buffer_(kStatBufferSize),
+      timeout_cb_id_(0),
+      interval_(system_info::default_timeout_interval) {
+  pthread_mutex_init(&mutex_, NULL);
+  UpdateLoad();
+}
+
+SysInfoCpu::~SysInfoCpu() {
+  if (timeout_cb_id_ > 0)
+    g_source_remove(timeout_cb_id_);
+  for (unsigned i = 0; i < cores_.size(); ++i) {
+    if (cores_[i].freq_fd >= 0)
+      close(cores_[i].freq_fd);
+  }
+  if (stat_fd_ >= 0)
+    close(stat_fd_);
+  pthread_mutex_destroy(&mutex_);
+}
+
 void SysInfoCpu::Get(picojson::value& error,
                      picojson::value& data) {
+  AutoLock lock(&mutex_);
   if (!UpdateLoad()) {
     system_info::SetPicoJsonObjectValue(error, "message",
         picojson::value("Get CPU load failed."));
     return;
   }
 
-  system_info::SetPicoJsonObjectValue(data, "load", picojson::value(load_));
+  SetData(data);
   system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
 }
 
+void SysInfoCpu::SetData(picojson::value& data) {
+  system_info::SetPicoJsonObjectValue(data, "load",
+      picojson::value(ticks_.load));
+
+  // Offline cores are left out.
+  picojson::array cores;
+  for (unsigned i = 0; i < cores_.size(); ++i) {
+    if (!cores_[i].online)
+      continue;
+    picojson::object core;
+    core["id"] = picojson::value(static_cast<double>(i));
+    core["load"] = picojson::value(cores_[i].ticks.load);
+    core["frequency"] = picojson::value(cores_[i].frequency);
+    cores.push_back(picojson::value(core));
+  }
+  system_info::SetPicoJsonObjectValue(data, "cores", picojson::value(cores));
+}
+
 gboolean SysInfoCpu::OnUpdateTimeout(gpointer user_data) {
   SysInfoCpu* instance = static_cast<SysInfoCpu*>(user_data);
 
-  double old_load = instance->load_;
-  instance->UpdateLoad();
-  if (old_load != instance->load_) {
+  double old_load;
+  double load;
+  picojson::value data = picojson::value(picojson::object());
+  {
+    AutoLock lock(&instance->mutex_);
+    old_load = instance->ticks_.load;
+    instance->UpdateLoad();
+    load = instance->ticks_.load;
+    if (old_load != load)
+      instance->SetData(data);
+  }
+  if (old_load != load) {
     picojson::value output = picojson::value(picojson::object());
-    picojson::value data = picojson::value(picojson::object());
 
-    system_info::SetPicoJsonObjectValue(data, "load",
-        picojson::value(instance->load_));
     system_info::SetPicoJsonObjectValue(output, "cmd",
         picojson::value("SystemInfoPropertyValueChanged"));
     system_info::SetPicoJsonObjectValue(output, "prop", picojson::value("CPU"));
@@ -40,17 +127,38 @@ gboolean SysInfoCpu::OnUpdateTimeout(gpointer user_data) {
     instance->PostMessageToListeners(output);
   }
 
-  return TRUE;
+  // A listener asking for an interval gets sampled at that pace, otherwise
+  // back off while the load stays put.
+  unsigned interval = instance->sampling_interval();
+  if (!instance->sampling_interval_requested() &&
+      fabs(old_load - load) < kLoadEpsilon)
+    interval = std::min(instance->interval_ * 2, kMaxTimeoutInterval);
+  if (interval == instance->interval_)
+    return TRUE;
+
+  instance->interval_ = interval;
+  instance->timeout_cb_id_ = g_timeout_add(interval,
+                                           SysInfoCpu::OnUpdateTimeout,
+                                           user_data);
+  return FALSE;
 }
 
 void SysInfoCpu::StartListening() {
   if (timeout_cb_id_ == 0) {
-    timeout_cb_id_ = g_timeout_add(system_info::default_timeout_interval,
+    interval_ = sampling_interval();
+    timeout_cb_id_ = g_timeout_add(interval_,
                                    SysInfoCpu::OnUpdateTimeout,
                                    static_cast<gpointer>(this));
   }
 }
 
+void SysInfoCpu::OnListenersChanged() {
+  if (timeout_cb_id_ == 0 || interval_ == sampling_interval())
+    return;
+  StopListening();
+  StartListening();
+}
+
 void SysInfoCpu::StopListening() {
   if (timeout_cb_id_ > 0) {
     g_source_remove(timeout_cb_id_);
@@ -58,44 +166,117 @@ void SysInfoCpu::StopListening() {
   }
 }
 
+// The algorithm here can be found at:
+// http://stackoverflow.com/questions/3017162
+// /how-to-get-total-cpu-usage-in-linux-c
+//
+// The process is:
+// work_over_period = work_jiffies_2 - work_jiffies_1
+// total_over_period = total_jiffies_2 - total_jiffies_1
+// cpu_load = work_over_period / total_over_period
+//
+// The aggregate line and the per core lines are read in one go, with
+// pread() on a descriptor kept open and without stdio.
 bool SysInfoCpu::UpdateLoad() {
-  FILE *fp = fopen("/proc/stat", "r");
-  if (!fp)
+  if (stat_fd_ < 0)
     return false;
 
-  unsigned long long user; //NOLINT
-  unsigned long long nice; //NOLINT
-  unsigned long long system; //NOLINT
-  unsigned long long idle; //NOLINT
-  unsigned long long iowait; //NOLINT
-  unsigned long long irq; //NOLINT
-  unsigned long long softirq; //NOLINT
+  ssize_t size;
+  while (true) {
+    size = pread(stat_fd_, &stat_buffer_[0], stat_buffer_.size(), 0);
+    if (size <= 0)
+      return false;
+    // The "cpu" lines are all there once a line with something else shows
+    // up.
+    const char* end = &stat_buffer_[0] + size;
+    const char* p = &stat_buffer_[0];
+    bool complete = false;
+    while (const char* eol = static_cast<const char*>(
+        memchr(p, '\n', end - p))) {
+      if (strncmp(p, "cpu", 3) != 0) {
+        complete = true;
+        break;
+      }
+      p = eol + 1;
+    }
+    if (complete || static_cast<size_t>(size) < stat_buffer_.size())
+      break;
+    stat_buffer_.resize(stat_buffer_.size() * 2);
+  }
 
-  unsigned long long total; //NOLINT
-  unsigned long long used; //NOLINT
+  for (unsigned i = 0; i < cores_.size(); ++i)
+    cores_[i].online = false;
 
-  if (fscanf(fp, "%*s %llu %llu %llu %llu %llu %llu %llu",
-             &user, &nice, &system, &idle, &iowait, &irq, &softirq) != 7) {
-      fclose(fp);
+  const char* end = &stat_buffer_[0] + size;
+  const char* p = &stat_buffer_[0];
+  bool have_total = false;
+  while (p + 3 < end && strncmp(p, "cpu", 3) == 0) {
+    p += 3;
+    Ticks* ticks = &ticks_;
+    Jiffies index;
+    if (*p != ' ' && ParseNumber(&p, end, &index)) {
+      if (index >= cores_.size())
+        cores_.resize(index + 1);
+      cores_[index].online = true;
+      ticks = &cores_[index].ticks;
+    } else {
+      have_total = true;
+    }
+
+    // user nice system idle iowait irq softirq steal guest guest_nice; the
+    // last ones are missing on older kernels.
+    Jiffies fields[10] = { 0 };
+    int count = 0;
+    while (count < 10 && ParseNumber(&p, end, &fields[count]))
+      ++count;
+    if (count < 4)
       return false;
+
+    // guest and guest_nice are already accounted in user and nice, steal
+    // is time the hypervisor didn't give us.
+    Jiffies used = fields[0] + fields[1] + fields[2] + fields[5] + fields[6];
+    Jiffies total = used + fields[3] + fields[4] + fields[7];
+    if (total > ticks->total)
+      ticks->load = static_cast<double>(used - ticks->used) /
+          (total - ticks->total);
+    ticks->total = total;
+    ticks->used = used;
+
+    const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (!eol)
+      break;
+    p = eol + 1;
   }
-  fclose(fp);
 
-  // The algorithm here can be found at:
-  // http://stackoverflow.com/questions/3017162
-  // /how-to-get-total-cpu-usage-in-linux-c
-  //
-  // The process is:
-  // work_over_period = work_jiffies_2 - work_jiffies_1
-  // total_over_period = total_jiffies_2 - total_jiffies_1
-  // cpu_load = work_over_period / total_over_period
-  used = user + nice + system;
-  total = used + idle + iowait + irq + softirq;
+  for (unsigned i = 0; i < cores_.size(); ++i) {
+    if (cores_[i].online)
+      UpdateFrequency(i, &cores_[i]);
+  }
 
-  load_ = static_cast<double>(used - old_used_) / (total - old_total_);
+  return have_total;
+}
 
-  old_total_ = total;
-  old_used_ = used;
+// In MHz, 0 where cpufreq isn't available.
+void SysInfoCpu::UpdateFrequency(int index, Core* core) {
+  if (core->freq_fd < 0) {
+    char path[64];
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", index);
+    core->freq_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (core->freq_fd < 0)
+      return;
+  }
 
-  return true;
+  char buffer[32];
+  ssize_t size = pread(core->freq_fd, buffer, sizeof(buffer), 0);
+  const char* p = buffer;
+  Jiffies khz;
+  if (size <= 0 || !ParseNumber(&p, buffer + size, &khz)) {
+    // The core went offline, its cpufreq directory is gone.
+    close(core->freq_fd);
+    core->freq_fd = -1;
+    core->frequency = 0.0;
+    return;
+  }
+  core->frequency = khz / 1000.0;
 }
@@ -6,8 +6,10 @@
 #define SYSTEM_INFO_SYSTEM_INFO_CPU_H_
 #include <stdio.h>
 #include <glib.h>
+#include <pthread.h>
 
 #include <string>
+#include <vector>
 
 #include "common/picojson.h"
 #include "common/utils.h"
@@ -20,34 +22,57 @@ class SysInfoCpu : public SysInfoObject {
     static SysInfoCpu instance;
     return instance;
   }
-  ~SysInfoCpu() {
-    if (timeout_cb_id_ > 0)
-      g_source_remove(timeout_cb_id_);
-  }
+  ~SysInfoCpu();
   // Get support
   void Get(picojson::value& error, picojson::value& data);
 
   // Listerner support
   void StartListening();
   void StopListening();
+  void OnListenersChanged();
+  bool CanGetConcurrently() const { return true; }
 
   static const std::string name_;
 
  private:
-  SysInfoCpu()
-      : load_(0.0),
-        old_total_(0),
-        old_used_(0),
-        timeout_cb_id_(0) {
-    UpdateLoad();
-  }
+  // Jiffies of one "cpu" line of /proc/stat.
+  struct Ticks {
+    Ticks() : total(0), used(0), load(0.0) {}
+
+    unsigned long long total; //NOLINT
+    unsigned long long used; //NOLINT
+    double load;
+  };
+
+  struct Core {
+    Core() : online(false), freq_fd(-1), frequency(0.0) {}
+
+    bool online;
+    Ticks ticks;
+    // scaling_cur_freq, kept open like /proc/stat.
+    int freq_fd;
+    double frequency;
+  };
+
+  const char* ThresholdAttribute() const { return "load"; }
+  SysInfoCpu();
   static gboolean OnUpdateTimeout(gpointer user_data);
   bool UpdateLoad();
+  void UpdateFrequency(int index, Core* core);
+  void SetData(picojson::value& data);
 
-  double load_;
-  unsigned long long old_total_; //NOLINT
-  unsigned long long old_used_; //NOLINT
+  // Guards the values below against a concurrent Get() and the GLib main
+  // loop.
+  pthread_mutex_t mutex_;
+  Ticks ticks_;
+  std::vector<Core> cores_;
+  int stat_fd_;
+  // Grown until the "cpu" lines of /proc/stat fit.
+  std::vector<char> stat_buffer_;
   int timeout_cb_id_;
+  // Grows while the load stays put, so an idle system isn't polled each
+  // second.
+  unsigned interval_;
 
   DISALLOW_COPY_AND_ASSIGN(SysInfoCpu);
 };
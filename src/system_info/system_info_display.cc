@@ -0,0 +1,103 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The parts of SysInfoDisplay which don't depend on the display server.
+
+#include "system_info/system_info_display.h"
+
+#include <stdlib.h>
+
+#include "common/picojson.h"
+
+#if defined(GENERIC_DESKTOP)
+  #define ACPI_BACKLIGHT_DIR "/sys/class/backlight/acpi_video0"
+#elif defined(TIZEN)
+  #define ACPI_BACKLIGHT_DIR "/sys/class/backlight/psb-bl"
+#else
+  #error "Unsupported platform"
+#endif
+
+void SysInfoDisplay::Get(picojson::value& error,
+                         picojson::value& data) {
+  if (!UpdateSize()) {
+    system_info::SetPicoJsonObjectValue(error, "message",
+        picojson::value("Get display size failed."));
+    return;
+  }
+
+  if (!UpdateBrightness()) {
+    system_info::SetPicoJsonObjectValue(error, "message",
+        picojson::value("Get display brightness failed."));
+    return;
+  }
+
+  SetData(data);
+  system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
+}
+
+bool SysInfoDisplay::UpdateBrightness() {
+  char* str_val;
+
+  str_val = system_info::ReadOneLine(ACPI_BACKLIGHT_DIR"/max_brightness");
+  if (!str_val) {
+    // FIXME(halton): ACPI is not enabled, fallback to maximum.
+    brightness_ = 1.0;
+    return true;
+  }
+  double max_val = strtod(str_val, NULL);
+  free(str_val);
+
+  str_val = system_info::ReadOneLine(ACPI_BACKLIGHT_DIR"/brightness");
+  if (!str_val) {
+    // FIXME(halton): ACPI is not enabled, fallback to maximum.
+    brightness_ = 1.0;
+    return true;
+  }
+  double val = strtod(str_val, NULL);
+  free(str_val);
+
+  brightness_ = val / max_val;
+  return true;
+}
+
+// The backlight class sends a change uevent when the brightness is changed.
+void SysInfoDisplay::OnBacklightEvent(udev_device* dev, void* user_data) {
+  SysInfoDisplay* instance = static_cast<SysInfoDisplay*>(user_data);
+  instance->CheckDisplayChanged();
+}
+
+void SysInfoDisplay::CheckDisplayChanged() {
+  double old_brightness = brightness_;
+  if (!UpdateBrightness()) {
+    // Fail to update brightness, wait for the next event
+    return;
+  }
+
+  int old_resolution_width = resolution_width_;
+  int old_resolution_height = resolution_height_;
+  double old_physical_width = physical_width_;
+  double old_physical_height = physical_height_;
+  if (!UpdateSize()) {
+    // Fail to update size, wait for the next event
+    return;
+  }
+
+  if ((old_brightness != brightness_) ||
+      (old_resolution_width != resolution_width_) ||
+      (old_resolution_height != resolution_height_) ||
+      (old_physical_width != physical_width_) ||
+      (old_physical_height != physical_height_)) {
+    picojson::value output = picojson::value(picojson::object());
+    picojson::value data = picojson::value(picojson::object());
+
+    SetData(data);
+    system_info::SetPicoJsonObjectValue(output, "cmd",
+        picojson::value("SystemInfoPropertyValueChanged"));
+    system_info::SetPicoJsonObjectValue(output, "prop",
+        picojson::value("DISPLAY"));
+    system_info::SetPicoJsonObjectValue(output, "data", data);
+
+    PostMessageToListeners(output);
+  }
+}
@@ -20,34 +20,26 @@ class SysInfoDisplay : public SysInfoObject {
     static SysInfoDisplay instance;
     return instance;
   }
-  ~SysInfoDisplay() {
-    if (timeout_cb_id_ > 0)
-      g_source_remove(timeout_cb_id_);
-  }
+  ~SysInfoDisplay();
   // Get support
   void Get(picojson::value& error, picojson::value& data);
   // Listerner support
-  inline void StartListening() {
-    // FIXME(halton): Use Xlib event or D-Bus interface to monitor.
-    if (timeout_cb_id_ == 0) {
-      timeout_cb_id_ = g_timeout_add(system_info::default_timeout_interval,
-                                     SysInfoDisplay::OnUpdateTimeout,
-                                     static_cast<gpointer>(this));
-    }
-  }
-  inline void StopListening() {
-    if (timeout_cb_id_ > 0) {
-      g_source_remove(timeout_cb_id_);
-      timeout_cb_id_ = 0;
-    }
-  }
+  void StartListening();
+  void StopListening();
 
   static const std::string name_;
 
+  // Connection to the display server, for output change events.
+  struct Monitor;
+
  private:
+  const char* ThresholdAttribute() const { return "brightness"; }
   SysInfoDisplay();
 
-  static gboolean OnUpdateTimeout(gpointer user_data);
+  static gboolean OnDisplayEvent(GIOChannel* channel, GIOCondition condition,
+                                 gpointer user_data);
+  static void OnBacklightEvent(udev_device* dev, void* user_data);
+  void CheckDisplayChanged();
   bool UpdateSize();
   bool UpdateBrightness();
   void SetData(picojson::value& data);
@@ -59,8 +51,9 @@ class SysInfoDisplay : public SysInfoObject {
   double physical_width_;
   double physical_height_;
   double brightness_;
-  int timeout_cb_id_;
   int scale_factor_;
+  Monitor* monitor_;
+  system_info::UdevWatch backlight_watch_;
 
   DISALLOW_COPY_AND_ASSIGN(SysInfoDisplay);
 };
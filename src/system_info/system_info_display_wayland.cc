@@ -4,21 +4,15 @@
 
 #include <wayland-client.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
+#include <vector>
 
 #include "system_info/system_info_display.h"
 
 #include "common/picojson.h"
 
-#if defined(GENERIC_DESKTOP)
-  #define ACPI_BACKLIGHT_DIR "/sys/class/backlight/acpi_video0"
-#elif defined(TIZEN)
-  #define ACPI_BACKLIGHT_DIR "/sys/class/backlight/psb-bl"
-#else
-  #error "Unsupported platform"
-#endif
-
 class Display {
  public:
   Display();
@@ -121,6 +115,87 @@ static void get_wayland_screen_size(Display* display) {
   wl_registry_add_listener(display->registry, &kRegistryListener, display);
 }
 
+// Outputs of a monitoring connection only need to tell that something
+// changed, the new values are read as usual.
+struct SysInfoDisplay::Monitor {
+  Monitor()
+      : display(NULL),
+        registry(NULL),
+        source_id(0),
+        changed(false) {}
+
+  wl_display* display;
+  wl_registry* registry;
+  std::vector<wl_output*> outputs;
+  guint source_id;
+  bool changed;
+};
+
+static void monitor_handle_geometry(void* data,
+                                    wl_output* output,
+                                    int x,
+                                    int y,
+                                    int physical_width,
+                                    int physical_height,
+                                    int subpixel,
+                                    const char* make,
+                                    const char* model,
+                                    int transform) {}
+
+static void monitor_handle_mode(void* data,
+                                wl_output* output,
+                                uint32_t flags,
+                                int width,
+                                int height,
+                                int refresh) {}
+
+// Sent after all the changes of an output, from version 2 on.
+static void monitor_handle_done(void* data,
+                                wl_output* output) {
+  SysInfoDisplay::Monitor* m = reinterpret_cast<SysInfoDisplay::Monitor*>(data);
+  m->changed = true;
+}
+
+static void monitor_handle_scale(void* data,
+                                 wl_output* output,
+                                 int factor) {}
+
+static void monitor_handle_global(void* data,
+                                  wl_registry* registry,
+                                  uint32_t id,
+                                  const char* interface,
+                                  uint32_t version) {
+  SysInfoDisplay::Monitor* m = reinterpret_cast<SysInfoDisplay::Monitor*>(data);
+
+  static const wl_output_listener kMonitorOutputListener = {
+    monitor_handle_geometry,
+    monitor_handle_mode,
+    monitor_handle_done,
+    monitor_handle_scale
+  };
+
+  if (strcmp(interface, "wl_output") == 0) {
+    void* v = wl_registry_bind(registry, id, &wl_output_interface,
+                               std::min<uint32_t>(version, 2));
+    wl_output* output = reinterpret_cast<wl_output*>(v);
+    wl_output_add_listener(output, &kMonitorOutputListener, m);
+    m->outputs.push_back(output);
+    m->changed = true;  // a new screen
+  }
+}
+
+static void monitor_handle_global_remove(void* data,
+                                         wl_registry* registry,
+                                         uint32_t name) {
+  SysInfoDisplay::Monitor* m = reinterpret_cast<SysInfoDisplay::Monitor*>(data);
+  m->changed = true;
+}
+
+static const wl_registry_listener kMonitorRegistryListener = {
+    monitor_handle_global,
+    monitor_handle_global_remove
+};
+
 const std::string SysInfoDisplay::name_ = "DISPLAY";
 
 SysInfoDisplay::SysInfoDisplay()
@@ -131,25 +206,72 @@ SysInfoDisplay::SysInfoDisplay()
       physical_width_(0.0),
       physical_height_(0.0),
       brightness_(0.0),
-      timeout_cb_id_(0),
-      scale_factor_(0) {}
-
-void SysInfoDisplay::Get(picojson::value& error,
-                         picojson::value& data) {
-  if (!UpdateSize()) {
-    system_info::SetPicoJsonObjectValue(error, "message",
-        picojson::value("Get display size failed."));
+      scale_factor_(0),
+      monitor_(NULL),
+      backlight_watch_("backlight", OnBacklightEvent, this) {}
+
+SysInfoDisplay::~SysInfoDisplay() {
+  StopListening();
+}
+
+// wl_output events tell about mode and geometry changes, the backlight class
+// about brightness changes; in between there is nothing to do.
+void SysInfoDisplay::StartListening() {
+  UpdateSize();
+  UpdateBrightness();
+  backlight_watch_.Start();
+  if (monitor_)
+    return;
+
+  wl_display* display = wl_display_connect(NULL);
+  if (!display) {
+    std::cerr << "Wayland server connection error" << std::endl;
     return;
   }
 
-  if (!UpdateBrightness()) {
-    system_info::SetPicoJsonObjectValue(error, "message",
-        picojson::value("Get display brightness failed."));
+  monitor_ = new Monitor;
+  monitor_->display = display;
+  monitor_->registry = wl_display_get_registry(display);
+  wl_registry_add_listener(monitor_->registry, &kMonitorRegistryListener,
+                           monitor_);
+  wl_display_roundtrip(display);  // the outputs
+  wl_display_roundtrip(display);  // their current state
+  monitor_->changed = false;  // the initial state was just read
+  monitor_->source_id = system_info::AddFdWatch(wl_display_get_fd(display),
+      SysInfoDisplay::OnDisplayEvent, this);
+}
+
+void SysInfoDisplay::StopListening() {
+  backlight_watch_.Stop();
+  if (!monitor_)
     return;
+  g_source_remove(monitor_->source_id);
+  for (unsigned i = 0; i < monitor_->outputs.size(); ++i)
+    wl_output_destroy(monitor_->outputs[i]);
+  wl_registry_destroy(monitor_->registry);
+  wl_display_flush(monitor_->display);
+  wl_display_disconnect(monitor_->display);
+  delete monitor_;
+  monitor_ = NULL;
+}
+
+gboolean SysInfoDisplay::OnDisplayEvent(GIOChannel* channel,
+                                        GIOCondition condition,
+                                        gpointer user_data) {
+  SysInfoDisplay* instance = static_cast<SysInfoDisplay*>(user_data);
+  Monitor* monitor = instance->monitor_;
+
+  if (wl_display_dispatch(monitor->display) < 0) {
+    std::cerr << "Wayland server connection lost" << std::endl;
+    instance->StopListening();
+    return FALSE;
   }
 
-  SetData(data);
-  system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
+  if (monitor->changed) {
+    monitor->changed = false;
+    instance->CheckDisplayChanged();
+  }
+  return TRUE;
 }
 
 bool SysInfoDisplay::UpdateSize() {
@@ -183,70 +305,6 @@ bool SysInfoDisplay::UpdateSize() {
   return true;
 }
 
-bool SysInfoDisplay::UpdateBrightness() {
-  char* str_val;
-
-  str_val = system_info::ReadOneLine(ACPI_BACKLIGHT_DIR"/max_brightness");
-  if (!str_val) {
-    // FIXME(halton): ACPI is not enabled, fallback to maximum.
-    brightness_ = 1.0;
-    return true;
-  }
-  double max_val = strtod(str_val, NULL);
-  free(str_val);
-
-  str_val = system_info::ReadOneLine(ACPI_BACKLIGHT_DIR"/brightness");
-  if (!str_val) {
-    // FIXME(halton): ACPI is not enabled, fallback to maximum.
-    brightness_ = 1.0;
-    return true;
-  }
-  double val = strtod(str_val, NULL);
-  free(str_val);
-
-  brightness_ = val / max_val;
-  return true;
-}
-
-gboolean SysInfoDisplay::OnUpdateTimeout(gpointer user_data) {
-  SysInfoDisplay* instance = static_cast<SysInfoDisplay*>(user_data);
-
-  double old_brightness = instance->brightness_;
-  if (!instance->UpdateBrightness()) {
-    // Fail to update brightness, wait for next round
-    return TRUE;
-  }
-
-  int old_resolution_width = instance->resolution_width_;
-  int old_resolution_height = instance->resolution_width_;
-  double old_physical_width = instance->physical_width_;
-  double old_physical_height = instance->physical_height_;
-  if (!instance->UpdateSize()) {
-    // Fail to update size, wait for next round
-    return TRUE;
-  }
-
-  if ((old_brightness != instance->brightness_) ||
-      (old_resolution_width != instance->resolution_width_) ||
-      (old_resolution_height != instance->resolution_width_) ||
-      (old_physical_width != instance->physical_width_) ||
-      (old_physical_height != instance->physical_height_)) {
-    picojson::value output = picojson::value(picojson::object());;
-    picojson::value data = picojson::value(picojson::object());
-
-    instance->SetData(data);
-    system_info::SetPicoJsonObjectValue(output, "cmd",
-        picojson::value("SystemInfoPropertyValueChanged"));
-    system_info::SetPicoJsonObjectValue(output, "prop",
-        picojson::value("DISPLAY"));
-    system_info::SetPicoJsonObjectValue(output, "data", data);
-
-    instance->PostMessageToListeners(output);
-  }
-
-  return TRUE;
-}
-
 void SysInfoDisplay::SetData(picojson::value& data) {
   system_info::SetPicoJsonObjectValue(data, "brightness",
       picojson::value(brightness_));
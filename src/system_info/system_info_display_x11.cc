@@ -7,19 +7,18 @@
 #include <stdio.h>
 
 #include <X11/Xlib.h>
+#include <X11/extensions/Xrandr.h>
 
 #include "common/picojson.h"
 
-#if defined(GENERIC_DESKTOP)
-  #define ACPI_BACKLIGHT_DIR "/sys/class/backlight/acpi_video0"
-#elif defined(TIZEN)
-  #define ACPI_BACKLIGHT_DIR "/sys/class/backlight/psb-bl"
-#else
-  #error "Unsupported platform"
-#endif
-
 const std::string SysInfoDisplay::name_ = "DISPLAY";
 
+struct SysInfoDisplay::Monitor {
+  Display* dpy;
+  int randr_event_base;
+  guint source_id;
+};
+
 SysInfoDisplay::SysInfoDisplay()
     : resolution_width_(0),
       resolution_height_(0),
@@ -28,24 +27,71 @@ SysInfoDisplay::SysInfoDisplay()
       physical_width_(0.0),
       physical_height_(0.0),
       brightness_(0.0),
-      timeout_cb_id_(0) {}
+      scale_factor_(1),
+      monitor_(NULL),
+      backlight_watch_("backlight", OnBacklightEvent, this) {}
+
+SysInfoDisplay::~SysInfoDisplay() {
+  StopListening();
+}
 
-void SysInfoDisplay::Get(picojson::value& error,
-                         picojson::value& data) {
-  if (!UpdateSize()) {
-    system_info::SetPicoJsonObjectValue(error, "message",
-        picojson::value("Get display size failed."));
+// RandR tells about resolution and output changes, the backlight class about
+// brightness changes; in between there is nothing to do.
+void SysInfoDisplay::StartListening() {
+  UpdateSize();
+  UpdateBrightness();
+  backlight_watch_.Start();
+  if (monitor_)
+    return;
+
+  Display* dpy = XOpenDisplay(NULL);
+  if (!dpy)
+    return;
+  int event_base, error_base;
+  if (!XRRQueryExtension(dpy, &event_base, &error_base)) {
+    std::cout << "RandR is not available, display changes are not seen\n";
+    XCloseDisplay(dpy);
     return;
   }
+  XRRSelectInput(dpy, DefaultRootWindow(dpy), RRScreenChangeNotifyMask);
+  XFlush(dpy);
+
+  monitor_ = new Monitor;
+  monitor_->dpy = dpy;
+  monitor_->randr_event_base = event_base;
+  monitor_->source_id = system_info::AddFdWatch(ConnectionNumber(dpy),
+      SysInfoDisplay::OnDisplayEvent, this);
+}
 
-  if (!UpdateBrightness()) {
-    system_info::SetPicoJsonObjectValue(error, "message",
-        picojson::value("Get display brightness failed."));
+void SysInfoDisplay::StopListening() {
+  backlight_watch_.Stop();
+  if (!monitor_)
     return;
+  g_source_remove(monitor_->source_id);
+  XCloseDisplay(monitor_->dpy);
+  delete monitor_;
+  monitor_ = NULL;
+}
+
+gboolean SysInfoDisplay::OnDisplayEvent(GIOChannel* channel,
+                                        GIOCondition condition,
+                                        gpointer user_data) {
+  SysInfoDisplay* instance = static_cast<SysInfoDisplay*>(user_data);
+  Monitor* monitor = instance->monitor_;
+
+  bool changed = false;
+  while (XPending(monitor->dpy)) {
+    XEvent event;
+    XNextEvent(monitor->dpy, &event);
+    if (event.type == monitor->randr_event_base + RRScreenChangeNotify) {
+      XRRUpdateConfiguration(&event);
+      changed = true;
+    }
   }
 
-  SetData(data);
-  system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
+  if (changed)
+    instance->CheckDisplayChanged();
+  return TRUE;
 }
 
 bool SysInfoDisplay::UpdateSize() {
@@ -64,70 +110,6 @@ bool SysInfoDisplay::UpdateSize() {
   return true;
 }
 
-bool SysInfoDisplay::UpdateBrightness() {
-  char* str_val;
-
-  str_val = system_info::ReadOneLine(ACPI_BACKLIGHT_DIR"/max_brightness");
-  if (!str_val) {
-    // FIXME(halton): ACPI is not enabled, fallback to maximum.
-    brightness_ = 1.0;
-    return true;
-  }
-  double max_val = strtod(str_val, NULL);
-  free(str_val);
-
-  str_val = system_info::ReadOneLine(ACPI_BACKLIGHT_DIR"/brightness");
-  if (!str_val) {
-    // FIXME(halton): ACPI is not enabled, fallback to maximum.
-    brightness_ = 1.0;
-    return true;
-  }
-  double val = strtod(str_val, NULL);
-  free(str_val);
-
-  brightness_ = val / max_val;
-  return true;
-}
-
-gboolean SysInfoDisplay::OnUpdateTimeout(gpointer user_data) {
-  SysInfoDisplay* instance = static_cast<SysInfoDisplay*>(user_data);
-
-  double old_brightness = instance->brightness_;
-  if (!instance->UpdateBrightness()) {
-    // Fail to update brightness, wait for next round
-    return TRUE;
-  }
-
-  int old_resolution_width = instance->resolution_width_;
-  int old_resolution_height = instance->resolution_width_;
-  double old_physical_width = instance->physical_width_;
-  double old_physical_height = instance->physical_height_;
-  if (!instance->UpdateSize()) {
-    // Fail to update size, wait for next round
-    return TRUE;
-  }
-
-  if ((old_brightness != instance->brightness_) ||
-      (old_resolution_width != instance->resolution_width_) ||
-      (old_resolution_height != instance->resolution_width_) ||
-      (old_physical_width != instance->physical_width_) ||
-      (old_physical_height != instance->physical_height_)) {
-    picojson::value output = picojson::value(picojson::object());;
-    picojson::value data = picojson::value(picojson::object());
-
-    instance->SetData(data);
-    system_info::SetPicoJsonObjectValue(output, "cmd",
-        picojson::value("SystemInfoPropertyValueChanged"));
-    system_info::SetPicoJsonObjectValue(output, "prop",
-        picojson::value("DISPLAY"));
-    system_info::SetPicoJsonObjectValue(output, "data", data);
-
-    instance->PostMessageToListeners(output);
-  }
-
-  return TRUE;
-}
-
 void SysInfoDisplay::SetData(picojson::value& data) {
   system_info::SetPicoJsonObjectValue(data, "brightness",
       picojson::value(brightness_));
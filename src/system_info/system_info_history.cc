@@ -0,0 +1,207 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "system_info/system_info_history.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "system_info/system_info_instance.h"
+#include "system_info/system_info_utils.h"
+
+namespace {
+
+const unsigned kTimeUnit = 100;  // ms
+
+// Properties which can be recorded, and the scale of their samples.
+const struct {
+  const char* prop;
+  double scale;
+} kRecordable[] = {
+  { "BATTERY", 10000 },  // level in [0, 1]
+  { "CPU", 10000 },  // load in [0, 1]
+  { "DISPLAY", 10000 },  // brightness in [0, 1]
+  { "WIFI_NETWORK", 10000 },  // signal strength in [0, 1]
+  { "PRESSURE", 100 },  // percent
+  { "THERMAL", 100 },  // degrees Celsius
+  { "PROCESS", 10000 },  // CPU load in [0, 1]
+  { "MEMORY", 1.0 / (1 << 20) },  // bytes, kept in MiB
+  { "STORAGE", 1.0 / (1 << 20) },
+};
+
+int32_t ToFixedPoint(double value, double scale) {
+  double scaled = floor(value * scale + 0.5);
+  scaled = std::max<double>(scaled, std::numeric_limits<int32_t>::min());
+  scaled = std::min<double>(scaled, std::numeric_limits<int32_t>::max());
+  return static_cast<int32_t>(scaled);
+}
+
+gint64 Now() {
+  return g_get_monotonic_time() / 1000;
+}
+
+}  // namespace
+
+SysInfoHistory::SysInfoHistory() {
+  pthread_mutex_init(&mutex_, NULL);
+}
+
+SysInfoHistory::~SysInfoHistory() {
+  while (!recordings_.empty())
+    Remove(recordings_.begin());
+  pthread_mutex_destroy(&mutex_);
+}
+
+bool SysInfoHistory::Start(const std::string& prop, SysInfoObject* object,
+                           SystemInfoInstance* owner, unsigned interval,
+                           unsigned capacity) {
+  double scale = 0;
+  for (unsigned i = 0; i < sizeof(kRecordable) / sizeof(kRecordable[0]); ++i) {
+    if (prop == kRecordable[i].prop)
+      scale = kRecordable[i].scale;
+  }
+  if (!scale || !object->ThresholdAttribute() || !capacity)
+    return false;
+
+  AutoLock lock(&mutex_);
+  std::map<std::string, Recording*>::iterator it = recordings_.find(prop);
+  if (it != recordings_.end()) {
+    it->second->owners.insert(owner);
+    return true;
+  }
+
+  Recording* recording = new Recording;
+  recording->prop = prop;
+  recording->object = object;
+  recording->scale = scale;
+  recording->base_time = Now();
+  recording->samples.resize(capacity);
+  recording->next = 0;
+  recording->count = 0;
+  recording->owners.insert(owner);
+  recording->timeout_id = g_timeout_add(std::max(interval, kTimeUnit),
+      SysInfoHistory::OnSampleTimeout, recording);
+  recordings_[prop] = recording;
+  return true;
+}
+
+void SysInfoHistory::Stop(const std::string& prop, SystemInfoInstance* owner) {
+  AutoLock lock(&mutex_);
+  std::map<std::string, Recording*>::iterator it = recordings_.find(prop);
+  if (it == recordings_.end())
+    return;
+  it->second->owners.erase(owner);
+  if (it->second->owners.empty())
+    Remove(it);
+}
+
+void SysInfoHistory::StopAll(SystemInfoInstance* owner) {
+  AutoLock lock(&mutex_);
+  std::map<std::string, Recording*>::iterator it = recordings_.begin();
+  while (it != recordings_.end()) {
+    std::map<std::string, Recording*>::iterator current = it++;
+    current->second->owners.erase(owner);
+    if (current->second->owners.empty())
+      Remove(current);
+  }
+}
+
+void SysInfoHistory::Remove(std::map<std::string, Recording*>::iterator it) {
+  g_source_remove(it->second->timeout_id);
+  delete it->second;
+  recordings_.erase(it);
+}
+
+gboolean SysInfoHistory::OnSampleTimeout(gpointer user_data) {
+  Recording* recording = static_cast<Recording*>(user_data);
+
+  // Get() may take a while, the lock is only needed to store the sample.
+  picojson::value error = picojson::value(picojson::object());
+  picojson::value data = picojson::value(picojson::object());
+  recording->object->Get(error, data);
+  const picojson::value& value =
+      data.get(recording->object->ThresholdAttribute());
+  if (!error.get("message").to_str().empty() || !value.is<double>())
+    return TRUE;
+
+  SysInfoHistory& history = GetInstance();
+  AutoLock lock(&history.mutex_);
+  Sample& sample = recording->samples[recording->next];
+  sample.time = static_cast<uint32_t>(
+      (Now() - recording->base_time) / kTimeUnit);
+  sample.value = ToFixedPoint(value.get<double>(), recording->scale);
+  recording->next = (recording->next + 1) % recording->samples.size();
+  recording->count = std::min(recording->count + 1,
+                              recording->samples.size());
+  return TRUE;
+}
+
+bool SysInfoHistory::Query(const std::string& prop, unsigned window,
+                           unsigned points, picojson::array* buckets) {
+  AutoLock lock(&mutex_);
+  std::map<std::string, Recording*>::const_iterator it =
+      recordings_.find(prop);
+  if (it == recordings_.end())
+    return false;
+  const Recording* recording = it->second;
+  if (!window || !points)
+    return true;
+
+  struct Bucket {
+    Bucket()
+        : min(std::numeric_limits<int32_t>::max()),
+          max(std::numeric_limits<int32_t>::min()),
+          sum(0),
+          count(0) {}
+
+    int32_t min;
+    int32_t max;
+    int64_t sum;
+    unsigned count;
+  };
+  std::vector<Bucket> reduced(points);
+
+  // In ms since base_time.
+  gint64 now = Now();
+  gint64 end = now - recording->base_time;
+  gint64 start = end - window;
+  size_t first = (recording->next + recording->samples.size() -
+                  recording->count) % recording->samples.size();
+  for (size_t i = 0; i < recording->count; ++i) {
+    const Sample& sample =
+        recording->samples[(first + i) % recording->samples.size()];
+    gint64 time = static_cast<gint64>(sample.time) * kTimeUnit;
+    if (time < start)
+      continue;
+    unsigned index = std::min<gint64>((time - start) * points / window,
+                                      points - 1);
+    Bucket& bucket = reduced[index];
+    bucket.min = std::min(bucket.min, sample.value);
+    bucket.max = std::max(bucket.max, sample.value);
+    bucket.sum += sample.value;
+    ++bucket.count;
+  }
+
+  // Wall clock time of |start|.
+  double start_time = g_get_real_time() / 1000 - window;
+  double scale = recording->scale;
+  for (unsigned i = 0; i < points; ++i) {
+    const Bucket& bucket = reduced[i];
+    if (!bucket.count)
+      continue;
+    picojson::object o;
+    o["time"] = picojson::value(
+        start_time + static_cast<double>(i) * window / points);
+    o["min"] = picojson::value(bucket.min / scale);
+    o["max"] = picojson::value(bucket.max / scale);
+    o["avg"] = picojson::value(
+        static_cast<double>(bucket.sum) / bucket.count / scale);
+    buckets->push_back(picojson::value(o));
+  }
+  return true;
+}
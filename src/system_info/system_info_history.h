@@ -0,0 +1,79 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYSTEM_INFO_SYSTEM_INFO_HISTORY_H_
+#define SYSTEM_INFO_SYSTEM_INFO_HISTORY_H_
+
+#include <glib.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common/picojson.h"
+#include "common/utils.h"
+
+class SysInfoObject;
+class SystemInfoInstance;
+
+// Records the numeric value of some properties (the one listener thresholds
+// apply to) into fixed size rings, so apps can chart the recent past
+// without polling. A recording is shared by the instances which started it
+// and stops when the last of them stops it.
+class SysInfoHistory {
+ public:
+  static SysInfoHistory& GetInstance() {
+    static SysInfoHistory instance;
+    return instance;
+  }
+  ~SysInfoHistory();
+
+  // Samples |object| every |interval| ms, keeping the last |capacity|
+  // samples. Returns false if |prop| can't be recorded. A recording which
+  // already runs keeps its interval and capacity.
+  bool Start(const std::string& prop, SysInfoObject* object,
+             SystemInfoInstance* owner, unsigned interval, unsigned capacity);
+  void Stop(const std::string& prop, SystemInfoInstance* owner);
+  void StopAll(SystemInfoInstance* owner);
+
+  // The samples of the last |window| ms, reduced to at most |points|
+  // buckets of equal duration with their time (ms since the epoch), min,
+  // max and avg. Returns false if |prop| isn't recorded.
+  bool Query(const std::string& prop, unsigned window, unsigned points,
+             picojson::array* buckets);
+
+ private:
+  // 8 bytes a sample; the value is fixed point with a per property scale.
+  struct Sample {
+    uint32_t time;  // in 100ms since Recording::base_time
+    int32_t value;
+  };
+
+  struct Recording {
+    std::string prop;
+    SysInfoObject* object;
+    double scale;
+    guint timeout_id;
+    // Monotonic time in ms.
+    gint64 base_time;
+    std::vector<Sample> samples;
+    size_t next;
+    size_t count;
+    std::set<SystemInfoInstance*> owners;
+  };
+
+  SysInfoHistory();
+  void Remove(std::map<std::string, Recording*>::iterator it);
+  static gboolean OnSampleTimeout(gpointer user_data);
+
+  pthread_mutex_t mutex_;
+  std::map<std::string, Recording*> recordings_;
+
+  DISALLOW_COPY_AND_ASSIGN(SysInfoHistory);
+};
+
+#endif  // SYSTEM_INFO_SYSTEM_INFO_HISTORY_H_
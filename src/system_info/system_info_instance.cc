@@ -27,8 +27,13 @@
 #include <system_info.h>
 #endif
 
+#include <algorithm>
+#include <future>  // NOLINT
+#include <map>
+#include <set>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "common/picojson.h"
 #include "system_info/system_info_battery.h"
@@ -36,7 +41,9 @@
 #include "system_info/system_info_cpu.h"
 #include "system_info/system_info_device_orientation.h"
 #include "system_info/system_info_display.h"
+#include "system_info/system_info_history.h"
 #include "system_info/system_info_locale.h"
+#include "system_info/system_info_memory.h"
 #ifdef GENERIC_DESKTOP
 #include "system_info/system_info_network_desktop.h"
 #else
@@ -45,20 +52,258 @@
 #include "system_info/system_info_sim.h"
 #endif
 #include "system_info/system_info_peripheral.h"
+#include "system_info/system_info_pressure.h"
+#include "system_info/system_info_process.h"
 #include "system_info/system_info_storage.h"
+#include "system_info/system_info_thermal.h"
 #include "system_info/system_info_utils.h"
+#include "system_info/system_info_wifi_access_points.h"
 #include "system_info/system_info_wifi_network.h"
 
+SysInfoObject::SysInfoObject()
+    : listeners_(new Listeners),
+      sampling_interval_(system_info::default_timeout_interval),
+      sampling_interval_requested_(false),
+      deadband_(0) {
+  pthread_mutex_init(&listeners_mutex_, NULL);
+}
+
+// The subclasses stop listening in their own destructor, and instances
+// remove their listeners when they go away.
+SysInfoObject::~SysInfoObject() {
+  pthread_mutex_destroy(&listeners_mutex_);
+}
+
+void SysInfoObject::AddListener(SystemInfoInstance* instance, int id,
+                                const ListenerOptions& options) {
+  AutoLock lock(&listeners_mutex_);
+  Listeners listeners(*Snapshot());
+  listeners.push_back(
+      std::shared_ptr<Listener>(new Listener(instance, id, options)));
+  Publish(listeners);
+
+  if (listeners.size() > 1)
+    OnListenersChanged();
+  else
+    StartListening();
+  OnListenerAdded(instance, id);
+}
+
+void SysInfoObject::RemoveListener(SystemInfoInstance* instance, int id) {
+  AutoLock lock(&listeners_mutex_);
+  std::shared_ptr<const Listeners> old_listeners = Snapshot();
+  Listeners listeners;
+  for (unsigned i = 0; i < old_listeners->size(); ++i) {
+    const std::shared_ptr<Listener>& listener = (*old_listeners)[i];
+    if (listener->instance != instance || listener->id != id)
+      listeners.push_back(listener);
+    else
+      CancelDeferred(listener.get());
+  }
+  if (listeners.size() == old_listeners->size())
+    return;
+  Publish(listeners);
+
+  if (listeners.empty())
+    StopListening();
+  else
+    OnListenersChanged();
+}
+
+void SysInfoObject::RemoveListeners(SystemInfoInstance* instance) {
+  AutoLock lock(&listeners_mutex_);
+  std::shared_ptr<const Listeners> old_listeners = Snapshot();
+  Listeners listeners;
+  for (unsigned i = 0; i < old_listeners->size(); ++i) {
+    const std::shared_ptr<Listener>& listener = (*old_listeners)[i];
+    if (listener->instance != instance)
+      listeners.push_back(listener);
+    else
+      CancelDeferred(listener.get());
+  }
+  if (listeners.size() == old_listeners->size())
+    return;
+  Publish(listeners);
+
+  if (listeners.empty())
+    StopListening();
+  else
+    OnListenersChanged();
+}
+
+// Posts still walking an older snapshot may go on: they keep the removed
+// listeners alive, and go through PostTarget, which the instance detaches
+// before it's destroyed.
+void SysInfoObject::Publish(const Listeners& listeners) {
+  UpdateSamplingOptions(listeners);
+  std::atomic_store(&listeners_,
+      std::shared_ptr<const Listeners>(new Listeners(listeners)));
+}
+
+void SysInfoObject::PostMessageToListeners(const picojson::value& output) {
+  std::shared_ptr<const Listeners> listeners = Snapshot();
+
+  const char* attribute = ThresholdAttribute();
+  const picojson::value& value = attribute ?
+      output.get("data").get(attribute) : picojson::value();
+  gint64 now = g_get_monotonic_time() / 1000;
+
+  // Listeners of one instance share a message. The snapshot keeps the
+  // targets alive.
+  std::map<SystemInfoInstance::PostTarget*, picojson::array> targets;
+  bool filtered = !PostsChanges();
+  for (unsigned i = 0; i < listeners->size(); ++i) {
+    Listener& listener = *(*listeners)[i];
+    const ListenerOptions& options = listener.options;
+    if (!filtered) {
+      targets[listener.target.get()].push_back(
+          picojson::value(static_cast<double>(listener.id)));
+      continue;
+    }
+    if (value.is<double>() &&
+        (options.high_threshold >= 0 || options.low_threshold >= 0)) {
+      double v = value.get<double>();
+      if (!(options.high_threshold >= 0 && v >= options.high_threshold) &&
+          !(options.low_threshold >= 0 && v <= options.low_threshold))
+        continue;
+    }
+    if (options.interval) {
+      gint64 last_post_time = listener.last_post_time.load();
+      if (last_post_time && now - last_post_time < options.interval) {
+        Defer((*listeners)[i], output,
+              last_post_time + options.interval - now);
+        continue;
+      }
+      CancelDeferred(&listener);
+    }
+
+    listener.last_post_time = now;
+    targets[listener.target.get()].push_back(
+        picojson::value(static_cast<double>(listener.id)));
+  }
+
+  picojson::value message = output;
+  for (std::map<SystemInfoInstance::PostTarget*, picojson::array>::iterator
+       it = targets.begin(); it != targets.end(); ++it) {
+    system_info::SetPicoJsonObjectValue(message, "listenerIds",
+        picojson::value(it->second));
+    it->first->PostMessage(message.serialize());
+  }
+}
+
+// A value changing again within a listener's interval would otherwise go
+// untold until the next change, however late that comes: the latest one is
+// held back until the interval is over instead.
+void SysInfoObject::Defer(const std::shared_ptr<Listener>& listener,
+                          const picojson::value& output, unsigned delay) {
+  AutoLock lock(&listener->deferred_mutex);
+  listener->deferred = output;
+  if (listener->deferred_timeout_id)
+    return;
+  listener->deferred_timeout_id = g_timeout_add_full(G_PRIORITY_DEFAULT,
+      delay, SysInfoObject::OnDeferredTimeout,
+      new std::shared_ptr<Listener>(listener),
+      SysInfoObject::ReleaseDeferred);
+}
+
+void SysInfoObject::CancelDeferred(Listener* listener) {
+  AutoLock lock(&listener->deferred_mutex);
+  listener->deferred = picojson::value();
+  if (listener->deferred_timeout_id) {
+    g_source_remove(listener->deferred_timeout_id);
+    listener->deferred_timeout_id = 0;
+  }
+}
+
+gboolean SysInfoObject::OnDeferredTimeout(gpointer user_data) {
+  Listener& listener = **static_cast<std::shared_ptr<Listener>*>(user_data);
+  picojson::value message;
+  {
+    AutoLock lock(&listener.deferred_mutex);
+    listener.deferred_timeout_id = 0;
+    message.swap(listener.deferred);
+  }
+  if (message.is<picojson::null>())
+    return FALSE;
+
+  listener.last_post_time = g_get_monotonic_time() / 1000;
+  picojson::array ids;
+  ids.push_back(picojson::value(static_cast<double>(listener.id)));
+  system_info::SetPicoJsonObjectValue(message, "listenerIds",
+      picojson::value(ids));
+  listener.target->PostMessage(message.serialize());
+  return FALSE;
+}
+
+void SysInfoObject::ReleaseDeferred(gpointer user_data) {
+  delete static_cast<std::shared_ptr<Listener>*>(user_data);
+}
+
+void SysInfoObject::PostMessageToListener(SystemInfoInstance* instance,
+                                          int id,
+                                          const picojson::value& output) {
+  picojson::value message = output;
+  picojson::array ids;
+  ids.push_back(picojson::value(static_cast<double>(id)));
+  system_info::SetPicoJsonObjectValue(message, "listenerIds",
+      picojson::value(ids));
+  instance->post_target()->PostMessage(message.serialize());
+}
+
+void SysInfoObject::UpdateSamplingOptions(const Listeners& listeners) {
+  unsigned interval = 0;
+  double deadband = 0;
+  for (unsigned i = 0; i < listeners.size(); ++i) {
+    unsigned listener_interval = listeners[i]->options.interval;
+    if (listener_interval && (!interval || listener_interval < interval))
+      interval = listener_interval;
+    double listener_deadband = listeners[i]->options.deadband;
+    if (listener_deadband > 0 && (!deadband || listener_deadband < deadband))
+      deadband = listener_deadband;
+  }
+  deadband_ = deadband;
+  sampling_interval_requested_ = interval != 0;
+  sampling_interval_ = interval ? interval :
+      system_info::default_timeout_interval;
+}
+
 template <class T>
 void SystemInfoInstance::RegisterClass() {
   classes_.insert(SysInfoClassPair(T::name_ , T::GetInstance()));
 }
 
+SystemInfoInstance::PostTarget::PostTarget(SystemInfoInstance* instance)
+    : instance_(instance) {
+  pthread_mutex_init(&mutex_, NULL);
+}
+
+SystemInfoInstance::PostTarget::~PostTarget() {
+  pthread_mutex_destroy(&mutex_);
+}
+
+void SystemInfoInstance::PostTarget::PostMessage(const std::string& message) {
+  AutoLock lock(&mutex_);
+  if (instance_)
+    instance_->PostMessage(message.c_str());
+}
+
+void SystemInfoInstance::PostTarget::Detach() {
+  AutoLock lock(&mutex_);
+  instance_ = NULL;
+}
+
+SystemInfoInstance::SystemInfoInstance()
+    : post_target_(new PostTarget(this)) {
+}
+
 SystemInfoInstance::~SystemInfoInstance() {
+  // Only waits for a post to this instance, if one is in progress.
+  post_target_->Detach();
   for (classes_iterator it = classes_.begin();
        it != classes_.end(); ++it) {
-    (it->second).RemoveListener(this);
+    (it->second).RemoveListeners(this);
   }
+  SysInfoHistory::GetInstance().StopAll(this);
 }
 
 void SystemInfoInstance::InstancesMapInitialize() {
@@ -68,7 +313,10 @@ void SystemInfoInstance::InstancesMapInitialize() {
   RegisterClass<SysInfoDeviceOrientation>();
   RegisterClass<SysInfoDisplay>();
   RegisterClass<SysInfoLocale>();
+  RegisterClass<SysInfoMemory>();
   RegisterClass<SysInfoPeripheral>();
+  RegisterClass<SysInfoPressure>();
+  RegisterClass<SysInfoProcess>();
 #ifdef GENERIC_DESKTOP
   RegisterClass<SysInfoNetworkDesktop>();
 #else
@@ -77,7 +325,9 @@ void SystemInfoInstance::InstancesMapInitialize() {
   RegisterClass<SysInfoSim>();
 #endif
   RegisterClass<SysInfoStorage>();
+  RegisterClass<SysInfoThermal>();
   RegisterClass<SysInfoWifiNetwork>();
+  RegisterClass<SysInfoWifiAccessPoints>();
 }
 
 void SystemInfoInstance::HandleGetPropertyValue(const picojson::value& input,
@@ -97,6 +347,8 @@ void SystemInfoInstance::HandleGetPropertyValue(const picojson::value& input,
     system_info::SetPicoJsonObjectValue(error, "message",
         picojson::value("Property not supported: " + prop));
   } else {
+    if (input.get("fresh").evaluate_as_boolean())
+      (it->second).Invalidate();
     (it->second).Get(error, data);
   }
 
@@ -110,13 +362,100 @@ void SystemInfoInstance::HandleGetPropertyValue(const picojson::value& input,
   PostMessage(result.c_str());
 }
 
+// Reads several properties for one reply. Properties whose Get() blocks
+// on the system, and which lock what it shares with the GLib main loop,
+// are read by asynchronous tasks while the others are read here.
+void SystemInfoInstance::HandleGetPropertyValues(const picojson::value& input) {
+  picojson::value output = picojson::value(picojson::object());
+  system_info::SetPicoJsonObjectValue(output, "_reply_id",
+      picojson::value(input.get("_reply_id").to_str()));
+
+  std::vector<std::string> props;
+  std::set<std::string> seen;
+  const picojson::value& props_value = input.get("props");
+  if (props_value.is<picojson::array>()) {
+    const picojson::array& array = props_value.get<picojson::array>();
+    for (unsigned i = 0; i < array.size(); ++i) {
+      if (array[i].is<std::string>() && seen.insert(array[i].to_str()).second)
+        props.push_back(array[i].to_str());
+    }
+  }
+  bool fresh = input.get("fresh").evaluate_as_boolean();
+
+  std::vector<picojson::value> errors(props.size(),
+      picojson::value(picojson::object()));
+  std::vector<picojson::value> data(props.size(),
+      picojson::value(picojson::object()));
+  std::vector<SysInfoObject*> serial(props.size(), NULL);
+  std::vector<std::future<void> > tasks;
+  for (unsigned i = 0; i < props.size(); ++i) {
+    system_info::SetPicoJsonObjectValue(errors[i], "message",
+        picojson::value(""));
+    classes_iterator it = classes_.find(props[i]);
+    if (it == classes_.end()) {
+      system_info::SetPicoJsonObjectValue(errors[i], "message",
+          picojson::value("Property not supported: " + props[i]));
+      continue;
+    }
+
+    SysInfoObject* object = &it->second;
+    if (fresh)
+      object->Invalidate();
+    if (object->CanGetConcurrently()) {
+      picojson::value* error = &errors[i];
+      picojson::value* value = &data[i];
+      tasks.push_back(std::async(std::launch::async, [object, error, value]() {
+        object->Get(*error, *value);
+      }));
+    } else {
+      serial[i] = object;
+    }
+  }
+  for (unsigned i = 0; i < props.size(); ++i) {
+    if (serial[i])
+      serial[i]->Get(errors[i], data[i]);
+  }
+  for (unsigned i = 0; i < tasks.size(); ++i)
+    tasks[i].wait();
+
+  picojson::value values = picojson::value(picojson::object());
+  for (unsigned i = 0; i < props.size(); ++i) {
+    picojson::value value = picojson::value(picojson::object());
+    if (!errors[i].get("message").to_str().empty())
+      system_info::SetPicoJsonObjectValue(value, "error", errors[i]);
+    else
+      system_info::SetPicoJsonObjectValue(value, "data", data[i]);
+    system_info::SetPicoJsonObjectValue(values, props[i].c_str(), value);
+  }
+  system_info::SetPicoJsonObjectValue(output, "values", values);
+
+  std::string result = output.serialize();
+  PostMessage(result.c_str());
+}
+
 void SystemInfoInstance::HandleStartListening(const picojson::value& input) {
   std::string prop = input.get("prop").to_str();
   classes_iterator it = classes_.find(prop);
 
-  if (it != classes_.end()) {
-    (it->second).AddListener(this);
-  }
+  if (it == classes_.end())
+    return;
+
+  SysInfoObject::ListenerOptions options;
+  const picojson::value& high = input.get("highThreshold");
+  if (high.is<double>() && high.get<double>() >= 0)
+    options.high_threshold = high.get<double>();
+  const picojson::value& low = input.get("lowThreshold");
+  if (low.is<double>() && low.get<double>() >= 0)
+    options.low_threshold = low.get<double>();
+  const picojson::value& interval = input.get("interval");
+  if (interval.is<double>() && interval.get<double>() > 0)
+    options.interval = static_cast<unsigned>(interval.get<double>());
+  const picojson::value& deadband = input.get("deadband");
+  if (deadband.is<double>() && deadband.get<double>() > 0)
+    options.deadband = deadband.get<double>();
+
+  int id = static_cast<int>(input.get("listenerId").get<double>());
+  (it->second).AddListener(this, id, options);
 }
 
 void SystemInfoInstance::HandleStopListening(const picojson::value& input) {
@@ -124,10 +463,67 @@ void SystemInfoInstance::HandleStopListening(const picojson::value& input) {
   classes_iterator it = classes_.find(prop);
 
   if (it != classes_.end()) {
-    (it->second).RemoveListener(this);
+    int id = static_cast<int>(input.get("listenerId").get<double>());
+    (it->second).RemoveListener(this, id);
   }
 }
 
+void SystemInfoInstance::HandleStartRecording(const picojson::value& input) {
+  std::string prop = input.get("prop").to_str();
+  classes_iterator it = classes_.find(prop);
+  if (it == classes_.end())
+    return;
+
+  // Ten minutes of one sample a second by default.
+  unsigned interval = system_info::default_timeout_interval;
+  unsigned capacity = 600;
+  const picojson::value& interval_value = input.get("interval");
+  if (interval_value.is<double>() && interval_value.get<double>() > 0)
+    interval = static_cast<unsigned>(interval_value.get<double>());
+  const picojson::value& capacity_value = input.get("capacity");
+  if (capacity_value.is<double>() && capacity_value.get<double>() >= 1)
+    capacity = std::min(static_cast<unsigned>(capacity_value.get<double>()),
+                        86400u);
+
+  SysInfoHistory::GetInstance().Start(prop, &it->second, this, interval,
+                                      capacity);
+}
+
+void SystemInfoInstance::HandleStopRecording(const picojson::value& input) {
+  SysInfoHistory::GetInstance().Stop(input.get("prop").to_str(), this);
+}
+
+void SystemInfoInstance::HandleGetHistory(const picojson::value& input) {
+  picojson::value output = picojson::value(picojson::object());
+  system_info::SetPicoJsonObjectValue(output, "_reply_id",
+      picojson::value(input.get("_reply_id").to_str()));
+
+  std::string prop = input.get("prop").to_str();
+  unsigned window = 0;
+  unsigned points = 0;
+  const picojson::value& window_value = input.get("window");
+  if (window_value.is<double>() && window_value.get<double>() > 0)
+    window = static_cast<unsigned>(window_value.get<double>());
+  const picojson::value& points_value = input.get("points");
+  if (points_value.is<double>() && points_value.get<double>() >= 1)
+    points = std::min(static_cast<unsigned>(points_value.get<double>()),
+                      10000u);
+
+  picojson::array buckets;
+  if (SysInfoHistory::GetInstance().Query(prop, window, points, &buckets)) {
+    system_info::SetPicoJsonObjectValue(output, "data",
+        picojson::value(buckets));
+  } else {
+    picojson::value error = picojson::value(picojson::object());
+    system_info::SetPicoJsonObjectValue(error, "message",
+        picojson::value("Property not recorded: " + prop));
+    system_info::SetPicoJsonObjectValue(output, "error", error);
+  }
+
+  std::string result = output.serialize();
+  PostMessage(result.c_str());
+}
+
 void SystemInfoInstance::HandleMessage(const char* message) {
   picojson::value input;
   std::string err;
@@ -142,10 +538,18 @@ void SystemInfoInstance::HandleMessage(const char* message) {
   if (cmd == "getPropertyValue") {
     picojson::value output = picojson::value(picojson::object());
     HandleGetPropertyValue(input, output);
+  } else if (cmd == "getPropertyValues") {
+    HandleGetPropertyValues(input);
   } else if (cmd == "startListening") {
     HandleStartListening(input);
   } else if (cmd == "stopListening") {
     HandleStopListening(input);
+  } else if (cmd == "startRecording") {
+    HandleStartRecording(input);
+  } else if (cmd == "stopRecording") {
+    HandleStopRecording(input);
+  } else if (cmd == "getHistory") {
+    HandleGetHistory(input);
   }
 }
 
@@ -5,13 +5,18 @@
 #ifndef SYSTEM_INFO_SYSTEM_INFO_INSTANCE_H_
 #define SYSTEM_INFO_SYSTEM_INFO_INSTANCE_H_
 
-#include <list>
+#include <glib.h>
+
+#include <atomic>  // NOLINT
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "common/extension.h"
 #include "common/picojson.h"
+#include "common/utils.h"
 #include "system_info/system_info_utils.h"
 
 namespace picojson {
@@ -20,9 +25,34 @@ class value;
 
 class SystemInfoInstance : public common::Instance {
  public:
+  // Listeners post through this rather than to the instance, since a
+  // snapshot of them may still be posted to while the instance goes away:
+  // it lives as long as the listeners, and drops the posts which come once
+  // the instance is detached.
+  class PostTarget {
+   public:
+    explicit PostTarget(SystemInfoInstance* instance);
+    ~PostTarget();
+
+    void PostMessage(const std::string& message);
+    // Waits for a post in progress, if any.
+    void Detach();
+
+   private:
+    pthread_mutex_t mutex_;
+    SystemInfoInstance* instance_;
+
+    DISALLOW_COPY_AND_ASSIGN(PostTarget);
+  };
+
+  SystemInfoInstance();
   ~SystemInfoInstance();
   static void InstancesMapInitialize();
 
+  const std::shared_ptr<PostTarget>& post_target() const {
+    return post_target_;
+  }
+
  private:
   // common::Instance implementation.
   virtual void HandleMessage(const char* msg);
@@ -30,8 +60,12 @@ class SystemInfoInstance : public common::Instance {
 
   void HandleGetPropertyValue(const picojson::value& input,
                               picojson::value& output);
+  void HandleGetPropertyValues(const picojson::value& input);
   void HandleStartListening(const picojson::value& input);
   void HandleStopListening(const picojson::value& input);
+  void HandleStartRecording(const picojson::value& input);
+  void HandleStopRecording(const picojson::value& input);
+  void HandleGetHistory(const picojson::value& input);
   void HandleGetCapabilities();
   inline void SetStringPropertyValue(picojson::object& o,
                                      const char* prop,
@@ -42,58 +76,133 @@ class SystemInfoInstance : public common::Instance {
 
   template <class T>
   static void RegisterClass();
+
+  std::shared_ptr<PostTarget> post_target_;
 };
 
 class SysInfoObject {
  public:
-  SysInfoObject() {
-    pthread_mutex_init(&listeners_mutex_, NULL);
-  }
-
-  ~SysInfoObject() {
-    AutoLock* lock = new AutoLock(&listeners_mutex_);
-    for (std::list<SystemInfoInstance*>::iterator it = listeners_.begin();
-         it != listeners_.end(); it++) {
-      RemoveListener(*it);
-    }
-    delete lock;
-    pthread_mutex_destroy(&listeners_mutex_);
-  }
+  // The SystemInfoOptions a listener was added with.
+  struct ListenerOptions {
+    ListenerOptions()
+        : high_threshold(-1),
+          low_threshold(-1),
+          interval(0),
+          deadband(0) {}
+
+    // Negative when not set.
+    double high_threshold;
+    double low_threshold;
+    // Minimum time between two notifications in ms, 0 when not set. The
+    // standard timeout, after which a listener expires, is left to the JS.
+    unsigned interval;
+    // Smallest change of a value worth a notification, for properties
+    // reporting many values at once; 0 when not set.
+    double deadband;
+  };
+
+  SysInfoObject();
+  virtual ~SysInfoObject();
 
   // Get support
   virtual void Get(picojson::value& error, picojson::value& data) = 0;
+  // Drops what Get() may have cached, when an app asks for fresh data.
+  virtual void Invalidate() {}
+  // Whether Get() may run on another thread, next to the Get() of other
+  // properties. Such objects lock the state Get() shares with the GLib
+  // main loop.
+  virtual bool CanGetConcurrently() const { return false; }
 
   // Listener support
-  void AddListener(SystemInfoInstance* instance) {
-    AutoLock lock(&listeners_mutex_);
-    listeners_.push_back(instance);
+  void AddListener(SystemInfoInstance* instance, int id,
+                   const ListenerOptions& options);
+  void RemoveListener(SystemInfoInstance* instance, int id);
+  void RemoveListeners(SystemInfoInstance* instance);
+  virtual void StartListening() {}
+  virtual void StopListening() {}
+  // Called when listeners come and go while already listening.
+  virtual void OnListenersChanged() {}
+  // Posts |output| to the listeners whose options let it through, with the
+  // ids of those listeners added.
+  void PostMessageToListeners(const picojson::value& output);
+  // Numeric attribute of the data which listener thresholds and the
+  // history apply to, NULL if there is none.
+  virtual const char* ThresholdAttribute() const { return NULL; }
+  // Whether the posted data only tells what changed since the previous
+  // post. Every listener has to get every such post, so the listener
+  // intervals and thresholds don't apply to them.
+  virtual bool PostsChanges() const { return false; }
 
-    if (listeners_.size() > 1)
-      return;
-    StartListening();
+ protected:
+  bool has_listeners() const { return !Snapshot()->empty(); }
+
+  // Called once listener |id| of |instance| was added, after
+  // StartListening() or OnListenersChanged().
+  virtual void OnListenerAdded(SystemInfoInstance* instance, int id) {}
+  // Posts |output| to that listener only, with its id added.
+  void PostMessageToListener(SystemInfoInstance* instance, int id,
+                             const picojson::value& output);
+
+  // How often polled properties should sample: the smallest interval the
+  // listeners asked for, or the default interval.
+  unsigned sampling_interval() const { return sampling_interval_; }
+  bool sampling_interval_requested() const {
+    return sampling_interval_requested_;
   }
-  void RemoveListener(SystemInfoInstance* instance) {
-    AutoLock lock(&listeners_mutex_);
-    listeners_.remove(instance);
+  // The smallest deadband the listeners asked for, 0 when none did.
+  double deadband() const { return deadband_; }
 
-    if (!listeners_.empty())
-      return;
-    StopListening();
-  }
-  virtual void StartListening() {}
-  virtual void StopListening() {}
-  void PostMessageToListeners(const picojson::value& output) {
-    AutoLock lock(&listeners_mutex_);
-    std::string result = output.serialize();
-    for (std::list<SystemInfoInstance*>::iterator it = listeners_.begin();
-         it != listeners_.end(); it++) {
-      (*it)->PostMessage(result.c_str());
+ private:
+  struct Listener {
+    Listener(SystemInfoInstance* instance, int id,
+             const ListenerOptions& options)
+        : instance(instance),
+          target(instance->post_target()),
+          id(id),
+          options(options),
+          last_post_time(0),
+          deferred_timeout_id(0) {
+      pthread_mutex_init(&deferred_mutex, NULL);
+    }
+    ~Listener() {
+      pthread_mutex_destroy(&deferred_mutex);
     }
-  }
 
- protected:
+    // Only tells the listeners apart, |target| is posted to.
+    SystemInfoInstance* const instance;
+    const std::shared_ptr<SystemInfoInstance::PostTarget> target;
+    const int id;
+    const ListenerOptions options;
+    std::atomic<gint64> last_post_time;
+
+    // The latest post its interval held back, posted once it's over.
+    pthread_mutex_t deferred_mutex;
+    picojson::value deferred;
+    guint deferred_timeout_id;
+  };
+  typedef std::vector<std::shared_ptr<Listener> > Listeners;
+
+  std::shared_ptr<const Listeners> Snapshot() const {
+    return std::atomic_load(&listeners_);
+  }
+  void Publish(const Listeners& listeners);
+  static void Defer(const std::shared_ptr<Listener>& listener,
+                    const picojson::value& output, unsigned delay);
+  static void CancelDeferred(Listener* listener);
+  static gboolean OnDeferredTimeout(gpointer user_data);
+  static void ReleaseDeferred(gpointer user_data);
+  void UpdateSamplingOptions(const Listeners& listeners);
+
+  // The listeners are copied on write and posted to from a snapshot, so
+  // posting takes no lock; this one only serializes the writers.
   pthread_mutex_t listeners_mutex_;
-  std::list<SystemInfoInstance*> listeners_;
+  std::shared_ptr<const Listeners> listeners_;
+
+  unsigned sampling_interval_;
+  bool sampling_interval_requested_;
+  double deadband_;
+
+  DISALLOW_COPY_AND_ASSIGN(SysInfoObject);
 };
 
 typedef std::map<std::string, SysInfoObject&> SysInfoClassMap;
@@ -40,9 +40,9 @@ class SysInfoLocale : public SysInfoObject {
   std::string country_;
 
 #if defined(GENERIC_DESKTOP)
-  static gboolean OnUpdateTimeout(gpointer user_data);
+  static void OnLocaleFilesChanged(void* user_data);
 
-  int timeout_cb_id_;
+  system_info::FileWatch file_watch_;
 #elif defined(TIZEN)
   static void OnCountryChanged(keynode_t* node, void* user_data);
   static void OnLanguageChanged(keynode_t* node, void* user_data);
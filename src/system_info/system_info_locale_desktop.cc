@@ -16,23 +16,25 @@
 const std::string SysInfoLocale::name_ = "LOCALE";
 
 SysInfoLocale::SysInfoLocale()
-    : timeout_cb_id_(0) {}
+    : file_watch_(SysInfoLocale::OnLocaleFilesChanged, this) {
+  file_watch_.AddPath("/etc/timezone");
+  file_watch_.AddPath("/etc/default/locale");
+  file_watch_.AddPath("/etc/locale.conf");
+}
 
-SysInfoLocale::~SysInfoLocale() {}
+SysInfoLocale::~SysInfoLocale() {
+  if (has_listeners())
+    StopListening();
+}
 
 void SysInfoLocale::StartListening() {
-  if (timeout_cb_id_ == 0) {
-    timeout_cb_id_ = g_timeout_add(system_info::default_timeout_interval,
-                                   SysInfoLocale::OnUpdateTimeout,
-                                   static_cast<gpointer>(this));
-  }
+  GetLanguage();
+  GetCountry();
+  file_watch_.Start();
 }
 
 void SysInfoLocale::StopListening() {
-  if (timeout_cb_id_ > 0) {
-    g_source_remove(timeout_cb_id_);
-    timeout_cb_id_ = 0;
-  }
+  file_watch_.Stop();
 }
 
 void SysInfoLocale::Get(picojson::value& error,
@@ -80,12 +82,15 @@ bool SysInfoLocale::GetCountry() {
   std::string str;
 
   FILE* fp = fopen("/etc/timezone", "r");
+  if (!fp)
+    return false;
+
   std::string info;
   char* cinfo = NULL;
   size_t length = 100;
 
-  getline(&cinfo, &length, fp);
-  info = cinfo;
+  if (getline(&cinfo, &length, fp) != -1)
+    info = cinfo;
   free(cinfo);
   fclose(fp);
 
@@ -101,7 +106,7 @@ bool SysInfoLocale::GetCountry() {
   }
 }
 
-gboolean SysInfoLocale::OnUpdateTimeout(gpointer user_data) {
+void SysInfoLocale::OnLocaleFilesChanged(void* user_data) {
   SysInfoLocale* instance = static_cast<SysInfoLocale*>(user_data);
 
   std::string oldlanguage_ = instance->language_;
@@ -126,7 +131,5 @@ gboolean SysInfoLocale::OnUpdateTimeout(gpointer user_data) {
 
     instance->PostMessageToListeners(output);
   }
-
-  return TRUE;
 }
 
@@ -12,7 +12,10 @@ const std::string SysInfoLocale::name_ = "LOCALE";
 
 SysInfoLocale::SysInfoLocale() {}
 
-SysInfoLocale::~SysInfoLocale() {}
+SysInfoLocale::~SysInfoLocale() {
+  if (has_listeners())
+    StopListening();
+}
 
 void SysInfoLocale::StartListening() {
   vconf_notify_key_changed(VCONFKEY_REGIONFORMAT,
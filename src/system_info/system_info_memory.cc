@@ -0,0 +1,159 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "system_info/system_info_memory.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace {
+
+// Smaller changes of the available memory, relative to the capacity,
+// aren't worth telling the listeners about.
+const double kAvailableCapacityStep = 0.01;
+
+// Value of the |key| line of /proc/meminfo, in bytes.
+bool GetMemInfoValue(const char* buffer, const char* key, double* value) {
+  const char* line = strstr(buffer, key);
+  if (!line)
+    return false;
+  *value = strtod(line + strlen(key), NULL) * 1024;
+  return true;
+}
+
+}  // namespace
+
+const std::string SysInfoMemory::name_ = "MEMORY";
+
+SysInfoMemory::SysInfoMemory()
+    : capacity_(0.0),
+      available_capacity_(0.0),
+      swap_capacity_(0.0),
+      available_swap_capacity_(0.0),
+      posted_available_capacity_(0.0),
+      posted_available_swap_capacity_(0.0),
+      fd_(open("/proc/meminfo", O_RDONLY | O_CLOEXEC)),
+      timeout_cb_id_(0),
+      interval_(0) {
+  pthread_mutex_init(&mutex_, NULL);
+}
+
+SysInfoMemory::~SysInfoMemory() {
+  StopListening();
+  if (fd_ >= 0)
+    close(fd_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+void SysInfoMemory::Get(picojson::value& error,
+                        picojson::value& data) {
+  AutoLock lock(&mutex_);
+  if (!Update()) {
+    system_info::SetPicoJsonObjectValue(error, "message",
+        picojson::value("Get memory information failed."));
+    return;
+  }
+
+  SetData(data);
+  system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
+}
+
+bool SysInfoMemory::Update() {
+  if (fd_ < 0)
+    return false;
+
+  char buffer[4096];
+  ssize_t size = pread(fd_, buffer, sizeof(buffer) - 1, 0);
+  if (size <= 0)
+    return false;
+  buffer[size] = '\0';
+
+  // MemAvailable is missing before Linux 3.14.
+  if (!GetMemInfoValue(buffer, "MemTotal:", &capacity_) ||
+      !GetMemInfoValue(buffer, "MemAvailable:", &available_capacity_))
+    return false;
+  if (!GetMemInfoValue(buffer, "SwapTotal:", &swap_capacity_) ||
+      !GetMemInfoValue(buffer, "SwapFree:", &available_swap_capacity_))
+    swap_capacity_ = available_swap_capacity_ = 0.0;
+  return true;
+}
+
+void SysInfoMemory::SetData(picojson::value& data) {
+  system_info::SetPicoJsonObjectValue(data, "capacity",
+      picojson::value(capacity_));
+  system_info::SetPicoJsonObjectValue(data, "availableCapacity",
+      picojson::value(available_capacity_));
+  system_info::SetPicoJsonObjectValue(data, "swapCapacity",
+      picojson::value(swap_capacity_));
+  system_info::SetPicoJsonObjectValue(data, "availableSwapCapacity",
+      picojson::value(available_swap_capacity_));
+}
+
+gboolean SysInfoMemory::OnUpdateTimeout(gpointer user_data) {
+  SysInfoMemory* instance = static_cast<SysInfoMemory*>(user_data);
+
+  picojson::value data = picojson::value(picojson::object());
+  {
+    AutoLock lock(&instance->mutex_);
+    if (!instance->Update())
+      return TRUE;
+
+    // Compared with what was posted, so that slow drifts add up to a step.
+    double step = kAvailableCapacityStep * instance->capacity_;
+    if (fabs(instance->available_capacity_ -
+             instance->posted_available_capacity_) < step &&
+        fabs(instance->available_swap_capacity_ -
+             instance->posted_available_swap_capacity_) < step)
+      return TRUE;
+    instance->posted_available_capacity_ = instance->available_capacity_;
+    instance->posted_available_swap_capacity_ =
+        instance->available_swap_capacity_;
+    instance->SetData(data);
+  }
+
+  picojson::value output = picojson::value(picojson::object());
+  system_info::SetPicoJsonObjectValue(output, "cmd",
+      picojson::value("SystemInfoPropertyValueChanged"));
+  system_info::SetPicoJsonObjectValue(output, "prop",
+      picojson::value("MEMORY"));
+  system_info::SetPicoJsonObjectValue(output, "data", data);
+  instance->PostMessageToListeners(output);
+  return TRUE;
+}
+
+// The kernel tells nothing when memory is used or freed, so this samples
+// /proc/meminfo. PRESSURE is the property to watch for memory getting
+// tight.
+void SysInfoMemory::StartListening() {
+  if (timeout_cb_id_ > 0)
+    return;
+  {
+    AutoLock lock(&mutex_);
+    Update();
+    posted_available_capacity_ = available_capacity_;
+    posted_available_swap_capacity_ = available_swap_capacity_;
+  }
+  interval_ = sampling_interval();
+  timeout_cb_id_ = g_timeout_add(interval_, SysInfoMemory::OnUpdateTimeout,
+                                 static_cast<gpointer>(this));
+}
+
+void SysInfoMemory::StopListening() {
+  if (timeout_cb_id_ > 0) {
+    g_source_remove(timeout_cb_id_);
+    timeout_cb_id_ = 0;
+  }
+}
+
+void SysInfoMemory::OnListenersChanged() {
+  if (timeout_cb_id_ == 0 || interval_ == sampling_interval())
+    return;
+  StopListening();
+  StartListening();
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYSTEM_INFO_SYSTEM_INFO_MEMORY_H_
+#define SYSTEM_INFO_SYSTEM_INFO_MEMORY_H_
+
+#include <glib.h>
+#include <pthread.h>
+
+#include <string>
+
+#include "common/picojson.h"
+#include "common/utils.h"
+#include "system_info/system_info_instance.h"
+#include "system_info/system_info_utils.h"
+
+class SysInfoMemory : public SysInfoObject {
+ public:
+  static SysInfoObject& GetInstance() {
+    static SysInfoMemory instance;
+    return instance;
+  }
+  ~SysInfoMemory();
+  void Get(picojson::value& error, picojson::value& data);
+  void StartListening();
+  void StopListening();
+  void OnListenersChanged();
+  bool CanGetConcurrently() const { return true; }
+
+  static const std::string name_;
+
+ private:
+  const char* ThresholdAttribute() const { return "availableCapacity"; }
+
+  SysInfoMemory();
+  bool Update();
+  void SetData(picojson::value& data);
+  static gboolean OnUpdateTimeout(gpointer user_data);
+
+  // Guards the values below against a concurrent Get() and the GLib main
+  // loop.
+  pthread_mutex_t mutex_;
+  // In bytes.
+  double capacity_;
+  double available_capacity_;
+  double swap_capacity_;
+  double available_swap_capacity_;
+  // What the listeners were told last, Get() refreshes the values above.
+  double posted_available_capacity_;
+  double posted_available_swap_capacity_;
+
+  // /proc/meminfo, kept open.
+  int fd_;
+  guint timeout_cb_id_;
+  unsigned interval_;
+
+  DISALLOW_COPY_AND_ASSIGN(SysInfoMemory);
+};
+
+#endif  // SYSTEM_INFO_SYSTEM_INFO_MEMORY_H_
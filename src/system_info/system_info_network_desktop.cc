@@ -6,30 +6,14 @@
 
 #include <NetworkManager.h>
 
-namespace {
-
-const char sDBusServiceNM[] = "org.freedesktop.NetworkManager";
-const char sManagerPath[] = "/org/freedesktop/NetworkManager";
-const char sManagerInterface[] = "org.freedesktop.NetworkManager";
-const char sConnectionActiveInterface[] =
-    "org.freedesktop.NetworkManager.Connection.Active";
-const char sDeviceInterface[] = "org.freedesktop.NetworkManager.Device";
-
-}  // namespace
+#include "system_info/system_info_network_manager_desktop.h"
 
 SysInfoNetworkDesktop::SysInfoNetworkDesktop()
-    : active_connection_(""),
-      active_device_(""),
-      device_type_(NM_DEVICE_TYPE_UNKNOWN) {
-  g_dbus_proxy_new_for_bus(G_BUS_TYPE_SYSTEM,
-      G_DBUS_PROXY_FLAGS_NONE,
-      NULL,
-      sDBusServiceNM,
-      sManagerPath,
-      sManagerInterface,
-      NULL,
-      OnNetworkManagerCreatedThunk,
-      this);
+    : device_type_(NM_DEVICE_TYPE_UNKNOWN) {
+  system_info::NetworkManagerCache::GetInstance().AddObserver(
+      OnNetworkManagerChanged, this);
+  // The cache is primed already, observers only hear about later changes.
+  OnNetworkManagerChanged(this);
 }
 
 SysInfoNetworkDesktop::~SysInfoNetworkDesktop() {}
@@ -44,70 +28,6 @@ void SysInfoNetworkDesktop::Get(picojson::value& error,
   system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
 }
 
-void SysInfoNetworkDesktop::OnNetworkManagerCreated(GObject*,
-                                                    GAsyncResult* res) {
-  GError* err = 0;
-  GDBusProxy* proxy = g_dbus_proxy_new_for_bus_finish(res, &err);
-
-  if (!proxy) {
-    g_printerr("NetworkManager proxy creation error: %s\n", err->message);
-    g_error_free(err);
-    return;
-  }
-
-  GVariant* value = g_dbus_proxy_get_cached_property(proxy,
-                                                     "ActiveConnections");
-  if (!value) {
-    g_printerr("Get ActiveConnections failed.");
-    return;
-  }
-  UpdateActiveConnection(value);
-
-  // FIXME(halton): NetworkManager does not support g-properties-changed signal.
-  g_signal_connect(proxy, "g-signal",
-      G_CALLBACK(SysInfoNetworkDesktop::OnNetworkManagerSignal), this);
-}
-
-void SysInfoNetworkDesktop::OnActiveConnectionCreated(GObject*,
-                                                      GAsyncResult* res) {
-  GError* err = 0;
-  GDBusProxy* proxy = g_dbus_proxy_new_for_bus_finish(res, &err);
-
-  if (!proxy) {
-    g_printerr("ActiveConnection proxy creation error: %s\n", err->message);
-    g_error_free(err);
-    return;
-  }
-
-  GVariant* value = g_dbus_proxy_get_cached_property(proxy, "Devices");
-  if (!value) {
-    g_printerr("Failed to get devices.");
-    return;
-  }
-  UpdateActiveDevice(value);
-
-  g_signal_connect(proxy, "g-signal",
-      G_CALLBACK(SysInfoNetworkDesktop::OnActiveConnectionsSignal), this);
-}
-
-void SysInfoNetworkDesktop::OnDevicesCreated(GObject*, GAsyncResult* res) {
-  GError* err = 0;
-  GDBusProxy* proxy = g_dbus_proxy_new_for_bus_finish(res, &err);
-
-  if (!proxy) {
-    g_printerr("Devices proxy creation error: %s\n", err->message);
-    g_error_free(err);
-    return;
-  }
-
-  GVariant* value = g_dbus_proxy_get_cached_property(proxy, "DeviceType");
-  if (!value) {
-    g_printerr("Get DeviceType failed.");
-    return;
-  }
-  UpdateDeviceType(value);
-}
-
 SystemInfoNetworkType SysInfoNetworkDesktop::ToNetworkType(guint device_type) {
   SystemInfoNetworkType ret = SYSTEM_INFO_NETWORK_UNKNOWN;
 
@@ -129,78 +49,17 @@ SystemInfoNetworkType SysInfoNetworkDesktop::ToNetworkType(guint device_type) {
   return ret;
 }
 
-void SysInfoNetworkDesktop::UpdateActiveConnection(GVariant* value) {
-  if (!value || !g_variant_n_children(value)) {
-    active_connection_ = "";
-    active_device_ = "";
-    SendUpdate(NM_DEVICE_TYPE_UNKNOWN);
-    return;
-  }
-
-  GVariant* child = g_variant_get_child_value(value, 0);
-  if (!child) {
-    g_printerr("Invalid child[0] for ActiveConnections.");
-    SendUpdate(NM_DEVICE_TYPE_UNKNOWN);
-    return;
-  }
-
-  const char* str = g_variant_get_string(child, NULL);
-  if (str && (strcmp(active_connection_.c_str(), str) != 0)) {
-    active_connection_ = std::string(str);
-    active_device_ = "";
-    SendUpdate(NM_DEVICE_TYPE_UNKNOWN);
-  }
-
-  if (active_connection_.empty())
-    return;
-
-  g_dbus_proxy_new_for_bus(G_BUS_TYPE_SYSTEM,
-      G_DBUS_PROXY_FLAGS_NONE,
-      NULL,
-      sDBusServiceNM,
-      active_connection_.c_str(),
-      sConnectionActiveInterface,
-      NULL,
-      OnActiveConnectionCreatedThunk,
-      this);
-}
-
-void SysInfoNetworkDesktop::UpdateActiveDevice(GVariant* value) {
-  if (!value || !g_variant_n_children(value)) {
-    active_device_ = "";
-    SendUpdate(NM_DEVICE_TYPE_UNKNOWN);
-    return;
-  }
-
-  GVariant* child = g_variant_get_child_value(value, 0);
-  if (!child) {
-    g_printerr("Invalid child[0] for Devices.");
-    SendUpdate(NM_DEVICE_TYPE_UNKNOWN);
-    return;
-  }
-
-  const char* str = g_variant_get_string(child, NULL);
-  if (str && (strcmp(active_device_.c_str(), str) != 0)) {
-    active_device_ = std::string(str);
-    SendUpdate(NM_DEVICE_TYPE_UNKNOWN);
-  }
-
-  if (active_device_.empty())
-    return;
-
-  g_dbus_proxy_new_for_bus(G_BUS_TYPE_SYSTEM,
-      G_DBUS_PROXY_FLAGS_NONE,
-      NULL,
-      sDBusServiceNM,
-      active_device_.c_str(),
-      sDeviceInterface,
-      NULL,
-      OnDevicesCreatedThunk,
-      this);
-}
-
-void SysInfoNetworkDesktop::UpdateDeviceType(GVariant* value) {
-  SendUpdate(g_variant_get_uint32(value));
+// Only the type of the device of the first active connection is told.
+void SysInfoNetworkDesktop::OnNetworkManagerChanged(void* user_data) {
+  SysInfoNetworkDesktop* self =
+      static_cast<SysInfoNetworkDesktop*>(user_data);
+  system_info::NetworkManagerCache& cache =
+      system_info::NetworkManagerCache::GetInstance();
+
+  std::string device = cache.GetActiveDevice();
+  self->SendUpdate(device.empty() ? NM_DEVICE_TYPE_UNKNOWN :
+      cache.GetUint32(device, NM_DBUS_INTERFACE_DEVICE, "DeviceType",
+                      NM_DEVICE_TYPE_UNKNOWN));
 }
 
 void SysInfoNetworkDesktop::SendUpdate(guint new_device_type) {
@@ -222,53 +81,3 @@ void SysInfoNetworkDesktop::SendUpdate(guint new_device_type) {
 
   PostMessageToListeners(output);
 }
-
-void SysInfoNetworkDesktop::OnNetworkManagerSignal(GDBusProxy* proxy,
-                                                   gchar* sender,
-                                                   gchar* signal,
-                                                   GVariant* parameters,
-                                                   gpointer user_data) {
-  SysInfoNetworkDesktop* self =
-      reinterpret_cast<SysInfoNetworkDesktop*>(user_data);
-
-  if (strcmp(signal, "PropertiesChanged") != 0)
-    return;
-
-  GVariantIter* iter;
-  const gchar* key;
-  GVariant* value;
-
-  g_variant_get(parameters, "(a{sv})", &iter);
-  while (g_variant_iter_loop(iter, "{&sv}", &key, &value)) {
-    if (strcmp(key, "ActiveConnections") == 0) {
-      self->UpdateActiveConnection(value);
-      break;
-    }
-  }
-  g_variant_iter_free(iter);
-}
-
-void SysInfoNetworkDesktop::OnActiveConnectionsSignal(GDBusProxy* proxy,
-                                                      gchar* sender,
-                                                      gchar* signal,
-                                                      GVariant* parameters,
-                                                      gpointer user_data) {
-  SysInfoNetworkDesktop* self =
-      reinterpret_cast<SysInfoNetworkDesktop*>(user_data);
-
-  if (strcmp(signal, "PropertiesChanged") != 0)
-    return;
-
-  GVariantIter* iter;
-  const gchar* key;
-  GVariant* value;
-
-  g_variant_get(parameters, "(a{sv})", &iter);
-  while (g_variant_iter_loop(iter, "{&sv}", &key, &value)) {
-    if (strcmp(key, "Devices") == 0) {
-      self->UpdateActiveDevice(value);
-      break;
-    }
-  }
-  g_variant_iter_free(iter);
-}
@@ -12,10 +12,10 @@ SysInfoNetworkTizen::SysInfoNetworkTizen() {
 }
 
 SysInfoNetworkTizen::~SysInfoNetworkTizen() {
+  if (has_listeners())
+    StopListening();
   if (!conn_)
     return;
-  g_dbus_connection_signal_unsubscribe(conn_,
-      cellular_network_type_changed_watch_);
   g_dbus_connection_close_sync(conn_, NULL, NULL);
   conn_ = NULL;
 }
@@ -0,0 +1,406 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "system_info/system_info_network_manager_desktop.h"
+
+#include <NetworkManager.h>
+#include <string.h>
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char kPropertiesInterface[] = "org.freedesktop.DBus.Properties";
+
+// Properties through which the cached objects refer to other objects, and
+// the interfaces to cache for those.
+struct Reference {
+  const char* interface;
+  const char* name;
+  const char* targets[2];
+};
+
+const Reference kReferences[] = {
+  { NM_DBUS_INTERFACE, "Devices",
+    { NM_DBUS_INTERFACE_DEVICE, NM_DBUS_INTERFACE_DEVICE_WIRELESS } },
+  { NM_DBUS_INTERFACE, "ActiveConnections",
+    { NM_DBUS_INTERFACE_ACTIVE_CONNECTION, NULL } },
+  { NM_DBUS_INTERFACE_ACTIVE_CONNECTION, "Devices",
+    { NM_DBUS_INTERFACE_DEVICE, NM_DBUS_INTERFACE_DEVICE_WIRELESS } },
+  { NM_DBUS_INTERFACE_DEVICE, "Ip6Config",
+    { NM_DBUS_INTERFACE_IP6_CONFIG, NULL } },
+  { NM_DBUS_INTERFACE_DEVICE_WIRELESS, "ActiveAccessPoint",
+    { NM_DBUS_INTERFACE_ACCESS_POINT, NULL } },
+  { NM_DBUS_INTERFACE_DEVICE_WIRELESS, "AccessPoints",
+    { NM_DBUS_INTERFACE_ACCESS_POINT, NULL } },
+};
+
+bool IsReference(const std::string& interface, const char* name) {
+  for (unsigned i = 0; i < G_N_ELEMENTS(kReferences); ++i) {
+    if (interface == kReferences[i].interface &&
+        strcmp(name, kReferences[i].name) == 0)
+      return true;
+  }
+  return false;
+}
+
+// Paths of an "o" or "ao" value, without the "/" NetworkManager uses for
+// none.
+std::vector<std::string> ObjectPaths(GVariant* value) {
+  std::vector<std::string> paths;
+  if (g_variant_is_of_type(value, G_VARIANT_TYPE_OBJECT_PATH)) {
+    paths.push_back(g_variant_get_string(value, NULL));
+  } else if (g_variant_is_of_type(value, G_VARIANT_TYPE_OBJECT_PATH_ARRAY)) {
+    for (gsize i = 0; i < g_variant_n_children(value); ++i) {
+      GVariant* child = g_variant_get_child_value(value, i);
+      paths.push_back(g_variant_get_string(child, NULL));
+      g_variant_unref(child);
+    }
+  }
+  std::vector<std::string>::iterator it =
+      std::find(paths.begin(), paths.end(), "/");
+  if (it != paths.end())
+    paths.erase(it);
+  return paths;
+}
+
+struct GetAllRequest {
+  system_info::NetworkManagerCache* cache;
+  std::pair<std::string, std::string> key;
+};
+
+}  // namespace
+
+namespace system_info {
+
+// Values are asked for as soon as the extension is loaded, so the cache is
+// filled with blocking calls once and kept up to date from signals and
+// asynchronous calls afterwards.
+NetworkManagerCache::NetworkManagerCache()
+    : connection_(NULL),
+      priming_(true) {
+  GError* err = 0;
+  connection_ = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &err);
+  if (!connection_) {
+    g_printerr("System bus connection error: %s\n", err->message);
+    g_error_free(err);
+    priming_ = false;
+    return;
+  }
+
+  // NetworkManager before 1.0 sends PropertiesChanged from each of its
+  // interfaces, later versions also from the standard one.
+  g_dbus_connection_signal_subscribe(connection_, NM_DBUS_SERVICE,
+      NULL, "PropertiesChanged", NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
+      OnPropertiesChanged, this, NULL);
+  g_dbus_connection_signal_subscribe(connection_, NM_DBUS_SERVICE,
+      NM_DBUS_INTERFACE_DEVICE, "StateChanged", NULL, NULL,
+      G_DBUS_SIGNAL_FLAGS_NONE, OnDeviceStateChanged, this, NULL);
+
+  ObjectKey manager(NM_DBUS_PATH, NM_DBUS_INTERFACE);
+  objects_[manager];
+  Fetch(manager);
+  priming_ = false;
+}
+
+NetworkManagerCache::~NetworkManagerCache() {
+  for (std::map<ObjectKey, Properties>::iterator it = objects_.begin();
+       it != objects_.end(); ++it) {
+    for (Properties::iterator p = it->second.begin();
+         p != it->second.end(); ++p)
+      g_variant_unref(p->second);
+  }
+  if (connection_)
+    g_object_unref(connection_);
+}
+
+void NetworkManagerCache::AddObserver(Callback callback, void* user_data) {
+  observers_.push_back(std::make_pair(callback, user_data));
+}
+
+GVariant* NetworkManagerCache::GetProperty(const std::string& path,
+                                           const char* interface,
+                                           const char* name) const {
+  std::map<ObjectKey, Properties>::const_iterator object =
+      objects_.find(ObjectKey(path, interface));
+  if (object == objects_.end())
+    return NULL;
+  Properties::const_iterator it = object->second.find(name);
+  return it == object->second.end() ? NULL : it->second;
+}
+
+guint32 NetworkManagerCache::GetUint32(const std::string& path,
+                                       const char* interface,
+                                       const char* name,
+                                       guint32 default_value) const {
+  GVariant* value = GetProperty(path, interface, name);
+  if (!value || !g_variant_is_of_type(value, G_VARIANT_TYPE("u")))
+    return default_value;
+  return g_variant_get_uint32(value);
+}
+
+std::string NetworkManagerCache::GetObjectPath(const std::string& path,
+                                               const char* interface,
+                                               const char* name) const {
+  GVariant* value = GetProperty(path, interface, name);
+  if (!value)
+    return "";
+  std::vector<std::string> paths = ObjectPaths(value);
+  return paths.empty() ? "" : paths[0];
+}
+
+std::vector<std::string> NetworkManagerCache::GetObjectPaths(
+    const std::string& path, const char* interface, const char* name) const {
+  GVariant* value = GetProperty(path, interface, name);
+  return value ? ObjectPaths(value) : std::vector<std::string>();
+}
+
+std::string NetworkManagerCache::GetActiveDevice() const {
+  std::string connection = GetObjectPath(NM_DBUS_PATH, NM_DBUS_INTERFACE,
+                                         "ActiveConnections");
+  if (connection.empty())
+    return "";
+  return GetObjectPath(connection, NM_DBUS_INTERFACE_ACTIVE_CONNECTION,
+                       "Devices");
+}
+
+void NetworkManagerCache::Call(const std::string& path,
+                               const char* interface,
+                               const char* method,
+                               GVariant* parameters) {
+  if (!connection_) {
+    g_variant_unref(g_variant_ref_sink(parameters));
+    return;
+  }
+  g_dbus_connection_call(connection_, NM_DBUS_SERVICE, path.c_str(),
+      interface, method, parameters, NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+      OnCallReply, this);
+}
+
+void NetworkManagerCache::OnCallReply(GObject*, GAsyncResult* res,
+                                      gpointer user_data) {
+  NetworkManagerCache* self = static_cast<NetworkManagerCache*>(user_data);
+  GError* err = 0;
+  GVariant* reply = g_dbus_connection_call_finish(self->connection_, res,
+                                                  &err);
+  if (!reply) {
+    g_printerr("NetworkManager call error: %s\n", err->message);
+    g_error_free(err);
+    return;
+  }
+  g_variant_unref(reply);
+}
+
+void NetworkManagerCache::Fetch(const ObjectKey& key) {
+  if (priming_) {
+    GError* err = 0;
+    GVariant* reply = g_dbus_connection_call_sync(connection_,
+        NM_DBUS_SERVICE, key.first.c_str(), kPropertiesInterface, "GetAll",
+        g_variant_new("(s)", key.second.c_str()), G_VARIANT_TYPE("(a{sv})"),
+        G_DBUS_CALL_FLAGS_NONE, -1, NULL, &err);
+    OnGetAll(key, reply, err);
+    return;
+  }
+
+  GetAllRequest* request = new GetAllRequest;
+  request->cache = this;
+  request->key = key;
+  g_dbus_connection_call(connection_, NM_DBUS_SERVICE, key.first.c_str(),
+      kPropertiesInterface, "GetAll", g_variant_new("(s)", key.second.c_str()),
+      G_VARIANT_TYPE("(a{sv})"), G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+      OnGetAllReply, request);
+}
+
+void NetworkManagerCache::OnGetAllReply(GObject*, GAsyncResult* res,
+                                        gpointer user_data) {
+  GetAllRequest* request = static_cast<GetAllRequest*>(user_data);
+  NetworkManagerCache* self = request->cache;
+  ObjectKey key = request->key;
+  delete request;
+
+  GError* err = 0;
+  GVariant* reply = g_dbus_connection_call_finish(self->connection_, res,
+                                                  &err);
+  self->OnGetAll(key, reply, err);
+}
+
+void NetworkManagerCache::OnGetAll(const ObjectKey& key, GVariant* reply,
+                                   GError* err) {
+  // Objects are gone already when nothing refers to them anymore, and
+  // devices other than Wi-Fi ones don't have the wireless interface.
+  std::map<ObjectKey, Properties>::iterator object = objects_.find(key);
+  if (!reply) {
+    g_error_free(err);
+    if (object != objects_.end() && object->second.empty())
+      objects_.erase(object);
+    return;
+  }
+  if (object == objects_.end()) {
+    g_variant_unref(reply);
+    return;
+  }
+
+  GVariantIter* iter;
+  g_variant_get(reply, "(a{sv})", &iter);
+  SetProperties(key, iter);
+  g_variant_iter_free(iter);
+  g_variant_unref(reply);
+
+  Follow(key);
+  Prune();
+  NotifyObservers();
+}
+
+bool NetworkManagerCache::SetProperties(const ObjectKey& key,
+                                        GVariantIter* iter) {
+  Properties& properties = objects_[key];
+  bool references_changed = false;
+  const gchar* name;
+  GVariant* value;
+  while (g_variant_iter_next(iter, "{&sv}", &name, &value)) {
+    Properties::iterator it = properties.find(name);
+    if (it != properties.end()) {
+      g_variant_unref(it->second);
+      it->second = value;
+    } else {
+      properties[name] = value;
+    }
+    if (IsReference(key.second, name))
+      references_changed = true;
+  }
+  return references_changed;
+}
+
+void NetworkManagerCache::Follow(const ObjectKey& key) {
+  for (unsigned i = 0; i < G_N_ELEMENTS(kReferences); ++i) {
+    const Reference& reference = kReferences[i];
+    if (key.second != reference.interface)
+      continue;
+    GVariant* value = GetProperty(key.first, reference.interface,
+                                  reference.name);
+    if (!value)
+      continue;
+    std::vector<std::string> paths = ObjectPaths(value);
+    for (unsigned j = 0; j < paths.size(); ++j) {
+      for (unsigned k = 0; k < 2 && reference.targets[k]; ++k) {
+        ObjectKey target(paths[j], reference.targets[k]);
+        if (objects_.find(target) != objects_.end())
+          continue;
+        objects_[target];
+        Fetch(target);
+      }
+    }
+  }
+}
+
+void NetworkManagerCache::Prune() {
+  std::set<ObjectKey> reachable;
+  std::vector<ObjectKey> pending;
+  pending.push_back(ObjectKey(NM_DBUS_PATH, NM_DBUS_INTERFACE));
+  while (!pending.empty()) {
+    ObjectKey key = pending.back();
+    pending.pop_back();
+    if (!reachable.insert(key).second)
+      continue;
+    for (unsigned i = 0; i < G_N_ELEMENTS(kReferences); ++i) {
+      const Reference& reference = kReferences[i];
+      if (key.second != reference.interface)
+        continue;
+      GVariant* value = GetProperty(key.first, reference.interface,
+                                    reference.name);
+      if (!value)
+        continue;
+      std::vector<std::string> paths = ObjectPaths(value);
+      for (unsigned j = 0; j < paths.size(); ++j) {
+        for (unsigned k = 0; k < 2 && reference.targets[k]; ++k)
+          pending.push_back(ObjectKey(paths[j], reference.targets[k]));
+      }
+    }
+  }
+
+  std::map<ObjectKey, Properties>::iterator it = objects_.begin();
+  while (it != objects_.end()) {
+    if (reachable.count(it->first)) {
+      ++it;
+      continue;
+    }
+    for (Properties::iterator p = it->second.begin();
+         p != it->second.end(); ++p)
+      g_variant_unref(p->second);
+    objects_.erase(it++);
+  }
+}
+
+void NetworkManagerCache::NotifyObservers() {
+  for (unsigned i = 0; i < observers_.size(); ++i)
+    observers_[i].first(observers_[i].second);
+}
+
+void NetworkManagerCache::OnPropertiesChanged(GDBusConnection*,
+                                              const gchar*,
+                                              const gchar* path,
+                                              const gchar* interface,
+                                              const gchar*,
+                                              GVariant* parameters,
+                                              gpointer user_data) {
+  NetworkManagerCache* self = static_cast<NetworkManagerCache*>(user_data);
+
+  const gchar* changed_interface = interface;
+  GVariantIter* iter;
+  if (strcmp(interface, kPropertiesInterface) == 0) {
+    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(sa{sv}as)")))
+      return;
+    g_variant_get(parameters, "(&sa{sv}as)", &changed_interface, &iter, NULL);
+  } else {
+    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(a{sv})")))
+      return;
+    g_variant_get(parameters, "(a{sv})", &iter);
+  }
+
+  ObjectKey key(path, changed_interface);
+  std::map<ObjectKey, Properties>::iterator object = self->objects_.find(key);
+  // Changes racing with the GetAll call are in its reply.
+  if (object == self->objects_.end() || object->second.empty()) {
+    g_variant_iter_free(iter);
+    return;
+  }
+
+  bool references_changed = self->SetProperties(key, iter);
+  g_variant_iter_free(iter);
+  if (references_changed) {
+    self->Follow(key);
+    self->Prune();
+  }
+  self->NotifyObservers();
+}
+
+// NetworkManager before 1.0 doesn't tell when the addresses of a device
+// change, they're read again when its state does.
+void NetworkManagerCache::OnDeviceStateChanged(GDBusConnection*,
+                                               const gchar*,
+                                               const gchar* path,
+                                               const gchar*,
+                                               const gchar*,
+                                               GVariant*,
+                                               gpointer user_data) {
+  NetworkManagerCache* self = static_cast<NetworkManagerCache*>(user_data);
+
+  ObjectKey key(path, NM_DBUS_INTERFACE_DEVICE);
+  std::map<ObjectKey, Properties>::iterator object = self->objects_.find(key);
+  if (object != self->objects_.end() && !object->second.empty())
+    self->Fetch(key);
+}
+
+std::string SSIDFromVariant(GVariant* value) {
+  gsize length = 0;
+  gconstpointer g_pointer = g_variant_get_fixed_array(value, &length,
+                                                      sizeof(guchar));
+  return std::string(static_cast<const char*>(g_pointer), length);
+}
+
+}  // namespace system_info
@@ -0,0 +1,103 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYSTEM_INFO_SYSTEM_INFO_NETWORK_MANAGER_DESKTOP_H_
+#define SYSTEM_INFO_SYSTEM_INFO_NETWORK_MANAGER_DESKTOP_H_
+
+#include <gio/gio.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/utils.h"
+
+namespace system_info {
+
+// Properties of the NetworkManager objects which the network properties
+// are made of: the manager, its devices and active connections, the access
+// points and IPv6 configurations of the devices. Each object is read with
+// one GetAll call when it shows up, kept current from the PropertiesChanged
+// signals and dropped once nothing refers to it anymore, so reading the
+// cache never calls NetworkManager.
+class NetworkManagerCache {
+ public:
+  typedef void (*Callback)(void* user_data);
+
+  static NetworkManagerCache& GetInstance() {
+    static NetworkManagerCache instance;
+    return instance;
+  }
+
+  // |callback| runs on the GLib main loop after each change of the cache.
+  void AddObserver(Callback callback, void* user_data);
+
+  // Cached value of a property, NULL when not known. Owned by the cache.
+  GVariant* GetProperty(const std::string& path, const char* interface,
+                        const char* name) const;
+  guint32 GetUint32(const std::string& path, const char* interface,
+                    const char* name, guint32 default_value) const;
+  // The first object an object path or object path array property refers
+  // to, or "" when it refers to none.
+  std::string GetObjectPath(const std::string& path, const char* interface,
+                            const char* name) const;
+
+  std::vector<std::string> GetObjectPaths(const std::string& path,
+                                          const char* interface,
+                                          const char* name) const;
+
+  // First device of the first active connection, or "".
+  std::string GetActiveDevice() const;
+
+  // Calls |method| of an object without waiting for, or caring about, the
+  // result. Changes it causes come as signals.
+  void Call(const std::string& path, const char* interface,
+            const char* method, GVariant* parameters);
+
+ private:
+  // Object path and interface.
+  typedef std::pair<std::string, std::string> ObjectKey;
+  typedef std::map<std::string, GVariant*> Properties;
+
+  NetworkManagerCache();
+  ~NetworkManagerCache();
+
+  // Blocks on the reply while the cache is being primed.
+  void Fetch(const ObjectKey& key);
+  void OnGetAll(const ObjectKey& key, GVariant* reply, GError* err);
+  // Returns whether a property referring to other objects changed.
+  bool SetProperties(const ObjectKey& key, GVariantIter* iter);
+  // Fetches the objects |key| refers to which aren't cached yet.
+  void Follow(const ObjectKey& key);
+  // Drops the objects which can't be reached from the manager anymore.
+  void Prune();
+  void NotifyObservers();
+
+  static void OnGetAllReply(GObject* source, GAsyncResult* res,
+                            gpointer user_data);
+  static void OnCallReply(GObject* source, GAsyncResult* res,
+                          gpointer user_data);
+  static void OnPropertiesChanged(GDBusConnection* connection,
+      const gchar* sender, const gchar* path, const gchar* interface,
+      const gchar* signal, GVariant* parameters, gpointer user_data);
+  static void OnDeviceStateChanged(GDBusConnection* connection,
+      const gchar* sender, const gchar* path, const gchar* interface,
+      const gchar* signal, GVariant* parameters, gpointer user_data);
+
+  GDBusConnection* connection_;
+  bool priming_;
+  // Objects being fetched are in there already, with no properties.
+  std::map<ObjectKey, Properties> objects_;
+  std::vector<std::pair<Callback, void*> > observers_;
+
+  DISALLOW_COPY_AND_ASSIGN(NetworkManagerCache);
+};
+
+// An access point's "Ssid", an array of bytes.
+std::string SSIDFromVariant(GVariant* value);
+
+}  // namespace system_info
+
+#endif  // SYSTEM_INFO_SYSTEM_INFO_NETWORK_MANAGER_DESKTOP_H_
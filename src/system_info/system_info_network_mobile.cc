@@ -6,7 +6,10 @@
 
 SysInfoNetworkTizen::SysInfoNetworkTizen() {}
 
-SysInfoNetworkTizen::~SysInfoNetworkTizen() {}
+SysInfoNetworkTizen::~SysInfoNetworkTizen() {
+  if (has_listeners())
+    StopListening();
+}
 
 void SysInfoNetworkTizen::StartListening() {
   vconf_notify_key_changed(VCONFKEY_NETWORK_STATUS,
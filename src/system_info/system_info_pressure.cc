@@ -0,0 +1,266 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "system_info/system_info_pressure.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace {
+
+const char* const kPressureFiles[] = {
+  "/proc/pressure/cpu",
+  "/proc/pressure/memory",
+  "/proc/pressure/io",
+};
+
+// Fires when tasks stalled for 150ms within 2s. Unprivileged processes
+// may only use windows which are multiples of 2s.
+const char kTrigger[] = "some 150000 2000000";
+
+// Smaller changes, in percent, aren't worth telling the polled listeners
+// about.
+const double kStallStep = 1.0;
+
+// How often values are sampled after a trigger until they settle, in ms.
+const guint kDecayInterval = 2000;
+
+}  // namespace
+
+const std::string SysInfoPressure::name_ = "PRESSURE";
+
+SysInfoPressure::SysInfoPressure()
+    : timeout_cb_id_(0),
+      interval_(0),
+      decay_cb_id_(0) {
+  for (int i = 0; i < RESOURCE_COUNT; ++i) {
+    trigger_fds_[i] = -1;
+    trigger_ids_[i] = 0;
+  }
+  pthread_mutex_init(&mutex_, NULL);
+}
+
+SysInfoPressure::~SysInfoPressure() {
+  StopListening();
+  pthread_mutex_destroy(&mutex_);
+}
+
+void SysInfoPressure::Get(picojson::value& error,
+                          picojson::value& data) {
+  AutoLock lock(&mutex_);
+  if (!Update()) {
+    system_info::SetPicoJsonObjectValue(error, "message",
+        picojson::value("Pressure stall information is not available."));
+    return;
+  }
+
+  SetData(data);
+  system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
+}
+
+bool SysInfoPressure::Update() {
+  for (int i = 0; i < RESOURCE_COUNT; ++i) {
+    int fd = open(kPressureFiles[i], O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return false;
+    char buffer[256];
+    ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (size <= 0)
+      return false;
+    buffer[size] = '\0';
+
+    // "full" is missing for the CPU before Linux 5.13.
+    if (sscanf(buffer, "some avg10=%lf", &stalls_[i].some) != 1)
+      return false;
+    const char* full = strstr(buffer, "\nfull avg10=");
+    if (!full || sscanf(full, "\nfull avg10=%lf", &stalls_[i].full) != 1)
+      stalls_[i].full = 0.0;
+  }
+  return true;
+}
+
+void SysInfoPressure::SetData(picojson::value& data) {
+  system_info::SetPicoJsonObjectValue(data, "cpuSome",
+      picojson::value(stalls_[RESOURCE_CPU].some));
+  system_info::SetPicoJsonObjectValue(data, "memorySome",
+      picojson::value(stalls_[RESOURCE_MEMORY].some));
+  system_info::SetPicoJsonObjectValue(data, "memoryFull",
+      picojson::value(stalls_[RESOURCE_MEMORY].full));
+  system_info::SetPicoJsonObjectValue(data, "ioSome",
+      picojson::value(stalls_[RESOURCE_IO].some));
+  system_info::SetPicoJsonObjectValue(data, "ioFull",
+      picojson::value(stalls_[RESOURCE_IO].full));
+}
+
+bool SysInfoPressure::UpdatePosted(bool always, picojson::value& data) {
+  AutoLock lock(&mutex_);
+  if (!Update())
+    return false;
+
+  bool moved = always;
+  for (int i = 0; i < RESOURCE_COUNT && !moved; ++i) {
+    moved = fabs(stalls_[i].some - posted_stalls_[i].some) >= kStallStep ||
+        fabs(stalls_[i].full - posted_stalls_[i].full) >= kStallStep;
+  }
+  if (!moved)
+    return false;
+
+  for (int i = 0; i < RESOURCE_COUNT; ++i)
+    posted_stalls_[i] = stalls_[i];
+  SetData(data);
+  return true;
+}
+
+void SysInfoPressure::PostPressure(const picojson::value& data) {
+  picojson::value output = picojson::value(picojson::object());
+  system_info::SetPicoJsonObjectValue(output, "cmd",
+      picojson::value("SystemInfoPropertyValueChanged"));
+  system_info::SetPicoJsonObjectValue(output, "prop",
+      picojson::value("PRESSURE"));
+  system_info::SetPicoJsonObjectValue(output, "data", data);
+  PostMessageToListeners(output);
+}
+
+bool SysInfoPressure::ArmTrigger(Resource resource) {
+  int fd = open(kPressureFiles[resource], O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  if (write(fd, kTrigger, strlen(kTrigger) + 1) < 0) {
+    close(fd);
+    return false;
+  }
+
+  trigger_fds_[resource] = fd;
+  // Trigger fds always poll readable, only POLLPRI tells a trigger fired.
+  trigger_ids_[resource] = system_info::AddFdWatch(fd,
+      static_cast<GIOCondition>(G_IO_PRI | G_IO_ERR),
+      SysInfoPressure::OnTrigger, this);
+  return true;
+}
+
+gboolean SysInfoPressure::OnTrigger(GIOChannel* channel,
+                                    GIOCondition condition,
+                                    gpointer user_data) {
+  SysInfoPressure* instance = static_cast<SysInfoPressure*>(user_data);
+
+  if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) {
+    int fd = g_io_channel_unix_get_fd(channel);
+    for (int i = 0; i < RESOURCE_COUNT; ++i) {
+      if (instance->trigger_fds_[i] != fd)
+        continue;
+      close(fd);
+      instance->trigger_fds_[i] = -1;
+      instance->trigger_ids_[i] = 0;
+    }
+    return FALSE;
+  }
+
+  if (!(condition & G_IO_PRI))
+    return TRUE;
+
+  picojson::value data = picojson::value(picojson::object());
+  if (instance->UpdatePosted(true, data))
+    instance->PostPressure(data);
+  if (instance->timeout_cb_id_ == 0 && instance->decay_cb_id_ == 0) {
+    instance->decay_cb_id_ = g_timeout_add(kDecayInterval,
+                                           SysInfoPressure::OnDecayTimeout,
+                                           user_data);
+  }
+  return TRUE;
+}
+
+void SysInfoPressure::Sample() {
+  picojson::value data = picojson::value(picojson::object());
+  if (UpdatePosted(false, data))
+    PostPressure(data);
+}
+
+bool SysInfoPressure::Settled() {
+  AutoLock lock(&mutex_);
+  for (int i = 0; i < RESOURCE_COUNT; ++i) {
+    if (stalls_[i].some >= kStallStep || stalls_[i].full >= kStallStep)
+      return false;
+  }
+  return true;
+}
+
+gboolean SysInfoPressure::OnUpdateTimeout(gpointer user_data) {
+  static_cast<SysInfoPressure*>(user_data)->Sample();
+  return TRUE;
+}
+
+// Keeps sampling until the values are back under a step, so that listeners
+// with a lowThreshold hear about the stall going away.
+gboolean SysInfoPressure::OnDecayTimeout(gpointer user_data) {
+  SysInfoPressure* instance = static_cast<SysInfoPressure*>(user_data);
+
+  // The regular timeout samples already.
+  if (instance->timeout_cb_id_ == 0)
+    instance->Sample();
+  if (instance->timeout_cb_id_ == 0 && !instance->Settled())
+    return TRUE;
+  instance->decay_cb_id_ = 0;
+  return FALSE;
+}
+
+// The kernel wakes us up through PSI triggers when tasks start stalling,
+// nothing needs to be polled until then. Only listeners asking for an
+// interval, kernels without triggers, or stalls dying down after a
+// trigger get sampled values.
+void SysInfoPressure::StartListening() {
+  {
+    AutoLock lock(&mutex_);
+    if (Update()) {
+      for (int i = 0; i < RESOURCE_COUNT; ++i)
+        posted_stalls_[i] = stalls_[i];
+    }
+  }
+  bool armed = true;
+  for (int i = 0; i < RESOURCE_COUNT; ++i) {
+    if (trigger_fds_[i] < 0 && !ArmTrigger(static_cast<Resource>(i)))
+      armed = false;
+  }
+
+  if (timeout_cb_id_ == 0 && (!armed || sampling_interval_requested())) {
+    interval_ = sampling_interval();
+    timeout_cb_id_ = g_timeout_add(interval_,
+                                   SysInfoPressure::OnUpdateTimeout,
+                                   static_cast<gpointer>(this));
+  }
+}
+
+void SysInfoPressure::StopListening() {
+  if (timeout_cb_id_ > 0) {
+    g_source_remove(timeout_cb_id_);
+    timeout_cb_id_ = 0;
+  }
+  if (decay_cb_id_ > 0) {
+    g_source_remove(decay_cb_id_);
+    decay_cb_id_ = 0;
+  }
+  for (int i = 0; i < RESOURCE_COUNT; ++i) {
+    if (trigger_ids_[i] > 0)
+      g_source_remove(trigger_ids_[i]);
+    if (trigger_fds_[i] >= 0)
+      close(trigger_fds_[i]);
+    trigger_fds_[i] = -1;
+    trigger_ids_[i] = 0;
+  }
+}
+
+void SysInfoPressure::OnListenersChanged() {
+  if (timeout_cb_id_ > 0 && interval_ == sampling_interval())
+    return;
+  if (timeout_cb_id_ > 0) {
+    g_source_remove(timeout_cb_id_);
+    timeout_cb_id_ = 0;
+  }
+  StartListening();
+}
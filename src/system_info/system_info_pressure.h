@@ -0,0 +1,86 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYSTEM_INFO_SYSTEM_INFO_PRESSURE_H_
+#define SYSTEM_INFO_SYSTEM_INFO_PRESSURE_H_
+
+#include <glib.h>
+#include <pthread.h>
+
+#include <string>
+
+#include "common/picojson.h"
+#include "common/utils.h"
+#include "system_info/system_info_instance.h"
+#include "system_info/system_info_utils.h"
+
+// Pressure stall information: the share of the last 10 seconds some or all
+// tasks waited for CPU, memory or I/O, in percent.
+class SysInfoPressure : public SysInfoObject {
+ public:
+  static SysInfoObject& GetInstance() {
+    static SysInfoPressure instance;
+    return instance;
+  }
+  ~SysInfoPressure();
+  void Get(picojson::value& error, picojson::value& data);
+  void StartListening();
+  void StopListening();
+  void OnListenersChanged();
+  bool CanGetConcurrently() const { return true; }
+
+  static const std::string name_;
+
+ private:
+  enum Resource {
+    RESOURCE_CPU = 0,
+    RESOURCE_MEMORY,
+    RESOURCE_IO,
+    RESOURCE_COUNT
+  };
+
+  struct Stall {
+    Stall() : some(0.0), full(0.0) {}
+
+    double some;
+    double full;
+  };
+
+  const char* ThresholdAttribute() const { return "memorySome"; }
+
+  SysInfoPressure();
+  bool Update();
+  void SetData(picojson::value& data);
+  // Fills |data| and keeps the values as posted if |always|, or if one
+  // moved by a step since they were last posted.
+  bool UpdatePosted(bool always, picojson::value& data);
+  void PostPressure(const picojson::value& data);
+  bool ArmTrigger(Resource resource);
+  static gboolean OnTrigger(GIOChannel* channel, GIOCondition condition,
+                            gpointer user_data);
+  void Sample();
+  bool Settled();
+  static gboolean OnUpdateTimeout(gpointer user_data);
+  static gboolean OnDecayTimeout(gpointer user_data);
+
+  // Guards the values below against a concurrent Get() and the GLib main
+  // loop.
+  pthread_mutex_t mutex_;
+  Stall stalls_[RESOURCE_COUNT];
+  // What the listeners were told last, Get() refreshes |stalls_|.
+  Stall posted_stalls_[RESOURCE_COUNT];
+  // PSI triggers, -1 where the kernel doesn't support them or we may not
+  // create them.
+  int trigger_fds_[RESOURCE_COUNT];
+  guint trigger_ids_[RESOURCE_COUNT];
+  // Polls what triggers don't cover.
+  guint timeout_cb_id_;
+  unsigned interval_;
+  // Triggers only fire on rising stalls, their decay is polled for.
+  guint decay_cb_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(SysInfoPressure);
+};
+
+#endif  // SYSTEM_INFO_SYSTEM_INFO_PRESSURE_H_
@@ -0,0 +1,216 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "system_info/system_info_process.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+namespace {
+
+// Smaller changes aren't worth telling the listeners about.
+const double kCpuLoadStep = 0.01;
+const double kRssStep = 0.01;  // relative
+const double kIoRateStep = 64 * 1024;
+
+bool ReadFd(int fd, char* buffer, size_t size) {
+  if (fd < 0)
+    return false;
+  ssize_t length = pread(fd, buffer, size - 1, 0);
+  if (length <= 0)
+    return false;
+  buffer[length] = '\0';
+  return true;
+}
+
+// Value of the |key| line of /proc/self/io.
+bool GetIoValue(const char* buffer, const char* key, double* value) {
+  const char* line = strstr(buffer, key);
+  if (!line)
+    return false;
+  *value = strtod(line + strlen(key), NULL);
+  return true;
+}
+
+int CountFds() {
+  DIR* dir = opendir("/proc/self/fd");
+  if (!dir)
+    return 0;
+  // Leaves out ".", ".." and the fd of |dir| itself.
+  int count = -3;
+  while (readdir(dir))
+    ++count;
+  closedir(dir);
+  return count;
+}
+
+}  // namespace
+
+const std::string SysInfoProcess::name_ = "PROCESS";
+
+SysInfoProcess::SysInfoProcess()
+    : stat_fd_(open("/proc/self/stat", O_RDONLY | O_CLOEXEC)),
+      statm_fd_(open("/proc/self/statm", O_RDONLY | O_CLOEXEC)),
+      io_fd_(open("/proc/self/io", O_RDONLY | O_CLOEXEC)),
+      ticks_per_second_(sysconf(_SC_CLK_TCK)),
+      page_size_(sysconf(_SC_PAGESIZE)),
+      cpu_count_(sysconf(_SC_NPROCESSORS_ONLN)),
+      timeout_cb_id_(0),
+      interval_(0) {
+  if (cpu_count_ < 1)
+    cpu_count_ = 1;
+}
+
+SysInfoProcess::~SysInfoProcess() {
+  StopListening();
+  if (stat_fd_ >= 0)
+    close(stat_fd_);
+  if (statm_fd_ >= 0)
+    close(statm_fd_);
+  if (io_fd_ >= 0)
+    close(io_fd_);
+}
+
+void SysInfoProcess::Get(picojson::value& error,
+                         picojson::value& data) {
+  Sample sample;
+  if (!Read(&sample)) {
+    system_info::SetPicoJsonObjectValue(error, "message",
+        picojson::value("Get process information failed."));
+    return;
+  }
+  if (get_sample_.time)
+    ComputeDeltas(get_sample_, &sample);
+  get_sample_ = sample;
+
+  SetData(sample, data);
+  system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
+}
+
+bool SysInfoProcess::Read(Sample* sample) const {
+  char buffer[1024];
+  if (!ReadFd(stat_fd_, buffer, sizeof(buffer)))
+    return false;
+  // The command name may hold spaces and parentheses, fields are counted
+  // from the last ')'. utime and stime are the 14th and 15th fields.
+  const char* p = strrchr(buffer, ')');
+  if (!p)
+    return false;
+  unsigned long long utime, stime;  // NOLINT
+  if (sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+             &utime, &stime) != 2)
+    return false;
+  sample->cpu_time = (utime + stime) / ticks_per_second_;
+
+  unsigned long long size, resident;  // NOLINT
+  if (!ReadFd(statm_fd_, buffer, sizeof(buffer)) ||
+      sscanf(buffer, "%llu %llu", &size, &resident) != 2)
+    return false;
+  sample->virtual_size = size * page_size_;
+  sample->rss = resident * page_size_;
+
+  // Without CONFIG_TASK_IO_ACCOUNTING, there is no I/O to report.
+  if (!ReadFd(io_fd_, buffer, sizeof(buffer)) ||
+      !GetIoValue(buffer, "read_bytes:", &sample->read_bytes) ||
+      !GetIoValue(buffer, "write_bytes:", &sample->write_bytes))
+    sample->read_bytes = sample->write_bytes = 0.0;
+
+  sample->fd_count = CountFds();
+  sample->time = g_get_monotonic_time();
+  return true;
+}
+
+void SysInfoProcess::ComputeDeltas(const Sample& previous, Sample* sample) {
+  double elapsed = (sample->time - previous.time) / 1000000.0;
+  if (elapsed <= 0)
+    return;
+  sample->cpu_load = (sample->cpu_time - previous.cpu_time) / elapsed;
+  sample->read_rate = (sample->read_bytes - previous.read_bytes) / elapsed;
+  sample->write_rate = (sample->write_bytes - previous.write_bytes) / elapsed;
+}
+
+void SysInfoProcess::SetData(const Sample& sample, picojson::value& data) {
+  double cpu_load = sample.cpu_load / cpu_count_;
+  system_info::SetPicoJsonObjectValue(data, "cpuTime",
+      picojson::value(sample.cpu_time));
+  system_info::SetPicoJsonObjectValue(data, "cpuLoad",
+      picojson::value(cpu_load > 1.0 ? 1.0 : cpu_load));
+  system_info::SetPicoJsonObjectValue(data, "rss",
+      picojson::value(sample.rss));
+  system_info::SetPicoJsonObjectValue(data, "virtualSize",
+      picojson::value(sample.virtual_size));
+  system_info::SetPicoJsonObjectValue(data, "fdCount",
+      picojson::value(static_cast<double>(sample.fd_count)));
+  system_info::SetPicoJsonObjectValue(data, "readBytes",
+      picojson::value(sample.read_bytes));
+  system_info::SetPicoJsonObjectValue(data, "writeBytes",
+      picojson::value(sample.write_bytes));
+  system_info::SetPicoJsonObjectValue(data, "readRate",
+      picojson::value(sample.read_rate));
+  system_info::SetPicoJsonObjectValue(data, "writeRate",
+      picojson::value(sample.write_rate));
+}
+
+gboolean SysInfoProcess::OnUpdateTimeout(gpointer user_data) {
+  SysInfoProcess* instance = static_cast<SysInfoProcess*>(user_data);
+
+  Sample sample;
+  if (!instance->Read(&sample))
+    return TRUE;
+  Sample previous = instance->poll_sample_;
+  if (previous.time)
+    ComputeDeltas(previous, &sample);
+  instance->poll_sample_ = sample;
+
+  if (fabs(sample.cpu_load - previous.cpu_load) / instance->cpu_count_ <
+          kCpuLoadStep &&
+      fabs(sample.rss - previous.rss) < kRssStep * previous.rss &&
+      sample.fd_count == previous.fd_count &&
+      fabs(sample.read_rate - previous.read_rate) < kIoRateStep &&
+      fabs(sample.write_rate - previous.write_rate) < kIoRateStep)
+    return TRUE;
+
+  picojson::value output = picojson::value(picojson::object());
+  picojson::value data = picojson::value(picojson::object());
+
+  instance->SetData(sample, data);
+  system_info::SetPicoJsonObjectValue(output, "cmd",
+      picojson::value("SystemInfoPropertyValueChanged"));
+  system_info::SetPicoJsonObjectValue(output, "prop",
+      picojson::value("PROCESS"));
+  system_info::SetPicoJsonObjectValue(output, "data", data);
+  instance->PostMessageToListeners(output);
+  return TRUE;
+}
+
+void SysInfoProcess::StartListening() {
+  if (timeout_cb_id_ > 0)
+    return;
+  // Deltas need a first sample.
+  poll_sample_ = Sample();
+  Read(&poll_sample_);
+  interval_ = sampling_interval();
+  timeout_cb_id_ = g_timeout_add(interval_, SysInfoProcess::OnUpdateTimeout,
+                                 static_cast<gpointer>(this));
+}
+
+void SysInfoProcess::StopListening() {
+  if (timeout_cb_id_ > 0) {
+    g_source_remove(timeout_cb_id_);
+    timeout_cb_id_ = 0;
+  }
+}
+
+void SysInfoProcess::OnListenersChanged() {
+  if (timeout_cb_id_ == 0 || interval_ == sampling_interval())
+    return;
+  StopListening();
+  StartListening();
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYSTEM_INFO_SYSTEM_INFO_PROCESS_H_
+#define SYSTEM_INFO_SYSTEM_INFO_PROCESS_H_
+
+#include <glib.h>
+
+#include <string>
+
+#include "common/picojson.h"
+#include "common/utils.h"
+#include "system_info/system_info_instance.h"
+#include "system_info/system_info_utils.h"
+
+// Resource usage of the process running the extension, for apps to watch
+// their own load.
+class SysInfoProcess : public SysInfoObject {
+ public:
+  static SysInfoObject& GetInstance() {
+    static SysInfoProcess instance;
+    return instance;
+  }
+  ~SysInfoProcess();
+  void Get(picojson::value& error, picojson::value& data);
+  void StartListening();
+  void StopListening();
+  void OnListenersChanged();
+
+  static const std::string name_;
+
+  // Share of the CPUs used since the previous sample, in [0, 1].
+  const char* ThresholdAttribute() const { return "cpuLoad"; }
+
+ private:
+  struct Sample {
+    Sample()
+        : time(0),
+          cpu_time(0.0),
+          rss(0.0),
+          virtual_size(0.0),
+          fd_count(0),
+          read_bytes(0.0),
+          write_bytes(0.0),
+          cpu_load(0.0),
+          read_rate(0.0),
+          write_rate(0.0) {}
+
+    // Monotonic, in us.
+    gint64 time;
+    // In s.
+    double cpu_time;
+    // In bytes.
+    double rss;
+    double virtual_size;
+    int fd_count;
+    double read_bytes;
+    double write_bytes;
+
+    // Since the previous sample; rates in bytes/s.
+    double cpu_load;
+    double read_rate;
+    double write_rate;
+  };
+
+  SysInfoProcess();
+  bool Read(Sample* sample) const;
+  // Fills the deltas of |sample| from |previous|, when there is one.
+  static void ComputeDeltas(const Sample& previous, Sample* sample);
+  void SetData(const Sample& sample, picojson::value& data);
+  static gboolean OnUpdateTimeout(gpointer user_data);
+
+  // /proc/self/stat, statm and io, kept open.
+  int stat_fd_;
+  int statm_fd_;
+  int io_fd_;
+  double ticks_per_second_;
+  double page_size_;
+  int cpu_count_;
+
+  // Get() and the update timer run on different threads, each computes
+  // its deltas from its own previous sample.
+  Sample get_sample_;
+  Sample poll_sample_;
+  guint timeout_cb_id_;
+  unsigned interval_;
+
+  DISALLOW_COPY_AND_ASSIGN(SysInfoProcess);
+};
+
+#endif  // SYSTEM_INFO_SYSTEM_INFO_PROCESS_H_
@@ -14,7 +14,10 @@ SysInfoSim::SysInfoSim()
       msin_(""),
       spn_("") {}
 
-SysInfoSim::~SysInfoSim() {}
+SysInfoSim::~SysInfoSim() {
+  if (has_listeners())
+    StopListening();
+}
 
 void SysInfoSim::Get(picojson::value& error,
                      picojson::value& data) {
@@ -4,44 +4,74 @@
 
 #include "system_info/system_info_storage.h"
 
+#include <math.h>
+#include <mntent.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#include <set>
+
 #include "common/picojson.h"
 
+namespace {
+
+// Capacities older than this are read again, and they are checked this
+// often while listening; there is no event for the free space.
+const gint64 kSnapshotTTL = 5000;
+
+// Smaller changes of the available capacity, relative to the capacity,
+// aren't worth telling the listeners about.
+const double kAvailableCapacityStep = 0.01;
+
+gint64 Now() {
+  return g_get_monotonic_time() / 1000;
+}
+
+}  // namespace
+
 const std::string SysInfoStorage::name_ = "STORAGE";
 
 SysInfoStorage::SysInfoStorage()
-    : enumerate_(NULL),
-      udev_(udev_new()),
-      udev_monitor_(NULL),
-      udev_monitor_fd_(-1),
-      timeout_cb_id_(0) {
-  units_ = picojson::value(picojson::array(0));
-  InitStorageMonitor();
+    : udev_watch_("block", SysInfoStorage::OnBlockEvent, this),
+      snapshot_time_(0),
+      capacity_timeout_id_(0) {
+  pthread_mutex_init(&mutex_, NULL);
+  data_ = picojson::value(picojson::object());
   QueryAllAvailableStorageUnits();
 }
 
 SysInfoStorage::~SysInfoStorage() {
-  if (enumerate_)
-    udev_enumerate_unref(enumerate_);
-  if (udev_monitor_)
-    udev_monitor_unref(udev_monitor_);
-  if (udev_)
-    udev_unref(udev_);
-  if (timeout_cb_id_ > 0) {
-    g_source_remove(timeout_cb_id_);
-    timeout_cb_id_ = 0;
-  }
+  StopListening();
+  pthread_mutex_destroy(&mutex_);
 }
 
 void SysInfoStorage::Get(picojson::value& error,
                          picojson::value& data) {
+  AutoLock lock(&mutex_);
+  if (Now() - snapshot_time_ >= kSnapshotTTL) {
+    // The list is only kept up to date by udev events while listening,
+    // otherwise it is built again from the UdevService's.
+    if (!has_listeners())
+      QueryAllAvailableStorageUnits();
+    UpdateCapacities();
+  }
   GetAllAvailableStorageDevices();
-  system_info::SetPicoJsonObjectValue(data, "units", units_);
+  data = data_;
   system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
 }
 
+// Next Get() reads the capacities again, for apps which can't live with
+// a snapshot a few seconds old.
+void SysInfoStorage::Invalidate() {
+  AutoLock lock(&mutex_);
+  snapshot_time_ = 0;
+}
+
 void SysInfoStorage::GetAllAvailableStorageDevices() {
-  picojson::array& units_arr = units_.get<picojson::array>();
-  units_arr.clear();
+  data_ = picojson::value(picojson::object());
+  picojson::value units = picojson::value(picojson::array(0));
+  picojson::array& units_arr = units.get<picojson::array>();
+  double internal_available_capacity = 0.0;
 
   std::map<int, SysInfoDeviceStorageUnit>::const_iterator it;
   for (it = storages_.begin(); it != storages_.end(); ++it) {
@@ -58,51 +88,43 @@ void SysInfoStorage::GetAllAvailableStorageDevices() {
     system_info::SetPicoJsonObjectValue(unit, "isRemoveable",
         picojson::value(it->second.is_removable));
     units_arr.push_back(unit);
+    if (it->second.type == INTERNAL)
+      internal_available_capacity += it->second.available_capacity;
   }
-}
-
-void SysInfoStorage::InitStorageMonitor() {
-  if (!udev_) {
-    std::cout << "Failed to create udev \n";
-    return;
-  }
-  udev_monitor_ = udev_monitor_new_from_netlink(udev_, "udev");
-  if (!udev_monitor_) {
-    std::cout << "Failed to create udev monitor \n";
-    return;
-  }
-  udev_monitor_filter_add_match_subsystem_devtype(udev_monitor_,
-                                                  "block", NULL);
-  udev_monitor_enable_receiving(udev_monitor_);
-  udev_monitor_fd_ = udev_monitor_get_fd(udev_monitor_);
-
-  enumerate_ = udev_enumerate_new(udev_);
-  if (!enumerate_) {
-    std::cout << "Failed to create udev enumerate \n";
-    return;
-  }
-  udev_enumerate_add_match_subsystem(enumerate_, "block");
+  system_info::SetPicoJsonObjectValue(data_, "units", units);
+  system_info::SetPicoJsonObjectValue(data_, "availableCapacity",
+      picojson::value(internal_available_capacity));
 }
 
 void SysInfoStorage::QueryAllAvailableStorageUnits() {
   storages_.clear();
-  udev_list_entry* dev_list_entry;
-  udev_device* dev;
-  udev_enumerate_scan_devices(enumerate_);
-  udev_list_entry* devices = udev_enumerate_get_list_entry(enumerate_);
-  udev_list_entry_foreach(dev_list_entry, devices) {
-    const char* path = udev_list_entry_get_name(dev_list_entry);
-    dev = udev_device_new_from_syspath(udev_, path);
-    const char* type = udev_device_get_devtype(dev);
-    // Here, type may be 'disk' or 'partition'. We neend to filter 'partition'.
-    // For example, /dev/sda is disk. /dev/sda1 is partition.
-    if (strcmp(type, "disk"))
-      continue;
-    SysInfoDeviceStorageUnit unit;
-    if (MakeStorageUnit(unit, dev))
-      storages_[unit.id] = unit;
-    udev_device_unref(dev);
-  }
+  system_info::UdevService::GetInstance().ForEachDevice("block",
+      AddStorageUnit, this);
+}
+
+bool SysInfoStorage::AddStorageUnit(udev_device* dev, void* user_data) {
+  SysInfoStorage* instance = static_cast<SysInfoStorage*>(user_data);
+
+  // Here, type may be 'disk' or 'partition'. We neend to filter 'partition'.
+  // For example, /dev/sda is disk. /dev/sda1 is partition.
+  const char* type = udev_device_get_devtype(dev);
+  if (!type || strcmp(type, "disk"))
+    return true;
+  SysInfoDeviceStorageUnit unit;
+  if (instance->MakeStorageUnit(unit, dev))
+    instance->storages_[unit.id] = unit;
+  return true;
+}
+
+// Maps the number of each block device to the number of its disk.
+bool SysInfoStorage::AddDisk(udev_device* dev, void* user_data) {
+  std::map<dev_t, int>* disks = static_cast<std::map<dev_t, int>*>(user_data);
+
+  udev_device* disk = udev_device_get_parent_with_subsystem_devtype(dev,
+      "block", "disk");
+  (*disks)[udev_device_get_devnum(dev)] =
+      udev_device_get_devnum(disk ? disk : dev);
+  return true;
 }
 
 bool SysInfoStorage::MakeStorageUnit(SysInfoDeviceStorageUnit& unit,
@@ -120,11 +142,73 @@ bool SysInfoStorage::MakeStorageUnit(SysInfoDeviceStorageUnit& unit,
   }
   unit.id = udev_device_get_devnum(dev);
   unit.capacity = std::stof(udev_device_get_sysattr_value(dev, "size")) * 512;
-  // TODO(qjia7): Find which attri reflects available capacity in udev.
+  // Known once it is mounted, see UpdateCapacities().
   unit.available_capacity = 0.0;
+  unit.is_mounted = false;
   return true;
 }
 
+// The capacities of a disk are those of the file systems mounted from it
+// or its partitions.
+void SysInfoStorage::UpdateCapacities() {
+  snapshot_time_ = Now();
+
+  FILE* mounts = setmntent("/proc/mounts", "r");
+  if (!mounts)
+    return;
+
+  std::map<dev_t, int> disks;
+  system_info::UdevService::GetInstance().ForEachDevice("block", AddDisk,
+                                                        &disks);
+
+  StoragesMap capacities;
+  std::set<dev_t> seen;  // bind mounts show up more than once
+  while (mntent* entry = getmntent(mounts)) {
+    struct stat st;
+    if (strncmp(entry->mnt_fsname, "/dev/", 5) ||
+        stat(entry->mnt_fsname, &st) || !S_ISBLK(st.st_mode) ||
+        !seen.insert(st.st_rdev).second)
+      continue;
+
+    struct statvfs vfs;
+    if (statvfs(entry->mnt_dir, &vfs))
+      continue;
+
+    std::map<dev_t, int>::const_iterator disk = disks.find(st.st_rdev);
+    if (disk == disks.end())
+      continue;
+
+    SysInfoDeviceStorageUnit& unit = capacities[disk->second];
+    unit.capacity += static_cast<double>(vfs.f_blocks) * vfs.f_frsize;
+    unit.available_capacity +=
+        static_cast<double>(vfs.f_bavail) * vfs.f_frsize;
+  }
+  endmntent(mounts);
+
+  for (StoragesMap::iterator it = storages_.begin();
+       it != storages_.end(); ++it) {
+    StoragesMap::const_iterator mounted = capacities.find(it->first);
+    it->second.is_mounted = mounted != capacities.end();
+    if (!it->second.is_mounted) {
+      it->second.available_capacity = 0.0;
+      continue;
+    }
+    it->second.capacity = mounted->second.capacity;
+    it->second.available_capacity = mounted->second.available_capacity;
+  }
+}
+
+void SysInfoStorage::PostUnits(const picojson::value& data) {
+  picojson::value output = picojson::value(picojson::object());
+
+  system_info::SetPicoJsonObjectValue(output, "cmd",
+      picojson::value("SystemInfoPropertyValueChanged"));
+  system_info::SetPicoJsonObjectValue(output, "prop",
+      picojson::value("STORAGE"));
+  system_info::SetPicoJsonObjectValue(output, "data", data);
+  PostMessageToListeners(output);
+}
+
 std::string SysInfoStorage::ToStorageUnitTypeString(StorageUnitType type) {
   switch (type) {
     case INTERNAL:
@@ -139,69 +223,93 @@ std::string SysInfoStorage::ToStorageUnitTypeString(StorageUnitType type) {
   }
 }
 
-void SysInfoStorage::UpdateStorageList() {
-  fd_set fds;
-  timeval tv;
-
-  FD_ZERO(&fds);
-  FD_SET(udev_monitor_fd_, &fds);
-  tv.tv_sec = 0;
-  tv.tv_usec = 0;
+void SysInfoStorage::OnBlockEvent(udev_device* dev, void* user_data) {
+  SysInfoStorage* instance = static_cast<SysInfoStorage*>(user_data);
 
-  // select() will only operate on a single file descriptor, which is related
-  // to the udev_monitor. The timeval object is set to 0 for not blocking
-  // select().
-  int ret = select(udev_monitor_fd_ + 1, &fds, NULL, NULL, &tv);
-  if (ret > 0 && FD_ISSET(udev_monitor_fd_, &fds)) {
-    udev_device* dev = udev_monitor_receive_device(udev_monitor_);
-    if (!dev)
-      return;
+  // Partitions come and go with their disk.
+  const char* type = udev_device_get_devtype(dev);
+  const char* action = udev_device_get_action(dev);
+  if (!type || strcmp(type, "disk") || !action)
+    return;
 
-    int dev_id = udev_device_get_devnum(dev);
-    std::string action = udev_device_get_action(dev);
-    if (action == "add") {
+  int dev_id = udev_device_get_devnum(dev);
+  picojson::value data;
+  {
+    AutoLock lock(&instance->mutex_);
+    if (!strcmp(action, "add")) {
       SysInfoDeviceStorageUnit unit;
-      if (MakeStorageUnit(unit, dev))
-        storages_[unit.id] = unit;
-    } else if (action == "remove") {
-      storages_.erase(dev_id);
+      if (!instance->MakeStorageUnit(unit, dev))
+        return;
+      instance->storages_[unit.id] = unit;
+    } else if (!strcmp(action, "remove")) {
+      if (!instance->storages_.erase(dev_id))
+        return;
+    } else {
+      return;
     }
-    udev_device_unref(dev);
+
+    instance->UpdateCapacities();
+    instance->posted_storages_ = instance->storages_;
+    instance->GetAllAvailableStorageDevices();
+    data = instance->data_;
   }
+  instance->PostUnits(data);
 }
 
-gboolean SysInfoStorage::OnUpdateTimeout(gpointer user_data) {
+// Catches mounts, unmounts and the free space going up or down. The
+// values are compared with what was posted, so that a disk filling slowly
+// adds up to a step, and changes a Get() saw first are still told.
+gboolean SysInfoStorage::OnCapacityTimeout(gpointer user_data) {
   SysInfoStorage* instance = static_cast<SysInfoStorage*>(user_data);
-  int old_storage_count = instance->storages_.size();
-  instance->UpdateStorageList();
-  if (instance->storages_.size() == old_storage_count)
-    return TRUE;
 
-  instance->GetAllAvailableStorageDevices();
-  picojson::value output = picojson::value(picojson::object());
-  picojson::value data = picojson::value(picojson::object());
+  picojson::value data;
+  {
+    AutoLock lock(&instance->mutex_);
+    instance->UpdateCapacities();
 
-  system_info::SetPicoJsonObjectValue(data, "units", instance->units_);
-  system_info::SetPicoJsonObjectValue(output, "cmd",
-      picojson::value("SystemInfoPropertyValueChanged"));
-  system_info::SetPicoJsonObjectValue(output, "prop",
-      picojson::value("STORAGE"));
-  system_info::SetPicoJsonObjectValue(output, "data", data);
-  instance->PostMessageToListeners(output);
+    StoragesMap& posted = instance->posted_storages_;
+    bool changed = posted.size() != instance->storages_.size();
+    for (StoragesMap::const_iterator it = instance->storages_.begin();
+         it != instance->storages_.end() && !changed; ++it) {
+      const SysInfoDeviceStorageUnit& unit = it->second;
+      StoragesMap::const_iterator old = posted.find(it->first);
+      if (old == posted.end()) {
+        changed = true;
+        break;
+      }
+      const SysInfoDeviceStorageUnit& old_unit = old->second;
+      changed = unit.is_mounted != old_unit.is_mounted ||
+          unit.capacity != old_unit.capacity ||
+          fabs(unit.available_capacity - old_unit.available_capacity) >=
+              kAvailableCapacityStep * unit.capacity;
+    }
+    if (!changed)
+      return TRUE;
+    posted = instance->storages_;
+    instance->GetAllAvailableStorageDevices();
+    data = instance->data_;
+  }
+  instance->PostUnits(data);
   return TRUE;
 }
 
 void SysInfoStorage::StartListening() {
-  if (timeout_cb_id_ == 0) {
-    timeout_cb_id_ = g_timeout_add(system_info::default_timeout_interval,
-                                   SysInfoStorage::OnUpdateTimeout,
-                                   static_cast<gpointer>(this));
+  {
+    AutoLock lock(&mutex_);
+    QueryAllAvailableStorageUnits();
+    UpdateCapacities();
+    posted_storages_ = storages_;
   }
+  udev_watch_.Start();
+  if (!capacity_timeout_id_)
+    capacity_timeout_id_ = g_timeout_add(kSnapshotTTL,
+        SysInfoStorage::OnCapacityTimeout, this);
 }
 
 void SysInfoStorage::StopListening() {
-  if (timeout_cb_id_ > 0) {
-    g_source_remove(timeout_cb_id_);
-    timeout_cb_id_ = 0;
+  udev_watch_.Stop();
+  if (capacity_timeout_id_) {
+    g_source_remove(capacity_timeout_id_);
+    capacity_timeout_id_ = 0;
   }
 }
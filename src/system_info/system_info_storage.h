@@ -7,6 +7,7 @@
 
 #include <glib.h>
 #include <libudev.h>
+#include <pthread.h>
 
 #include <map>
 #include <string>
@@ -28,6 +29,9 @@ struct SysInfoDeviceStorageUnit {
   double capacity;
   int id;
   bool is_removable;
+  // Whether the capacities come from the mounted file systems or, for a
+  // disk which isn't mounted, from its size.
+  bool is_mounted;
   StorageUnitType type;
 };
 
@@ -41,28 +45,42 @@ class SysInfoStorage : public SysInfoObject {
   void Get(picojson::value& error, picojson::value& data);
   void StartListening();
   void StopListening();
+  void Invalidate();
+  bool CanGetConcurrently() const { return true; }
 
   static const std::string name_;
 
  private:
+  // The thresholds apply to the space left on the internal storage, so
+  // a lowThreshold listener hears about low storage.
+  const char* ThresholdAttribute() const { return "availableCapacity"; }
+
   SysInfoStorage();
   void GetAllAvailableStorageDevices();
-  void InitStorageMonitor();
   void QueryAllAvailableStorageUnits();
+  static bool AddStorageUnit(udev_device* dev, void* user_data);
+  static bool AddDisk(udev_device* dev, void* user_data);
   bool MakeStorageUnit(SysInfoDeviceStorageUnit& unit, udev_device* dev) const;
+  void UpdateCapacities();
+  void PostUnits(const picojson::value& data);
   std::string ToStorageUnitTypeString(StorageUnitType type);
-  void UpdateStorageList();
-  static gboolean OnUpdateTimeout(gpointer user_data);
+  static void OnBlockEvent(udev_device* dev, void* user_data);
+  static gboolean OnCapacityTimeout(gpointer user_data);
+
+  system_info::UdevWatch udev_watch_;
 
-  int timeout_cb_id_;
-  int udev_monitor_fd_;
-  picojson::value units_;
-  udev* udev_;
-  udev_enumerate* enumerate_;
-  udev_monitor* udev_monitor_;
+  // Guards the values below against a concurrent Get() and the GLib main
+  // loop.
+  pthread_mutex_t mutex_;
+  picojson::value data_;
 
   typedef std::map<int, SysInfoDeviceStorageUnit> StoragesMap;
   StoragesMap storages_;
+  // What the listeners were told last, Get() refreshes |storages_|.
+  StoragesMap posted_storages_;
+  // When the capacities were read, in ms of the monotonic clock.
+  gint64 snapshot_time_;
+  guint capacity_timeout_id_;
 
   DISALLOW_COPY_AND_ASSIGN(SysInfoStorage);
 };
@@ -0,0 +1,320 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "system_info/system_info_thermal.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char kThermalDir[] = "/sys/class/thermal";
+
+// Polling backs off up to this interval while the temperatures don't move.
+const unsigned kMaxTimeoutInterval = 16 * system_info::default_timeout_interval;
+
+// Changes below this, in degrees Celsius, aren't worth telling about.
+const double kTemperatureStep = 1.0;
+
+// Integer value of an open sysfs attribute, read again from the start.
+bool ReadValue(int fd, long* value) {  // NOLINT
+  char buffer[32];
+  ssize_t size = pread(fd, buffer, sizeof(buffer) - 1, 0);
+  if (size <= 0)
+    return false;
+  buffer[size] = '\0';
+  char* end;
+  *value = strtol(buffer, &end, 10);
+  return end != buffer;
+}
+
+std::string ReadString(const std::string& path) {
+  char* line = system_info::ReadOneLine(path.c_str());
+  if (!line)
+    return "";
+  std::string value(line);
+  free(line);
+  if (!value.empty() && value[value.size() - 1] == '\n')
+    value.erase(value.size() - 1);
+  return value;
+}
+
+bool ReadNumber(const std::string& path, long* value) {  // NOLINT
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  bool result = ReadValue(fd, value);
+  close(fd);
+  return result;
+}
+
+}  // namespace
+
+const std::string SysInfoThermal::name_ = "THERMAL";
+
+SysInfoThermal::SysInfoThermal()
+    : udev_watch_("thermal", SysInfoThermal::OnThermalEvent, this),
+      timeout_cb_id_(0),
+      interval_(system_info::default_timeout_interval) {
+}
+
+SysInfoThermal::~SysInfoThermal() {
+  StopListening();
+  Clear();
+}
+
+void SysInfoThermal::Get(picojson::value& error,
+                         picojson::value& data) {
+  // Zones only come and go with drivers, udev tells about it while
+  // listening.
+  if (!has_listeners())
+    Enumerate();
+  if (zones_.empty() || !UpdateValues()) {
+    system_info::SetPicoJsonObjectValue(error, "message",
+        picojson::value("No thermal zone found."));
+    return;
+  }
+
+  SetData(data);
+  system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
+}
+
+void SysInfoThermal::Clear() {
+  for (unsigned i = 0; i < zones_.size(); ++i)
+    close(zones_[i].temp_fd);
+  for (unsigned i = 0; i < cooling_devices_.size(); ++i)
+    close(cooling_devices_[i].state_fd);
+  zones_.clear();
+  cooling_devices_.clear();
+}
+
+// Opens the attributes read on each update and reads the others once.
+void SysInfoThermal::Enumerate() {
+  Clear();
+
+  DIR* dir = opendir(kThermalDir);
+  if (!dir)
+    return;
+  while (dirent* entry = readdir(dir)) {
+    std::string path = std::string(kThermalDir) + "/" + entry->d_name;
+    int id;
+    if (sscanf(entry->d_name, "thermal_zone%d", &id) == 1) {
+      Zone zone;
+      zone.id = id;
+      zone.type = ReadString(path + "/type");
+      zone.temperature = 0.0;
+      zone.temp_fd = open((path + "/temp").c_str(), O_RDONLY | O_CLOEXEC);
+      if (zone.temp_fd < 0)
+        continue;
+      for (int i = 0; ; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "/trip_point_%d_temp", i);
+        long temp;  // NOLINT
+        if (!ReadNumber(path + name, &temp))
+          break;
+        snprintf(name, sizeof(name), "/trip_point_%d_type", i);
+        TripPoint trip_point = { ReadString(path + name), temp / 1000.0 };
+        zone.trip_points.push_back(trip_point);
+      }
+      zones_.push_back(zone);
+    } else if (sscanf(entry->d_name, "cooling_device%d", &id) == 1) {
+      CoolingDevice device;
+      device.id = id;
+      device.type = ReadString(path + "/type");
+      device.state = 0;
+      long max_state;  // NOLINT
+      device.max_state = ReadNumber(path + "/max_state", &max_state) ?
+          max_state : 0;
+      device.state_fd = open((path + "/cur_state").c_str(),
+                             O_RDONLY | O_CLOEXEC);
+      if (device.state_fd < 0)
+        continue;
+      cooling_devices_.push_back(device);
+    }
+  }
+  closedir(dir);
+}
+
+bool SysInfoThermal::UpdateValues() {
+  bool result = false;
+  long value;  // NOLINT
+  // Sensors of some zones fail now and then, keep their last value.
+  for (unsigned i = 0; i < zones_.size(); ++i) {
+    if (ReadValue(zones_[i].temp_fd, &value)) {
+      zones_[i].temperature = value / 1000.0;
+      result = true;
+    }
+  }
+  for (unsigned i = 0; i < cooling_devices_.size(); ++i) {
+    if (ReadValue(cooling_devices_[i].state_fd, &value))
+      cooling_devices_[i].state = value;
+  }
+  return result;
+}
+
+std::vector<int> SysInfoThermal::CrossedTripPoints() const {
+  std::vector<int> crossed(zones_.size(), 0);
+  for (unsigned i = 0; i < zones_.size(); ++i) {
+    for (unsigned j = 0; j < zones_[i].trip_points.size(); ++j) {
+      if (zones_[i].temperature >= zones_[i].trip_points[j].temperature)
+        ++crossed[i];
+    }
+  }
+  return crossed;
+}
+
+void SysInfoThermal::SetData(picojson::value& data) {
+  double max_temperature = 0.0;
+  picojson::array zones;
+  for (unsigned i = 0; i < zones_.size(); ++i) {
+    const Zone& zone = zones_[i];
+    picojson::array trip_points;
+    for (unsigned j = 0; j < zone.trip_points.size(); ++j) {
+      picojson::object trip_point;
+      trip_point["type"] = picojson::value(zone.trip_points[j].type);
+      trip_point["temperature"] =
+          picojson::value(zone.trip_points[j].temperature);
+      trip_points.push_back(picojson::value(trip_point));
+    }
+
+    picojson::object o;
+    o["id"] = picojson::value(static_cast<double>(zone.id));
+    o["type"] = picojson::value(zone.type);
+    o["temperature"] = picojson::value(zone.temperature);
+    o["tripPoints"] = picojson::value(trip_points);
+    zones.push_back(picojson::value(o));
+    if (i == 0 || zone.temperature > max_temperature)
+      max_temperature = zone.temperature;
+  }
+
+  picojson::array devices;
+  for (unsigned i = 0; i < cooling_devices_.size(); ++i) {
+    const CoolingDevice& device = cooling_devices_[i];
+    picojson::object o;
+    o["id"] = picojson::value(static_cast<double>(device.id));
+    o["type"] = picojson::value(device.type);
+    o["state"] = picojson::value(static_cast<double>(device.state));
+    o["maxState"] = picojson::value(static_cast<double>(device.max_state));
+    devices.push_back(picojson::value(o));
+  }
+
+  system_info::SetPicoJsonObjectValue(data, "temperature",
+      picojson::value(max_temperature));
+  system_info::SetPicoJsonObjectValue(data, "zones", picojson::value(zones));
+  system_info::SetPicoJsonObjectValue(data, "coolingDevices",
+      picojson::value(devices));
+}
+
+void SysInfoThermal::SetPosted() {
+  posted_temperatures_.clear();
+  posted_states_.clear();
+  for (unsigned i = 0; i < zones_.size(); ++i)
+    posted_temperatures_.push_back(zones_[i].temperature);
+  for (unsigned i = 0; i < cooling_devices_.size(); ++i)
+    posted_states_.push_back(cooling_devices_[i].state);
+  posted_crossed_ = CrossedTripPoints();
+}
+
+void SysInfoThermal::PostThermal() {
+  SetPosted();
+
+  picojson::value output = picojson::value(picojson::object());
+  picojson::value data = picojson::value(picojson::object());
+
+  SetData(data);
+  system_info::SetPicoJsonObjectValue(output, "cmd",
+      picojson::value("SystemInfoPropertyValueChanged"));
+  system_info::SetPicoJsonObjectValue(output, "prop",
+      picojson::value("THERMAL"));
+  system_info::SetPicoJsonObjectValue(output, "data", data);
+  PostMessageToListeners(output);
+}
+
+// Drivers which know about their trip points send a change uevent when
+// one is crossed; zones and cooling devices also come and go this way.
+void SysInfoThermal::OnThermalEvent(udev_device* dev, void* user_data) {
+  SysInfoThermal* instance = static_cast<SysInfoThermal*>(user_data);
+
+  const char* action = udev_device_get_action(dev);
+  if (action && strcmp(action, "change"))
+    instance->Enumerate();
+  instance->UpdateValues();
+  instance->PostThermal();
+  instance->ScheduleUpdate(instance->sampling_interval());
+}
+
+// Not every driver sends uevents, so the temperatures are polled too,
+// less and less often while they are stable. They are compared with what
+// was posted, as Get() and the history recorder refresh them in between.
+gboolean SysInfoThermal::OnUpdateTimeout(gpointer user_data) {
+  SysInfoThermal* instance = static_cast<SysInfoThermal*>(user_data);
+
+  instance->UpdateValues();
+
+  const std::vector<double>& temperatures = instance->posted_temperatures_;
+  const std::vector<int>& states = instance->posted_states_;
+  bool changed = instance->CrossedTripPoints() != instance->posted_crossed_ ||
+      temperatures.size() != instance->zones_.size() ||
+      states.size() != instance->cooling_devices_.size();
+  for (unsigned i = 0; i < instance->zones_.size() && !changed; ++i) {
+    changed = fabs(instance->zones_[i].temperature - temperatures[i]) >=
+        kTemperatureStep;
+  }
+  for (unsigned i = 0; i < instance->cooling_devices_.size() && !changed; ++i)
+    changed = instance->cooling_devices_[i].state != states[i];
+
+  unsigned interval = instance->sampling_interval();
+  if (changed) {
+    instance->PostThermal();
+  } else if (!instance->sampling_interval_requested()) {
+    interval = std::min(instance->interval_ * 2, kMaxTimeoutInterval);
+  }
+  if (interval == instance->interval_)
+    return TRUE;
+
+  instance->timeout_cb_id_ = 0;
+  instance->ScheduleUpdate(interval);
+  return FALSE;
+}
+
+void SysInfoThermal::ScheduleUpdate(unsigned interval) {
+  if (timeout_cb_id_ > 0) {
+    if (interval == interval_)
+      return;
+    g_source_remove(timeout_cb_id_);
+  }
+  interval_ = interval;
+  timeout_cb_id_ = g_timeout_add(interval_, SysInfoThermal::OnUpdateTimeout,
+                                 static_cast<gpointer>(this));
+}
+
+void SysInfoThermal::StartListening() {
+  Enumerate();
+  UpdateValues();
+  SetPosted();
+  udev_watch_.Start();
+  ScheduleUpdate(sampling_interval());
+}
+
+void SysInfoThermal::StopListening() {
+  udev_watch_.Stop();
+  if (timeout_cb_id_ > 0) {
+    g_source_remove(timeout_cb_id_);
+    timeout_cb_id_ = 0;
+  }
+}
+
+void SysInfoThermal::OnListenersChanged() {
+  if (timeout_cb_id_ > 0)
+    ScheduleUpdate(sampling_interval());
+}
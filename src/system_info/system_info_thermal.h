@@ -0,0 +1,89 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYSTEM_INFO_SYSTEM_INFO_THERMAL_H_
+#define SYSTEM_INFO_SYSTEM_INFO_THERMAL_H_
+
+#include <glib.h>
+#include <libudev.h>
+
+#include <string>
+#include <vector>
+
+#include "common/picojson.h"
+#include "common/utils.h"
+#include "system_info/system_info_instance.h"
+#include "system_info/system_info_utils.h"
+
+// Thermal zones and cooling devices of /sys/class/thermal. Temperatures
+// are in degrees Celsius.
+class SysInfoThermal : public SysInfoObject {
+ public:
+  static SysInfoObject& GetInstance() {
+    static SysInfoThermal instance;
+    return instance;
+  }
+  ~SysInfoThermal();
+  void Get(picojson::value& error, picojson::value& data);
+  void StartListening();
+  void StopListening();
+  void OnListenersChanged();
+
+  static const std::string name_;
+
+  // The hottest zone's temperature.
+  const char* ThresholdAttribute() const { return "temperature"; }
+
+ private:
+  struct TripPoint {
+    std::string type;
+    double temperature;
+  };
+
+  struct Zone {
+    int id;
+    std::string type;
+    int temp_fd;
+    double temperature;
+    std::vector<TripPoint> trip_points;
+  };
+
+  struct CoolingDevice {
+    int id;
+    std::string type;
+    int state_fd;
+    int state;
+    int max_state;
+  };
+
+  SysInfoThermal();
+  void Enumerate();
+  void Clear();
+  bool UpdateValues();
+  // Number of trip points at or below the zone's temperature, for all
+  // zones.
+  std::vector<int> CrossedTripPoints() const;
+  void SetData(picojson::value& data);
+  // Keeps the values as what the listeners were told last.
+  void SetPosted();
+  void PostThermal();
+  void ScheduleUpdate(unsigned interval);
+  static void OnThermalEvent(udev_device* dev, void* user_data);
+  static gboolean OnUpdateTimeout(gpointer user_data);
+
+  std::vector<Zone> zones_;
+  std::vector<CoolingDevice> cooling_devices_;
+  // What the listeners were told last, Get() refreshes the values above.
+  std::vector<double> posted_temperatures_;
+  std::vector<int> posted_states_;
+  std::vector<int> posted_crossed_;
+  system_info::UdevWatch udev_watch_;
+  guint timeout_cb_id_;
+  // Grows while the temperatures are stable, see OnUpdateTimeout().
+  unsigned interval_;
+
+  DISALLOW_COPY_AND_ASSIGN(SysInfoThermal);
+};
+
+#endif  // SYSTEM_INFO_SYSTEM_INFO_THERMAL_H_
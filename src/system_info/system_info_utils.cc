@@ -5,6 +5,7 @@
 #include "system_info/system_info_utils.h"
 
 #include <stdio.h>
+#include <sys/inotify.h>
 #if defined(TIZEN)
 #include <tzplatform_config.h>
 #endif
@@ -18,6 +19,8 @@ namespace {
 const int kDuidBufferSize = 100;
 const char kDuidStrKey[] = "http://tizen.org/system/duid";
 
+const uint32_t kFileWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE;
+
 }  // namespace
 
 namespace system_info {
@@ -195,4 +198,283 @@ std::string GetPropertyFromFile(const std::string& file_path,
   return "";
 }
 
+guint AddFdWatch(int fd, GIOFunc callback, gpointer user_data) {
+  return AddFdWatch(fd,
+      static_cast<GIOCondition>(G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP),
+      callback, user_data);
+}
+
+guint AddFdWatch(int fd, GIOCondition condition, GIOFunc callback,
+                 gpointer user_data) {
+  GIOChannel* channel = g_io_channel_unix_new(fd);
+  guint id = g_io_add_watch(channel, condition, callback, user_data);
+  // The watch holds its own reference.
+  g_io_channel_unref(channel);
+  return id;
+}
+
+FileWatch::FileWatch(Callback callback, void* user_data)
+    : callback_(callback),
+      user_data_(user_data),
+      fd_(-1),
+      source_id_(0) {
+}
+
+FileWatch::~FileWatch() {
+  Stop();
+}
+
+void FileWatch::AddPath(const std::string& path) {
+  paths_.push_back(path);
+}
+
+bool FileWatch::Start() {
+  if (fd_ >= 0)
+    return true;
+  if (paths_.empty())
+    return false;
+
+  fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd_ < 0) {
+    std::cout << "Failed to create inotify instance\n";
+    return false;
+  }
+
+  for (unsigned i = 0; i < paths_.size(); ++i) {
+    size_t slash = paths_[i].find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." :
+        slash == 0 ? "/" : paths_[i].substr(0, slash);
+    int wd = inotify_add_watch(fd_, dir.c_str(), kFileWatchMask);
+    if (wd < 0) {
+      std::cout << "Failed to watch " << paths_[i] << "\n";
+      continue;
+    }
+    names_[wd].insert(slash == std::string::npos ?
+                      paths_[i] : paths_[i].substr(slash + 1));
+  }
+
+  source_id_ = AddFdWatch(fd_, FileWatch::OnEvent, this);
+  return true;
+}
+
+void FileWatch::Stop() {
+  if (source_id_ > 0) {
+    g_source_remove(source_id_);
+    source_id_ = 0;
+  }
+  if (fd_ >= 0) {
+    close(fd_);  // also removes the watches
+    fd_ = -1;
+  }
+  names_.clear();
+}
+
+gboolean FileWatch::OnEvent(GIOChannel* channel, GIOCondition condition,
+                            gpointer user_data) {
+  FileWatch* watch = static_cast<FileWatch*>(user_data);
+
+  // Several events typically come at once; report them as one change.
+  bool changed = false;
+  char buf[4096] __attribute__((aligned(__alignof__(inotify_event))));
+  ssize_t len;
+  while ((len = read(watch->fd_, buf, sizeof(buf))) > 0) {
+    char* ptr = buf;
+    while (ptr < buf + len) {
+      const inotify_event* event = reinterpret_cast<inotify_event*>(ptr);
+      std::map<int, std::set<std::string> >::const_iterator it =
+          watch->names_.find(event->wd);
+      if (event->len && it != watch->names_.end() &&
+          it->second.count(event->name))
+        changed = true;
+      ptr += sizeof(inotify_event) + event->len;
+    }
+  }
+
+  if (changed)
+    watch->callback_(watch->user_data_);
+  return TRUE;
+}
+
+// Callbacks of the monitor may walk device lists, hence a recursive lock.
+UdevService::UdevService()
+    : udev_(udev_new()),
+      monitor_(NULL),
+      source_id_(0) {
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&mutex_, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  if (!udev_) {
+    std::cout << "Failed to create udev\n";
+    return;
+  }
+  monitor_ = udev_monitor_new_from_netlink(udev_, "udev");
+  if (!monitor_)
+    std::cout << "Failed to create udev monitor\n";
+}
+
+UdevService::~UdevService() {
+  if (source_id_ > 0)
+    g_source_remove(source_id_);
+  for (std::map<std::string, Subsystem>::iterator it = subsystems_.begin();
+       it != subsystems_.end(); ++it) {
+    std::map<std::string, udev_device*>& devices = it->second.devices;
+    for (std::map<std::string, udev_device*>::iterator dev = devices.begin();
+         dev != devices.end(); ++dev)
+      udev_device_unref(dev->second);
+  }
+  if (monitor_)
+    udev_monitor_unref(monitor_);
+  if (udev_)
+    udev_unref(udev_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+UdevService::Subsystem* UdevService::Use(const std::string& subsystem) {
+  std::map<std::string, Subsystem>::iterator it = subsystems_.find(subsystem);
+  if (it != subsystems_.end())
+    return &it->second;
+
+  Subsystem* result = &subsystems_[subsystem];
+  if (!monitor_)
+    return result;
+  udev_monitor_filter_add_match_subsystem_devtype(monitor_, subsystem.c_str(),
+                                                  NULL);
+  if (source_id_ == 0) {
+    udev_monitor_enable_receiving(monitor_);
+    source_id_ = AddFdWatch(udev_monitor_get_fd(monitor_),
+                            UdevService::OnEvent, this);
+  } else {
+    udev_monitor_filter_update(monitor_);
+  }
+  return result;
+}
+
+void UdevService::AddWatch(const std::string& subsystem, Callback callback,
+                           void* user_data) {
+  AutoLock lock(&mutex_);
+  Watch watch = { callback, user_data };
+  Use(subsystem)->watches.push_back(watch);
+}
+
+void UdevService::RemoveWatch(const std::string& subsystem,
+                              Callback callback, void* user_data) {
+  AutoLock lock(&mutex_);
+  std::map<std::string, Subsystem>::iterator it = subsystems_.find(subsystem);
+  if (it == subsystems_.end())
+    return;
+  std::vector<Watch>& watches = it->second.watches;
+  for (std::vector<Watch>::iterator watch = watches.begin();
+       watch != watches.end(); ++watch) {
+    if (watch->callback == callback && watch->user_data == user_data) {
+      watches.erase(watch);
+      return;
+    }
+  }
+}
+
+void UdevService::ForEachDevice(const std::string& subsystem,
+                                Visitor visitor, void* user_data) {
+  AutoLock lock(&mutex_);
+  if (!udev_)
+    return;
+
+  // The monitor receives the subsystem before it is listed, so no uevent
+  // falls in between.
+  Subsystem* entry = Use(subsystem);
+  if (!entry->listed) {
+    udev_enumerate* enumerate = udev_enumerate_new(udev_);
+    udev_enumerate_add_match_subsystem(enumerate, subsystem.c_str());
+    udev_enumerate_scan_devices(enumerate);
+    udev_list_entry* dev_list_entry;
+    udev_list_entry_foreach(dev_list_entry,
+                            udev_enumerate_get_list_entry(enumerate)) {
+      const char* path = udev_list_entry_get_name(dev_list_entry);
+      udev_device* dev = udev_device_new_from_syspath(udev_, path);
+      if (dev)
+        entry->devices[path] = dev;
+    }
+    udev_enumerate_unref(enumerate);
+    entry->listed = true;
+  }
+
+  for (std::map<std::string, udev_device*>::const_iterator it =
+       entry->devices.begin(); it != entry->devices.end(); ++it) {
+    if (!visitor(it->second, user_data))
+      break;
+  }
+}
+
+gboolean UdevService::OnEvent(GIOChannel* channel, GIOCondition condition,
+                              gpointer user_data) {
+  UdevService* service = static_cast<UdevService*>(user_data);
+  AutoLock lock(&service->mutex_);
+
+  udev_device* dev = udev_monitor_receive_device(service->monitor_);
+  if (!dev)
+    return TRUE;
+  const char* subsystem = udev_device_get_subsystem(dev);
+  std::map<std::string, Subsystem>::iterator it =
+      service->subsystems_.find(subsystem ? subsystem : "");
+  if (it == service->subsystems_.end()) {
+    udev_device_unref(dev);
+    return TRUE;
+  }
+
+  // The device of a uevent carries the properties it changed, so it
+  // replaces the listed one.
+  Subsystem& entry = it->second;
+  if (entry.listed) {
+    const char* action = udev_device_get_action(dev);
+    std::string path = udev_device_get_syspath(dev);
+    std::map<std::string, udev_device*>::iterator listed =
+        entry.devices.find(path);
+    if (listed != entry.devices.end()) {
+      udev_device_unref(listed->second);
+      entry.devices.erase(listed);
+    }
+    if (!action || strcmp(action, "remove"))
+      entry.devices[path] = udev_device_ref(dev);
+  }
+
+  // Watches may go away from their callback.
+  std::vector<Watch> watches = entry.watches;
+  for (unsigned i = 0; i < watches.size(); ++i)
+    watches[i].callback(dev, watches[i].user_data);
+  udev_device_unref(dev);
+  return TRUE;
+}
+
+UdevWatch::UdevWatch(const char* subsystem, Callback callback,
+                     void* user_data)
+    : subsystem_(subsystem),
+      callback_(callback),
+      user_data_(user_data),
+      started_(false) {
+  // Makes the service outlive the owner of this watch, as statics are
+  // destroyed in the reverse order of their construction.
+  UdevService::GetInstance();
+}
+
+UdevWatch::~UdevWatch() {
+  Stop();
+}
+
+bool UdevWatch::Start() {
+  if (!started_) {
+    UdevService::GetInstance().AddWatch(subsystem_, callback_, user_data_);
+    started_ = true;
+  }
+  return true;
+}
+
+void UdevWatch::Stop() {
+  if (!started_)
+    return;
+  UdevService::GetInstance().RemoveWatch(subsystem_, callback_, user_data_);
+  started_ = false;
+}
+
 }  // namespace system_info
@@ -5,18 +5,22 @@
 #ifndef SYSTEM_INFO_SYSTEM_INFO_UTILS_H_
 #define SYSTEM_INFO_SYSTEM_INFO_UTILS_H_
 
+#include <glib.h>
 #include <libudev.h>
 #include <pthread.h>
 #include <unistd.h>
 
 #if defined(TIZEN) && !defined(TIZEN_MOBILE)
 #include <gio/gio.h>
-#include <glib.h>
 #include <glib-object.h>
 #endif
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "common/picojson.h"
+#include "common/utils.h"
 
 struct AutoLock {
   explicit AutoLock(pthread_mutex_t* m) : m_(m) { pthread_mutex_lock(m_); }
@@ -62,6 +66,121 @@ inline bool ParseBoolean(std::string str) {
   return str == "true" ? true : false;
 }
 
+// Calls |callback| from the GLib main loop whenever |fd| becomes readable.
+// Returns the source id, to be removed with g_source_remove().
+guint AddFdWatch(int fd, GIOFunc callback, gpointer user_data);
+// Same, for the given conditions only.
+guint AddFdWatch(int fd, GIOCondition condition, GIOFunc callback,
+                 gpointer user_data);
+
+// Notifies about changes of a set of files with inotify. The parent
+// directories are watched, so that files replaced by a rename, as most
+// tools do, are still noticed.
+class FileWatch {
+ public:
+  typedef void (*Callback)(void* user_data);
+
+  FileWatch(Callback callback, void* user_data);
+  ~FileWatch();
+
+  void AddPath(const std::string& path);
+  bool Start();
+  void Stop();
+
+ private:
+  static gboolean OnEvent(GIOChannel* channel, GIOCondition condition,
+                          gpointer user_data);
+
+  Callback callback_;
+  void* user_data_;
+  std::vector<std::string> paths_;
+  // Watched file names, by watch descriptor of their directory.
+  std::map<int, std::set<std::string> > names_;
+  int fd_;
+  guint source_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileWatch);
+};
+
+// The udev context and netlink monitor shared by all properties. The
+// monitor only receives the subsystems in use, and the devices of each are
+// listed once and then kept current from the uevents, so walking them
+// doesn't scan sysfs. Everything runs under one lock; udev objects must
+// only be used from the callbacks and visitors.
+class UdevService {
+ public:
+  typedef void (*Callback)(udev_device* dev, void* user_data);
+  // Returns false to stop the walk.
+  typedef bool (*Visitor)(udev_device* dev, void* user_data);
+
+  static UdevService& GetInstance() {
+    static UdevService instance;
+    return instance;
+  }
+
+  // |callback| runs from the GLib main loop for each uevent of
+  // |subsystem|, after its device list is updated.
+  void AddWatch(const std::string& subsystem, Callback callback,
+                void* user_data);
+  void RemoveWatch(const std::string& subsystem, Callback callback,
+                   void* user_data);
+
+  // Calls |visitor| for the devices of |subsystem|.
+  void ForEachDevice(const std::string& subsystem, Visitor visitor,
+                     void* user_data);
+
+ private:
+  struct Watch {
+    Callback callback;
+    void* user_data;
+  };
+
+  struct Subsystem {
+    Subsystem() : listed(false) {}
+
+    std::vector<Watch> watches;
+    // By syspath, once listed.
+    std::map<std::string, udev_device*> devices;
+    bool listed;
+  };
+
+  UdevService();
+  ~UdevService();
+
+  // Makes the monitor receive the uevents of |subsystem|.
+  Subsystem* Use(const std::string& subsystem);
+  static gboolean OnEvent(GIOChannel* channel, GIOCondition condition,
+                          gpointer user_data);
+
+  pthread_mutex_t mutex_;
+  udev* udev_;
+  udev_monitor* monitor_;
+  guint source_id_;
+  std::map<std::string, Subsystem> subsystems_;
+
+  DISALLOW_COPY_AND_ASSIGN(UdevService);
+};
+
+// Notifies about the uevents of a udev subsystem, through the UdevService.
+class UdevWatch {
+ public:
+  typedef UdevService::Callback Callback;
+
+  UdevWatch(const char* subsystem, Callback callback, void* user_data);
+  ~UdevWatch();
+
+  bool Start();
+  void Stop();
+
+ private:
+  std::string subsystem_;
+  Callback callback_;
+  void* user_data_;
+  bool started_;
+
+  DISALLOW_COPY_AND_ASSIGN(UdevWatch);
+};
+
 }  // namespace system_info
 
 #endif  // SYSTEM_INFO_SYSTEM_INFO_UTILS_H_
@@ -0,0 +1,197 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "system_info/system_info_wifi_access_points.h"
+
+#include <math.h>
+
+#include <string>
+
+namespace {
+
+// The list is scanned for again when asked for after this, in ms.
+const gint64 kMaxScanAge = 30000;
+
+// How often to scan while listening, in ms. Scans take a few seconds and
+// keep the radio busy, so this is not the listeners' interval.
+const guint kScanInterval = 30000;
+
+// Signal strength changes below this aren't told when listeners didn't
+// ask for a deadband.
+const double kDefaultDeadband = 0.05;
+
+}  // namespace
+
+const std::string SysInfoWifiAccessPoints::name_ = "WIFI_ACCESS_POINTS";
+
+void SysInfoWifiAccessPoints::Get(picojson::value& error,
+                                  picojson::value& data) {
+  ScanIfStale();
+
+  picojson::array access_points;
+  {
+    AutoLock lock(&mutex_);
+    if (!can_scan_) {
+      system_info::SetPicoJsonObjectValue(error, "message",
+          picojson::value("No Wi-Fi device found."));
+      return;
+    }
+    for (AccessPoints::const_iterator it = access_points_.begin();
+         it != access_points_.end(); ++it)
+      access_points.push_back(ToJson(it->first, it->second));
+  }
+
+  system_info::SetPicoJsonObjectValue(data, "accessPoints",
+      picojson::value(access_points));
+  system_info::SetPicoJsonObjectValue(error, "message", picojson::value(""));
+}
+
+void SysInfoWifiAccessPoints::Invalidate() {
+  AutoLock lock(&mutex_);
+  last_scan_time_ = 0;
+}
+
+// Get() runs outside of the GLib main loop, the scan is asked for from it.
+void SysInfoWifiAccessPoints::ScanIfStale() {
+  AutoLock lock(&mutex_);
+  gint64 now = g_get_monotonic_time() / 1000;
+  if (last_scan_time_ && now - last_scan_time_ < kMaxScanAge)
+    return;
+  last_scan_time_ = now;
+  g_idle_add(SysInfoWifiAccessPoints::OnScanIdle,
+             static_cast<gpointer>(this));
+}
+
+gboolean SysInfoWifiAccessPoints::OnScanIdle(gpointer user_data) {
+  SysInfoWifiAccessPoints* instance =
+      static_cast<SysInfoWifiAccessPoints*>(user_data);
+  bool can_scan = instance->RequestScan();
+  AutoLock lock(&instance->mutex_);
+  instance->can_scan_ = can_scan;
+  return FALSE;
+}
+
+gboolean SysInfoWifiAccessPoints::OnScanTimeout(gpointer user_data) {
+  SysInfoWifiAccessPoints* instance =
+      static_cast<SysInfoWifiAccessPoints*>(user_data);
+  {
+    AutoLock lock(&instance->mutex_);
+    instance->last_scan_time_ = g_get_monotonic_time() / 1000;
+  }
+  OnScanIdle(user_data);
+  return TRUE;
+}
+
+picojson::value SysInfoWifiAccessPoints::ToJson(
+    const std::string& bssid, const AccessPoint& access_point) {
+  picojson::object o;
+  o["bssid"] = picojson::value(bssid);
+  o["ssid"] = picojson::value(access_point.ssid);
+  o["signalStrength"] = picojson::value(access_point.signal_strength);
+  o["frequency"] = picojson::value(access_point.frequency);
+  return picojson::value(o);
+}
+
+void SysInfoWifiAccessPoints::SetAccessPoints(
+    const AccessPoints& access_points) {
+  AutoLock lock(&mutex_);
+  access_points_ = access_points;
+  if (!has_listeners())
+    return;
+
+  double deadband = this->deadband() > 0 ? this->deadband() :
+      kDefaultDeadband;
+  picojson::array added;
+  picojson::array changed;
+  picojson::array removed;
+  for (AccessPoints::const_iterator it = access_points.begin();
+       it != access_points.end(); ++it) {
+    AccessPoints::iterator reported = reported_.find(it->first);
+    if (reported == reported_.end()) {
+      added.push_back(ToJson(it->first, it->second));
+      reported_[it->first] = it->second;
+    } else if (fabs(it->second.signal_strength -
+                    reported->second.signal_strength) >= deadband ||
+               it->second.ssid != reported->second.ssid) {
+      changed.push_back(ToJson(it->first, it->second));
+      reported->second = it->second;
+    }
+  }
+  AccessPoints::iterator it = reported_.begin();
+  while (it != reported_.end()) {
+    if (access_points.count(it->first)) {
+      ++it;
+      continue;
+    }
+    picojson::object o;
+    o["bssid"] = picojson::value(it->first);
+    removed.push_back(picojson::value(o));
+    reported_.erase(it++);
+  }
+  if (added.empty() && changed.empty() && removed.empty())
+    return;
+
+  PostMessageToListeners(ChangesMessage(added, changed, removed));
+}
+
+picojson::value SysInfoWifiAccessPoints::ChangesMessage(
+    const picojson::array& added, const picojson::array& changed,
+    const picojson::array& removed) {
+  picojson::value output = picojson::value(picojson::object());
+  picojson::value data = picojson::value(picojson::object());
+
+  system_info::SetPicoJsonObjectValue(data, "added", picojson::value(added));
+  system_info::SetPicoJsonObjectValue(data, "changed",
+      picojson::value(changed));
+  system_info::SetPicoJsonObjectValue(data, "removed",
+      picojson::value(removed));
+  system_info::SetPicoJsonObjectValue(output, "cmd",
+      picojson::value("SystemInfoPropertyValueChanged"));
+  system_info::SetPicoJsonObjectValue(output, "prop",
+      picojson::value("WIFI_ACCESS_POINTS"));
+  system_info::SetPicoJsonObjectValue(output, "data", data);
+  return output;
+}
+
+// Every listener starts from what the others were told last, whenever it
+// was added; it's posted under the lock, so no change slips in between.
+void SysInfoWifiAccessPoints::OnListenerAdded(SystemInfoInstance* instance,
+                                              int id) {
+  AutoLock lock(&mutex_);
+  picojson::array access_points;
+  for (AccessPoints::const_iterator it = reported_.begin();
+       it != reported_.end(); ++it)
+    access_points.push_back(ToJson(it->first, it->second));
+
+  picojson::value output = ChangesMessage(picojson::array(),
+      picojson::array(), picojson::array());
+  picojson::value& data = output.get<picojson::object>()["data"];
+  system_info::SetPicoJsonObjectValue(data, "accessPoints",
+      picojson::value(access_points));
+  PostMessageToListener(instance, id, output);
+}
+
+// Listeners start from the list they would get, and are only told about
+// what differs from it.
+void SysInfoWifiAccessPoints::StartListening() {
+  {
+    AutoLock lock(&mutex_);
+    reported_ = access_points_;
+  }
+  ScanIfStale();
+  if (timeout_cb_id_ == 0) {
+    timeout_cb_id_ = g_timeout_add(kScanInterval,
+                                   SysInfoWifiAccessPoints::OnScanTimeout,
+                                   static_cast<gpointer>(this));
+  }
+}
+
+void SysInfoWifiAccessPoints::StopListening() {
+  if (timeout_cb_id_ > 0) {
+    g_source_remove(timeout_cb_id_);
+    timeout_cb_id_ = 0;
+  }
+  AutoLock lock(&mutex_);
+  reported_.clear();
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SYSTEM_INFO_SYSTEM_INFO_WIFI_ACCESS_POINTS_H_
+#define SYSTEM_INFO_SYSTEM_INFO_WIFI_ACCESS_POINTS_H_
+
+#include <glib.h>
+#include <pthread.h>
+#if defined(TIZEN)
+#include <wifi.h>
+#endif
+
+#include <map>
+#include <string>
+
+#include "common/picojson.h"
+#include "common/utils.h"
+#include "system_info/system_info_instance.h"
+#include "system_info/system_info_utils.h"
+
+// The Wi-Fi access points in range, as found by the last scan. Getting them
+// never waits for a scan, it only asks for one when the list is old.
+// Listeners are told about the access points which appeared, disappeared,
+// or whose signal strength moved by the smallest deadband they asked for.
+// The first post a listener gets has all the access points those changes
+// apply to, in "accessPoints".
+class SysInfoWifiAccessPoints : public SysInfoObject {
+ public:
+  static SysInfoObject& GetInstance() {
+    static SysInfoWifiAccessPoints instance;
+    return instance;
+  }
+  ~SysInfoWifiAccessPoints();
+  void Get(picojson::value& error, picojson::value& data);
+  void Invalidate();
+  void StartListening();
+  void StopListening();
+  bool PostsChanges() const { return true; }
+
+  static const std::string name_;
+
+ private:
+  struct AccessPoint {
+    std::string ssid;
+    // In [0, 1].
+    double signal_strength;
+    // In MHz.
+    double frequency;
+  };
+  // By BSSID.
+  typedef std::map<std::string, AccessPoint> AccessPoints;
+
+  SysInfoWifiAccessPoints();
+  void PlatformInitialize();
+  void OnListenerAdded(SystemInfoInstance* instance, int id);
+  // Returns false when there is no Wi-Fi device to scan with.
+  bool RequestScan();
+
+  // Takes the result of a scan, and tells the listeners what changed
+  // since they were last told.
+  void SetAccessPoints(const AccessPoints& access_points);
+  void ScanIfStale();
+  static picojson::value ToJson(const std::string& bssid,
+                                const AccessPoint& access_point);
+  // The message telling listeners about these changes.
+  static picojson::value ChangesMessage(const picojson::array& added,
+                                        const picojson::array& changed,
+                                        const picojson::array& removed);
+  static gboolean OnScanIdle(gpointer user_data);
+  static gboolean OnScanTimeout(gpointer user_data);
+
+  // Guards the members below, set from the GLib main loop and read by
+  // Get().
+  pthread_mutex_t mutex_;
+  AccessPoints access_points_;
+  // What the listeners were told last.
+  AccessPoints reported_;
+  bool can_scan_;
+  // Monotonic, in ms; 0 to scan on the next Get().
+  gint64 last_scan_time_;
+  guint timeout_cb_id_;
+
+#if defined(GENERIC_DESKTOP)
+  static void OnNetworkManagerChanged(void* user_data);
+#elif defined(TIZEN)
+  void ReadFoundAccessPoints();
+  static void OnScanFinished(wifi_error_e error, void* user_data);
+  static bool OnFoundAccessPoint(wifi_ap_h ap, void* user_data);
+
+  bool initialized_;
+#endif
+
+  DISALLOW_COPY_AND_ASSIGN(SysInfoWifiAccessPoints);
+};
+
+#endif  // SYSTEM_INFO_SYSTEM_INFO_WIFI_ACCESS_POINTS_H_
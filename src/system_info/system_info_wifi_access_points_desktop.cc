@@ -0,0 +1,103 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "system_info/system_info_wifi_access_points.h"
+
+#include <NetworkManager.h>
+
+#include <string>
+#include <vector>
+
+#include "system_info/system_info_network_manager_desktop.h"
+
+namespace {
+
+const double kWifiSignalStrengthDivisor = 100.0;
+
+std::vector<std::string> GetWifiDevices(
+    const system_info::NetworkManagerCache& cache) {
+  std::vector<std::string> devices = cache.GetObjectPaths(NM_DBUS_PATH,
+      NM_DBUS_INTERFACE, "Devices");
+  std::vector<std::string> wifi_devices;
+  for (unsigned i = 0; i < devices.size(); ++i) {
+    if (cache.GetUint32(devices[i], NM_DBUS_INTERFACE_DEVICE, "DeviceType",
+                        NM_DEVICE_TYPE_UNKNOWN) == NM_DEVICE_TYPE_WIFI)
+      wifi_devices.push_back(devices[i]);
+  }
+  return wifi_devices;
+}
+
+}  // namespace
+
+SysInfoWifiAccessPoints::SysInfoWifiAccessPoints()
+    : can_scan_(true),
+      last_scan_time_(0),
+      timeout_cb_id_(0) {
+  pthread_mutex_init(&mutex_, NULL);
+  PlatformInitialize();
+}
+
+SysInfoWifiAccessPoints::~SysInfoWifiAccessPoints() {
+  StopListening();
+  pthread_mutex_destroy(&mutex_);
+}
+
+// The access points of the Wi-Fi devices are in the NetworkManager cache,
+// which tells when a scan changed them. It is primed already, so the
+// cached ones are taken right away.
+void SysInfoWifiAccessPoints::PlatformInitialize() {
+  system_info::NetworkManagerCache::GetInstance().AddObserver(
+      OnNetworkManagerChanged, this);
+  OnNetworkManagerChanged(this);
+}
+
+bool SysInfoWifiAccessPoints::RequestScan() {
+  system_info::NetworkManagerCache& cache =
+      system_info::NetworkManagerCache::GetInstance();
+  std::vector<std::string> devices = GetWifiDevices(cache);
+  for (unsigned i = 0; i < devices.size(); ++i) {
+    cache.Call(devices[i], NM_DBUS_INTERFACE_DEVICE_WIRELESS, "RequestScan",
+               g_variant_new("(a{sv})", NULL));
+  }
+  return !devices.empty();
+}
+
+void SysInfoWifiAccessPoints::OnNetworkManagerChanged(void* user_data) {
+  SysInfoWifiAccessPoints* self =
+      static_cast<SysInfoWifiAccessPoints*>(user_data);
+  system_info::NetworkManagerCache& cache =
+      system_info::NetworkManagerCache::GetInstance();
+
+  AccessPoints access_points;
+  std::vector<std::string> devices = GetWifiDevices(cache);
+  for (unsigned i = 0; i < devices.size(); ++i) {
+    std::vector<std::string> paths = cache.GetObjectPaths(devices[i],
+        NM_DBUS_INTERFACE_DEVICE_WIRELESS, "AccessPoints");
+    for (unsigned j = 0; j < paths.size(); ++j) {
+      // Access points still being fetched are left for the next change.
+      GVariant* bssid = cache.GetProperty(paths[j],
+          NM_DBUS_INTERFACE_ACCESS_POINT, "HwAddress");
+      if (!bssid)
+        continue;
+      AccessPoint& access_point =
+          access_points[g_variant_get_string(bssid, NULL)];
+      GVariant* value;
+      value = cache.GetProperty(paths[j], NM_DBUS_INTERFACE_ACCESS_POINT,
+                                "Ssid");
+      access_point.ssid = value ? system_info::SSIDFromVariant(value) : "";
+      value = cache.GetProperty(paths[j], NM_DBUS_INTERFACE_ACCESS_POINT,
+                                "Strength");
+      access_point.signal_strength = value ?
+          g_variant_get_byte(value) / kWifiSignalStrengthDivisor : 0.0;
+      access_point.frequency = cache.GetUint32(paths[j],
+          NM_DBUS_INTERFACE_ACCESS_POINT, "Frequency", 0);
+    }
+  }
+
+  {
+    AutoLock lock(&self->mutex_);
+    self->can_scan_ = !devices.empty();
+  }
+  self->SetAccessPoints(access_points);
+}
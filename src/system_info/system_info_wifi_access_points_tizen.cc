@@ -0,0 +1,91 @@
+// Copyright (c) 2014 Intel Corporation. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "system_info/system_info_wifi_access_points.h"
+
+#include <stdlib.h>
+
+#include <string>
+
+namespace {
+
+// RSSIs are mapped linearly to signal strengths from this, in dBm...
+const int kMinRssi = -100;
+// ... to this.
+const int kMaxRssi = -50;
+
+}  // namespace
+
+SysInfoWifiAccessPoints::SysInfoWifiAccessPoints()
+    : can_scan_(false),
+      last_scan_time_(0),
+      timeout_cb_id_(0),
+      initialized_(false) {
+  pthread_mutex_init(&mutex_, NULL);
+  PlatformInitialize();
+}
+
+SysInfoWifiAccessPoints::~SysInfoWifiAccessPoints() {
+  StopListening();
+  if (initialized_) {
+    wifi_unset_background_scan_cb();
+    wifi_deinitialize();
+  }
+  pthread_mutex_destroy(&mutex_);
+}
+
+// The Wi-Fi manager also scans on its own now and then, the results of
+// those scans are taken too.
+void SysInfoWifiAccessPoints::PlatformInitialize() {
+  initialized_ = wifi_initialize() == WIFI_ERROR_NONE;
+  can_scan_ = initialized_;
+  if (!initialized_)
+    return;
+  wifi_set_background_scan_cb(OnScanFinished, this);
+  ReadFoundAccessPoints();
+}
+
+bool SysInfoWifiAccessPoints::RequestScan() {
+  return initialized_ && wifi_scan(OnScanFinished, this) == WIFI_ERROR_NONE;
+}
+
+void SysInfoWifiAccessPoints::OnScanFinished(wifi_error_e error,
+                                             void* user_data) {
+  if (error != WIFI_ERROR_NONE)
+    return;
+  static_cast<SysInfoWifiAccessPoints*>(user_data)->ReadFoundAccessPoints();
+}
+
+void SysInfoWifiAccessPoints::ReadFoundAccessPoints() {
+  AccessPoints access_points;
+  wifi_foreach_found_aps(OnFoundAccessPoint, &access_points);
+  SetAccessPoints(access_points);
+}
+
+bool SysInfoWifiAccessPoints::OnFoundAccessPoint(wifi_ap_h ap,
+                                                 void* user_data) {
+  AccessPoints* access_points = static_cast<AccessPoints*>(user_data);
+
+  char* bssid = NULL;
+  if (wifi_ap_get_bssid(ap, &bssid) != WIFI_ERROR_NONE || !bssid)
+    return true;
+  AccessPoint& access_point = (*access_points)[bssid];
+  free(bssid);
+
+  char* essid = NULL;
+  if (wifi_ap_get_essid(ap, &essid) == WIFI_ERROR_NONE && essid) {
+    access_point.ssid = essid;
+    free(essid);
+  }
+  int rssi = kMinRssi;
+  wifi_ap_get_rssi(ap, &rssi);
+  double strength = static_cast<double>(rssi - kMinRssi) /
+      (kMaxRssi - kMinRssi);
+  access_point.signal_strength = strength < 0.0 ? 0.0 :
+      strength > 1.0 ? 1.0 : strength;
+  int frequency = 0;
+  wifi_ap_get_frequency(ap, &frequency);
+  access_point.frequency = frequency;
+  return true;
+}
@@ -17,16 +17,6 @@
 #include "system_info/system_info_instance.h"
 #include "system_info/system_info_utils.h"
 
-#if defined(GENERIC_DESKTOP)
-#define G_CALLBACK_WIFI(METHOD, SENDER, ARG0)                                \
-  static void METHOD ## Thunk(SENDER sender, ARG0 res, gpointer userdata) {  \
-    return reinterpret_cast<SysInfoWifiNetwork*>(userdata)->METHOD(sender,   \
-                                                                   res);     \
-  }                                                                          \
-                                                                             \
-  void METHOD(SENDER, ARG0);
-#endif
-
 class SysInfoWifiNetwork : public SysInfoObject {
  public:
   static SysInfoObject& GetInstance() {
@@ -41,6 +31,8 @@ class SysInfoWifiNetwork : public SysInfoObject {
   static const std::string name_;
 
  private:
+  const char* ThresholdAttribute() const { return "signalStrength"; }
+
   SysInfoWifiNetwork();
   void PlatformInitialize();
 
@@ -55,38 +47,9 @@ class SysInfoWifiNetwork : public SysInfoObject {
   std::string status_;
 
 #if defined(GENERIC_DESKTOP)
-  G_CALLBACK_WIFI(OnAccessPointCreated, GObject*, GAsyncResult*);
-  G_CALLBACK_WIFI(OnActiveAccessPointCreated, GObject*, GAsyncResult*);
-  G_CALLBACK_WIFI(OnActiveConnectionCreated, GObject*, GAsyncResult*);
-  G_CALLBACK_WIFI(OnDevicesCreated, GObject*, GAsyncResult*);
-  G_CALLBACK_WIFI(OnNetworkManagerCreated, GObject*, GAsyncResult*);
-  G_CALLBACK_WIFI(OnIPAddressCreated, GObject*, GAsyncResult*);
-  G_CALLBACK_WIFI(OnIPv6AddressCreated, GObject*, GAsyncResult*);
-  G_CALLBACK_WIFI(OnUpdateIPv6Address, GObject*, GAsyncResult*);
-
   std::string IPAddressConverter(unsigned int ip);
-  void UpdateActiveAccessPoint(GVariant* value);
-  void UpdateActiveConnection(GVariant* value);
-  void UpdateActiveDevice(GVariant* value);
-  void UpdateDeviceType(GVariant* value);
-  void UpdateIPAddress(GVariant* value);
-  void UpdateIPv6Address(GVariant* value);
-  void UpdateSignalStrength(GVariant* value);
-  void UpdateSSID(GVariant* value);
-  void UpdateStatus(guint new_device_type);
-
-  static void OnAccessPointSignal(GDBusProxy* proxy, gchar* sender,
-      gchar* signal, GVariant* parameters, gpointer user_data);
-  static void OnActiveConnectionsSignal(GDBusProxy* proxy, gchar* sender,
-      gchar* signal, GVariant* parameters, gpointer user_data);
-  static void OnNetworkManagerSignal(GDBusProxy* proxy, gchar* sender,
-      gchar* signal, GVariant* parameters, gpointer user_data);
+  static void OnNetworkManagerChanged(void* user_data);
 
-  guint device_type_;
-  std::string active_access_point_;
-  std::string active_connection_;
-  std::string active_device_;
-  std::string ipv6_config_;
   unsigned int ip_address_desktop_;
 #elif defined(TIZEN)
   bool GetIPv4Address();
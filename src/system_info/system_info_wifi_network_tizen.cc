@@ -34,6 +34,8 @@ void SysInfoWifiNetwork::PlatformInitialize() {
 }
 
 SysInfoWifiNetwork::~SysInfoWifiNetwork() {
+  if (has_listeners())
+    StopListening();
   if (connection_profile_handle_)
     free(connection_profile_handle_);
   if (connection_handle_)